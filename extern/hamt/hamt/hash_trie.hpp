@@ -325,6 +325,23 @@ namespace hamt {
             return newLeaf;
         }
 
+        // Replaces a value without copying the leaf. Only valid while nothing
+        // else refers to this leaf
+        template <typename U>
+        void replace_value_in_place(size_t index, U &&newValue) {
+            assert( index < m_size && m_refCount.load( std::memory_order_relaxed ) == 1 );
+            m_values[index] = T( std::forward<U>( newValue ) );
+        }
+
+        // Removes a value without copying the leaf. Only valid while nothing
+        // else refers to this leaf, and while it has another value left
+        void erase_value_in_place(size_t index) {
+            assert( index < m_size && m_size > 1 && m_refCount.load( std::memory_order_relaxed ) == 1 );
+            for( size_t i = index; i + 1 < m_size; ++i )
+                m_values[i] = std::move( m_values[i + 1] );
+            m_values[--m_size].~T();
+        }
+
         auto with_erased_value(size_t index) const -> std::unique_ptr<leaf_node> {
             assert(index < m_size);
             if (m_size == 1) {
@@ -484,16 +501,91 @@ namespace hamt {
                 addref(sharedNode);
             }
 
+            if (removing) {
+                // Later children move down to fill the gap
+                for (size_t i = splitPoint; i < newSize; ++i) {
+                    auto sharedNode = node->m_children[i] = m_children[i + 1];
+                    addref(sharedNode);
+                }
+                return node;
+            }
+
             node->m_children[splitPoint] = child;
 
-            auto copyBegin = removing ? splitPoint : splitPoint + 1;
-            for (size_t i = copyBegin; i < newSize; ++i) {
+            for (size_t i = splitPoint + 1; i < newSize; ++i) {
                 auto sharedNode = node->m_children[i] = m_children[i];
                 addref(sharedNode);
             }
             return node;
         }
 
+        static void release_child( node const* child ) {
+            if( child->m_type == node_type::branch )
+                release( static_cast<branch_node<T, Lookup> const*>( child ) );
+            else
+                release( static_cast<leaf_node<T, Lookup> const*>( child ) );
+        }
+
+        // A copy of this branch that shares all of its children
+        auto clone() const -> std::unique_ptr<branch_node> {
+            auto len = size();
+            auto node = create_unpopulated( len == 0 ? 1 : len, m_bitmap );
+            node->m_size = len;
+            for( size_t i = 0; i < len; ++i ) {
+                auto sharedNode = node->m_children[i] = m_children[i];
+                addref(sharedNode);
+            }
+            return node;
+        }
+
+        // The transient operations below modify a branch in place. They are only
+        // valid while nothing else refers to the branch.
+        auto is_exclusive() const -> bool {
+            return m_refCount.load( std::memory_order_acquire ) == 1;
+        }
+
+        // Replaces an existing child, releasing the old one. Takes ownership of
+        // a reference to `child`
+        void replace_child_in_place(sparse_index sparseIndex, node const *child) {
+            assert( is_exclusive() && child != nullptr );
+            assert( ( m_bitmap & sparseIndex.bit_position() ) != 0 );
+            auto& slot = m_children[sparseIndex.toCompact( m_bitmap ).value()];
+            auto old = slot;
+            slot = child;
+            release_child( old );
+        }
+
+        // Removes a child and releases it. The storage of the branch is kept
+        void erase_child_in_place(sparse_index sparseIndex) {
+            assert( is_exclusive() );
+            assert( ( m_bitmap & sparseIndex.bit_position() ) != 0 );
+            auto compact = sparseIndex.toCompact( m_bitmap ).value();
+            auto old = m_children[compact];
+            for( size_t i = compact; i + 1 < m_size; ++i )
+                m_children[i] = m_children[i + 1];
+            --m_size;
+            m_bitmap ^= sparseIndex.bit_position();
+            release_child( old );
+        }
+
+        // Like `with_inserted()`, but moves the children out of this branch
+        // rather than sharing them. This branch is left empty, to be released
+        // by its owner
+        auto moved_inserted(sparse_index sparseIndex, node const *child) -> std::unique_ptr<branch_node> {
+            assert( is_exclusive() );
+            auto originalSize = size();
+            auto splitPoint = sparseIndex.toCompact( m_bitmap ).value();
+            auto node = create_unpopulated( originalSize + 1, m_bitmap | sparseIndex.bit_position() );
+            for( size_t i = 0; i < splitPoint; ++i )
+                node->m_children[i] = m_children[i];
+            node->m_children[splitPoint] = child;
+            for( size_t i = splitPoint; i < originalSize; ++i )
+                node->m_children[i+1] = m_children[i];
+            m_size = 0;
+            m_bitmap = 0;
+            return node;
+        }
+
         auto size() const {
             assert( m_size == detail::count_set_bits( static_cast<uint32_t>( m_bitmap ) ) );
             return m_size;
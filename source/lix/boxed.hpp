@@ -15,12 +15,11 @@ namespace lix {
 
 namespace detail {
 
-class boxed_storage_base {
+class boxed_storage_base : public value_cell_base {
 public:
-    virtual std::shared_ptr<boxed_storage_base> clone() const     = 0;
-    virtual lix::refl::rt_type_info             type_info() const = 0;
-    virtual ~boxed_storage_base()                                 = default;
-    virtual const void* dataptr() const noexcept                  = 0;
+    virtual lix::refl::rt_type_info type_info() const        = 0;
+    virtual ~boxed_storage_base()                           = default;
+    virtual const void*             dataptr() const noexcept = 0;
 };
 
 template <typename T>
@@ -40,10 +39,6 @@ class boxed_storage : public boxed_storage_base {
     static RealType&       unref(RealType& ref) { return ref; }
     static const RealType& unref(const RealType& ref) { return ref; }
 
-    std::shared_ptr<boxed_storage_base> clone() const override {
-        return std::make_shared<boxed_storage<RealType, Stored>>(_value);
-    }
-
     lix::refl::rt_type_info type_info() const override {
         return lix::refl::rt_type_info::for_type<RealType>();
     }
@@ -63,7 +58,21 @@ template <typename T>
 struct is_boxable : lix::refl::is_reflected<std::decay_t<T>> {};
 
 class boxed {
-    std::shared_ptr<detail::boxed_storage_base> _item;
+    /**
+     * The `detail::boxed_storage_base`, which is also the cell of a value
+     * holding the box. The storage is polymorphic, so the cell is not
+     * necessarily at the start of it.
+     */
+    detail::value_cell_base* _cell;
+
+    const detail::boxed_storage_base* _item() const noexcept {
+        return static_cast<const detail::boxed_storage_base*>(_cell);
+    }
+    void _release() noexcept {
+        if (_cell && _cell->drop_ref()) {
+            delete _item();
+        }
+    }
 
 public:
     template <typename T,
@@ -71,18 +80,42 @@ public:
               typename          = std::enable_if_t<!std::is_same<RealType, boxed>::value
                                           && is_boxable<RealType>::value>>
     boxed(T&& value)
-        : _item(std::make_shared<detail::boxed_storage<RealType, std::decay_t<T>>>(
-              std::forward<T>(value))) {}
+        : _cell(new detail::boxed_storage<RealType, std::decay_t<T>>(std::forward<T>(value))) {}
 
-    boxed(const boxed& other)
-        : _item(other._item) {}
+    boxed(const boxed& other) noexcept
+        : _cell(other._cell) {
+        _cell->add_ref();
+    }
+    boxed(boxed&& other) noexcept
+        : _cell(std::exchange(other._cell, nullptr)) {}
+    boxed& operator=(const boxed& other) noexcept {
+        other._cell->add_ref();
+        _release();
+        _cell = other._cell;
+        return *this;
+    }
+    boxed& operator=(boxed&& other) noexcept {
+        if (this != &other) {
+            _release();
+            _cell = std::exchange(other._cell, nullptr);
+        }
+        return *this;
+    }
+    ~boxed() { _release(); }
 
-    lix::refl::rt_type_info type_info() const { return _item->type_info(); }
+    lix::refl::rt_type_info type_info() const { return _item()->type_info(); }
 
-    const void* get_dataptr() const noexcept { return _item->dataptr(); }
+    const void* get_dataptr() const noexcept { return _item()->dataptr(); }
     lix::value  get_member(std::string_view member_name) const;
 };
 
+namespace detail {
+
+template <>
+struct is_cell_handle<boxed> : std::true_type {};
+
+}  // namespace detail
+
 class bad_box_cast : std::logic_error {
 public:
     bad_box_cast(std::string from, std::string to)
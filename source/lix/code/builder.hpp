@@ -3,13 +3,16 @@
 
 #include <lix/code/code.hpp>
 #include <lix/code/instr.hpp>
+#include <lix/value.hpp>
 
 #include <deque>
+#include <vector>
 
 namespace lix::code {
 
 class code_builder {
-    std::deque<instr> _code;
+    std::deque<instr>       _code;
+    std::vector<lix::value> _constants;
 
     instr& _push_instr(instr&&);
 
@@ -20,8 +23,9 @@ public:
     code_builder(code_builder&&)      = default;
 
     code save() {
-        auto ret = code(_code.begin(), _code.end());
+        auto ret = code(_code.begin(), _code.end(), std::move(_constants));
         _code.clear();
+        _constants.clear();
         return std::move(ret);
     }
 
@@ -31,6 +35,15 @@ public:
         return std::get<Instr>(ret.instr_var());
     }
 
+    /**
+     * Add a value to the constant pool of the code, and get the index that a
+     * load_const of it should use
+     */
+    std::size_t add_constant(lix::value val) {
+        _constants.push_back(std::move(val));
+        return _constants.size() - 1;
+    }
+
     inst_offset_t current_offset() const noexcept { return {_code.size()}; }
 };
 
@@ -0,0 +1,22 @@
+#include "call_cache.hpp"
+
+using namespace lix::code;
+
+call_cache_table::call_cache_table(std::size_t n_sites)
+    : _sites(std::make_unique<site[]>(n_sites))
+    , _n_sites(n_sites) {}
+
+void call_cache_table::update(std::uint32_t      site_idx,
+                              std::uint64_t      epoch,
+                              const target_type* target) noexcept {
+    auto& s   = _sites[site_idx];
+    auto  seq = s.seq.load(std::memory_order_relaxed);
+    if ((seq & 1) || !s.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+        // Someone else is updating this site
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    s.epoch.store(epoch, std::memory_order_relaxed);
+    s.target.store(target, std::memory_order_relaxed);
+    s.seq.store(seq + 2, std::memory_order_release);
+}
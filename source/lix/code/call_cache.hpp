@@ -0,0 +1,72 @@
+#ifndef LIX_CODE_CALL_CACHE_HPP_INCLUDED
+#define LIX_CODE_CALL_CACHE_HPP_INCLUDED
+
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <variant>
+
+namespace lix::exec {
+
+class function;
+class closure;
+
+}  // namespace lix::exec
+
+namespace lix::code {
+
+/**
+ * The inline caches for the call_mfa and tail_mfa sites in a block of code.
+ * Each site remembers the function it last resolved to, tagged with the module
+ * epoch of the context that resolved it. A context's module epoch changes
+ * whenever a module is registered, and is only shared by contexts that see the
+ * same modules, so a matching epoch means the cached function is still the
+ * right one. Forks of a frozen context hit the entries that it left behind.
+ *
+ * Code may run on several threads at once, so each site is a seqlock around a
+ * single epoch and target that a miss overwrites in place. A lookup that races
+ * with an update is a miss. An update that races with another one is dropped,
+ * as the other is just as good.
+ */
+class call_cache_table {
+public:
+    using target_type = std::variant<exec::function, exec::closure>;
+
+private:
+    struct site {
+        /// Odd while the site is being written
+        std::atomic<std::uint32_t> seq{0};
+        std::atomic<std::uint64_t> epoch{0};
+        /// A `const target_type*`. An atomic of that would need the complete types.
+        std::atomic<const void*> target{nullptr};
+    };
+
+    std::unique_ptr<site[]> _sites;
+    std::size_t             _n_sites;
+
+public:
+    explicit call_cache_table(std::size_t n_sites);
+
+    /// Get the cached target of the given site, or nullptr on a miss
+    const target_type* lookup(std::uint32_t site, std::uint64_t epoch) const noexcept {
+        auto& s      = _sites[site];
+        auto  before = s.seq.load(std::memory_order_acquire);
+        auto  cached = s.epoch.load(std::memory_order_relaxed);
+        auto  target = s.target.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((before & 1) || s.seq.load(std::memory_order_relaxed) != before || cached != epoch) {
+            return nullptr;
+        }
+        return static_cast<const target_type*>(target);
+    }
+
+    /// Remember the target of a site for the given epoch
+    void update(std::uint32_t site, std::uint64_t epoch, const target_type* target) noexcept;
+
+    /// The number of cache entries, which is always one per site
+    std::size_t size() const noexcept { return _n_sites; }
+};
+
+}  // namespace lix::code
+
+#endif  // LIX_CODE_CALL_CACHE_HPP_INCLUDED
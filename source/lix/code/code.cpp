@@ -1,7 +1,11 @@
 #include "code.hpp"
 
+#include <lix/code/call_cache.hpp>
 #include <lix/code/instr.hpp>
+#include <lix/code/op.hpp>
+#include <lix/value.hpp>
 
+#include <algorithm>
 #include <iomanip>
 #include <vector>
 
@@ -9,23 +13,63 @@ using lix::code::code;
 
 namespace lix::code::detail {
 
+namespace {
+
+bool is_mfa_call(const op& o) {
+    return o.code == opcode::call_mfa || o.code == opcode::tail_mfa;
+}
+
+std::vector<op> lower_all(const std::vector<instr>& is, const std::vector<lix::value>& constants) {
+    std::vector<op> ops;
+    ops.reserve(is.size());
+    std::uint32_t n_call_sites = 0;
+    for (auto& i : is) {
+        auto& o = ops.emplace_back(lower(i));
+        if (is_mfa_call(o)) {
+            o.a = n_call_sites++;
+        } else if (o.code == opcode::load_const) {
+            assert(o.a < constants.size() && "load_const refers past the constant pool");
+            o.imm.constant = &constants[o.a];
+        }
+    }
+    return ops;
+}
+
+}  // namespace
+
 struct code_impl {
-    std::vector<instr> is;
-    code_impl(std::vector<instr>&& is_)
-        : is(std::move(is_)) {}
+    std::vector<instr>       is;
+    std::vector<lix::value>  constants;
+    std::vector<op>          ops;
+    mutable call_cache_table call_caches;
+    code_impl(std::vector<instr>&& is_, std::vector<lix::value>&& constants_)
+        : is(std::move(is_))
+        , constants(std::move(constants_))
+        , ops(lower_all(is, constants))
+        , call_caches(static_cast<std::size_t>(std::count_if(ops.begin(), ops.end(), is_mfa_call))) {}
+    // Lowered ops point into `is` and `constants`, so we must never be copied
+    code_impl(const code_impl&) = delete;
+    code_impl& operator=(const code_impl&) = delete;
 };
 
 }  // namespace lix::code::detail
 
 code::~code() = default;
 
-void code::_prep_impl(std::vector<instr>&& is) {
-    _impl = std::make_shared<detail::code_impl>(std::move(is));
+void code::_prep_impl(std::vector<instr>&& is) { _prep_impl(std::move(is), {}); }
+
+void code::_prep_impl(std::vector<instr>&& is, std::vector<lix::value>&& constants) {
+    _impl = std::make_shared<detail::code_impl>(std::move(is), std::move(constants));
 }
 
 using code_iter = code::iterator;
+using lix::code::op;
 code_iter   code::begin() const { return _impl->is.data(); }
 code_iter   code::end() const { return begin() + _impl->is.size(); }
+const op*   code::op_begin() const { return _impl->ops.data(); }
+const op*   code::op_at(code_iter it) const { return op_begin() + (it - begin()); }
+lix::code::call_cache_table& code::call_caches() const { return _impl->call_caches; }
+const std::vector<lix::value>& code::constants() const { return _impl->constants; }
 std::size_t code::size() const { return static_cast<std::size_t>(std::distance(begin(), end())); }
 
 std::ostream& lix::code::operator<<(std::ostream& o, const code& c) {
@@ -36,5 +80,10 @@ std::ostream& lix::code::operator<<(std::ostream& o, const code& c) {
         o << inst;
         o << '\n';
     }
+    counter = 0;
+    for (auto& val : c.constants()) {
+        o << "#" << std::left << std::setw(3) << counter++ << std::right << " " << inspect(val)
+          << '\n';
+    }
     return o;
 }
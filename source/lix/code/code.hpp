@@ -1,6 +1,8 @@
 #ifndef LIX_CODE_CODE_HPP_INCLUDED
 #define LIX_CODE_CODE_HPP_INCLUDED
 
+#include <lix/value_fwd.hpp>
+
 #include <array>
 #include <memory>
 #include <vector>
@@ -9,6 +11,8 @@
 namespace lix::code {
 
 class instr;
+struct op;
+class call_cache_table;
 
 namespace detail {
 
@@ -25,20 +29,54 @@ private:
     std::shared_ptr<const detail::code_impl> _impl;
 
     void _prep_impl(std::vector<instr>&&);
+    void _prep_impl(std::vector<instr>&&, std::vector<lix::value>&&);
 
 public:
     ~code();
+    code(const code&)            = default;
+    code(code&&) noexcept        = default;
+    code& operator=(const code&) = default;
+    code& operator=(code&&)      = default;
     iterator begin() const;
     iterator end() const;
     iterator cbegin() const { return begin(); }
     iterator cend() const { return end(); }
 
+    /**
+     * The lowered form of the code. There is exactly one op for each
+     * instruction, so instruction offsets are valid op offsets.
+     */
+    const op* op_begin() const;
+    const op* op_at(iterator it) const;
+
+    /**
+     * The inline caches of the call_mfa/tail_mfa sites of this code. The
+     * lowered form of those instructions holds the index of their site.
+     */
+    call_cache_table& call_caches() const;
+
+    /**
+     * The constant pool: values that are built once, along with the code, and
+     * pushed by its load_const instructions. These values are never modified.
+     */
+    const std::vector<lix::value>& constants() const;
+
     template <typename Iter>
     code(Iter first, Iter last) {
         std::vector<instr> new_code(first, last);
         _prep_impl(std::move(new_code));
     }
 
+    /**
+     * Create code whose load_const instructions refer to the given constant
+     * pool
+     */
+    template <typename Iter>
+    code(Iter first, Iter last, std::vector<lix::value>&& constants) {
+        std::vector<instr> new_code(first, last);
+        _prep_impl(std::move(new_code), std::move(constants));
+    }
+
     std::size_t size() const;
 };
 
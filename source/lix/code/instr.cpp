@@ -8,8 +8,14 @@ struct code_ostream_visitor {
     std::ostream& o;
 
     void operator()(is::ret r) { o << std::setw(13) << "ret  " << r.slot; }
-    void operator()(is::call c) { o << std::setw(13) << "call  " << c.fn << ", " << c.arg; }
-    void operator()(is::tail t) { o << std::setw(13) << "tail  " << t.fn << ", " << t.arg; }
+    void operator()(const is::call& c) {
+        o << std::setw(13) << "call  " << c.fn << "(";
+        write_args(c.args);
+    }
+    void operator()(const is::tail& t) {
+        o << std::setw(13) << "tail  " << t.fn << "(";
+        write_args(t.args);
+    }
     void operator()(is::call_mfa c) {
         o << std::setw(13) << "call_mfa  " << c.module.string() << "." << c.fn.string() << "(";
         auto arg_iter = c.args.begin();
@@ -49,9 +55,7 @@ struct code_ostream_visitor {
     void operator()(is::const_int i) { o << std::setw(13) << "const_int  " << i.value; }
     void operator()(is::const_real r) { o << std::setw(13) << "const_real  " << r.value; }
     void operator()(is::const_symbol sym) { o << std::setw(13) << "const_sym  " << sym.sym; }
-    void operator()(const is::const_str& str) {
-        o << std::setw(13) << "const_str  " << '"' << str.string << '"';
-    }
+    void operator()(is::load_const c) { o << std::setw(13) << "load_const  #" << c.index; }
     void operator()(is::hard_match m) {
         o << std::setw(13) << "hard_match  " << m.lhs << ", " << m.rhs;
     }
@@ -131,6 +135,100 @@ struct code_ostream_visitor {
     }
 
     void operator()(is::dot d) { o << std::setw(13) << "dot  " << d.object << ", " << d.attr_name; }
+    void operator()(is::enter_args e) {
+        o << std::setw(13) << "enter_args  " << e.first << ", " << e.arity << " else "
+          << e.overflow;
+    }
+    void operator()(is::test_arity t) { o << std::setw(13) << "test_arity  " << t.arity; }
+    void operator()(is::collect_args c) { o << std::setw(13) << "collect_args  " << c.first; }
+    void operator()(const is::switch_shape& sw) {
+        o << std::setw(13) << "switch_shape  " << sw.subject;
+        for (auto& c : sw.cases) {
+            o << ", ";
+            write_shape(c.key);
+            o << " -> " << c.target;
+        }
+        o << " else " << sw.otherwise;
+    }
+    void operator()(is::match_tuple m) {
+        o << std::setw(13) << "match_tuple  " << m.subject << ", " << m.arity;
+    }
+    void operator()(is::match_list m) {
+        o << std::setw(13) << "match_list  " << m.subject << ", " << m.length;
+    }
+    void operator()(is::match_cons m) { o << std::setw(13) << "match_cons  " << m.subject; }
+    void operator()(is::test_equal t) { o << std::setw(13) << "test_equal  " << t.a << ", " << t.b; }
+    void operator()(is::check_match c) { o << std::setw(13) << "check_match  " << c.subject; }
+    void operator()(const is::tail_self& t) {
+        o << std::setw(13) << "tail_self  " << t.first << " <- (";
+        write_args(t.args);
+        o << " then " << t.entry;
+    }
+
+    void operator()(is::test_arity_jump t) {
+        o << std::setw(13) << "test_arity_jump  " << t.arity << " else " << t.target;
+    }
+    void operator()(is::match_tuple_jump m) {
+        o << std::setw(13) << "match_tuple_jump  " << m.subject << ", " << m.arity << " else "
+          << m.target;
+    }
+    void operator()(is::match_list_jump m) {
+        o << std::setw(13) << "match_list_jump  " << m.subject << ", " << m.length << " else "
+          << m.target;
+    }
+    void operator()(is::match_cons_jump m) {
+        o << std::setw(13) << "match_cons_jump  " << m.subject << " else " << m.target;
+    }
+    void operator()(is::test_equal_jump t) {
+        o << std::setw(13) << "test_equal_jump  " << t.a << ", " << t.b << " else " << t.target;
+    }
+    void operator()(is::test_symbol_jump t) {
+        o << std::setw(13) << "test_symbol_jump  " << t.subject << ", " << t.sym << " else "
+          << t.target;
+    }
+    void operator()(is::test_int_jump t) {
+        o << std::setw(13) << "test_int_jump  " << t.subject << ", " << t.value << " else "
+          << t.target;
+    }
+    void operator()(is::hard_match_jump m) {
+        o << std::setw(13) << "hard_match_jump  " << m.lhs << ", " << m.rhs
+          << (m.move_rhs ? " (move)" : "") << " then " << m.target;
+    }
+
+    void write_shape(const is::shape_key& key) {
+        switch (key.kind) {
+        case is::shape_kind::tuple:
+            o << "{}/" << key.integer;
+            break;
+        case is::shape_kind::tagged_tuple:
+            o << "{" << key.sym << "}/" << key.integer;
+            break;
+        case is::shape_kind::empty_list:
+            o << "[]";
+            break;
+        case is::shape_kind::nonempty_list:
+            o << "[_|_]";
+            break;
+        case is::shape_kind::symbol:
+            o << key.sym;
+            break;
+        case is::shape_kind::integer:
+            o << key.integer;
+            break;
+        }
+    }
+
+    void write_args(const std::vector<lix::code::slot_ref_t>& args) {
+        auto arg_iter = args.begin();
+        auto arg_end  = args.end();
+        while (arg_iter != arg_end) {
+            o << *arg_iter++;
+            if (arg_iter != arg_end) {
+                o << ", ";
+            }
+        }
+        o << ')';
+    }
 };
 }  // namespace
 
@@ -18,12 +18,12 @@ struct ret {
     slot_ref_t slot;
 };
 struct call {
-    slot_ref_t fn;
-    slot_ref_t arg;
+    slot_ref_t              fn;
+    std::vector<slot_ref_t> args;
 };
 struct tail {
-    slot_ref_t fn;
-    slot_ref_t arg;
+    slot_ref_t              fn;
+    std::vector<slot_ref_t> args;
 };
 struct add {
     slot_ref_t a;
@@ -67,10 +67,12 @@ struct const_symbol {
     explicit const_symbol(lix::symbol s)
         : sym(s) {}
 };
-struct const_str {
-    std::string string;
-    explicit const_str(std::string s)
-        : string(std::move(s)) {}
+/**
+ * Push the value at `index` in the constant pool of the code. The value was
+ * built along with the code, so this only copies a reference to it.
+ */
+struct load_const {
+    std::size_t index;
 };
 struct hard_match {
     slot_ref_t lhs;
@@ -190,6 +192,162 @@ struct apply {
 struct raise {
     slot_ref_t arg;
 };
+/**
+ * The first instruction of a function after its frame_id. A call leaves its
+ * arguments in the slots following the captures. This pads them with
+ * placeholders up to the largest arity of any clause, so that the slots of
+ * the function body are the same no matter how many arguments were given.
+ * If there are more arguments than that, jumps to `overflow` instead.
+ */
+struct enter_args {
+    slot_ref_t    first;
+    std::int64_t  arity;
+    inst_offset_t overflow;
+};
+/// Test whether the current function was called with the given number of arguments
+struct test_arity {
+    std::int64_t arity;
+};
+/**
+ * Replace the arguments of the current function, beginning at `first`, with a
+ * single tuple of those arguments. Used to report a call that matched no
+ * clause.
+ */
+struct collect_args {
+    slot_ref_t first;
+};
+
+/// The outermost shapes of value that `switch_shape` can tell apart
+enum class shape_kind : std::uint8_t {
+    tuple,
+    tagged_tuple,
+    empty_list,
+    nonempty_list,
+    symbol,
+    integer,
+};
+/**
+ * A shape of value. `integer` is the arity of a tuple, or the value of an
+ * integer. `sym` is the value of a symbol, or the first element of a tagged
+ * tuple.
+ */
+struct shape_key {
+    shape_kind   kind    = shape_kind::tuple;
+    std::int64_t integer = 0;
+    lix::symbol  sym{""};
+};
+inline bool operator==(const shape_key& l, const shape_key& r) {
+    return l.kind == r.kind && l.integer == r.integer && l.sym == r.sym;
+}
+struct shape_case {
+    shape_key     key;
+    inst_offset_t target;
+};
+/**
+ * Jump to the target of the first case whose shape the subject has, or to
+ * `otherwise`. Selects the clauses of a `case` or `fn` that may match before
+ * any of them are tried.
+ */
+struct switch_shape {
+    slot_ref_t              subject;
+    std::vector<shape_case> cases;
+    inst_offset_t           otherwise;
+};
+/**
+ * Test whether the subject is a tuple of the given arity. If it is, push each
+ * of its elements in turn. Together with the other match instructions, this
+ * takes a pattern apart without building it as a value.
+ */
+struct match_tuple {
+    slot_ref_t   subject;
+    std::int64_t arity;
+};
+/// Test whether the subject is a list of the given length, and push its elements if so
+struct match_list {
+    slot_ref_t   subject;
+    std::int64_t length;
+};
+/// Test whether the subject is a non-empty list, and push its head and tail if so
+struct match_cons {
+    slot_ref_t subject;
+};
+/// Test whether two values are equal
+struct test_equal {
+    slot_ref_t a;
+    slot_ref_t b;
+};
+/// Raise a `badmatch` of the subject if the last test failed
+struct check_match {
+    slot_ref_t subject;
+};
+/**
+ * A tail call of a module function to itself. Replaces the arguments of the
+ * current call, beginning at `first`, with the values in `args`, then jumps
+ * back to `entry`, the enter_args of the function. The call loops within the
+ * current frame instead of looking up the function and replacing the frame.
+ */
+struct tail_self {
+    slot_ref_t              first;
+    std::vector<slot_ref_t> args;
+    inst_offset_t           entry;
+};
+
+/*
+ * Superinstructions. The optimizer (see optimize.hpp) fuses a test that is
+ * followed by a false_jump into one of these. Each sets the test state like
+ * the test it replaces, and jumps to `target` if the test failed.
+ */
+/// test_arity, then false_jump
+struct test_arity_jump {
+    std::int64_t  arity;
+    inst_offset_t target;
+};
+/// match_tuple, then false_jump
+struct match_tuple_jump {
+    slot_ref_t    subject;
+    std::int64_t  arity;
+    inst_offset_t target;
+};
+/// match_list, then false_jump
+struct match_list_jump {
+    slot_ref_t    subject;
+    std::int64_t  length;
+    inst_offset_t target;
+};
+/// match_cons, then false_jump
+struct match_cons_jump {
+    slot_ref_t    subject;
+    inst_offset_t target;
+};
+/// test_equal, then false_jump
+struct test_equal_jump {
+    slot_ref_t    a;
+    slot_ref_t    b;
+    inst_offset_t target;
+};
+/// test_equal against a constant symbol, then false_jump
+struct test_symbol_jump {
+    slot_ref_t    subject;
+    lix::symbol   sym;
+    inst_offset_t target;
+};
+/// test_equal against a constant integer, then false_jump
+struct test_int_jump {
+    slot_ref_t    subject;
+    std::int64_t  value;
+    inst_offset_t target;
+};
+/**
+ * hard_match, then an unconditional jump. If `move_rhs` is set, the value of
+ * `rhs` is discarded at the target, so binding it may move it rather than
+ * copy it.
+ */
+struct hard_match_jump {
+    slot_ref_t    lhs;
+    slot_ref_t    rhs;
+    inst_offset_t target;
+    bool          move_rhs = false;
+};
 
 using any_var = std::variant<ret,
                              call,
@@ -207,7 +365,7 @@ using any_var = std::variant<ret,
                              const_int,
                              const_real,
                              const_symbol,
-                             const_str,
+                             load_const,
                              hard_match,
                              try_match,
                              try_match_conj,
@@ -239,7 +397,25 @@ using any_var = std::variant<ret,
                              mk_closure,
                              mk_cons,
                              push_front,
-                             frame_id>;
+                             frame_id,
+                             enter_args,
+                             test_arity,
+                             collect_args,
+                             switch_shape,
+                             match_tuple,
+                             match_list,
+                             match_cons,
+                             test_equal,
+                             check_match,
+                             tail_self,
+                             test_arity_jump,
+                             match_tuple_jump,
+                             match_list_jump,
+                             match_cons_jump,
+                             test_equal_jump,
+                             test_symbol_jump,
+                             test_int_jump,
+                             hard_match_jump>;
 
 }  // namespace is_types
 
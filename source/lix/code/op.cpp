@@ -0,0 +1,137 @@
+#include "op.hpp"
+
+#include <limits>
+
+using namespace lix::code;
+
+namespace {
+
+namespace is = lix::code::is_types;
+
+std::uint32_t narrow(std::size_t n) {
+    assert(n <= (std::numeric_limits<std::uint32_t>::max)() && "Operand too large to lower");
+    return static_cast<std::uint32_t>(n);
+}
+
+struct lowering_visitor {
+    op& o;
+
+    void operator()(is::ret r) { o.a = narrow(r.slot.index); }
+    void operator()(const is::call& c) { o.a = narrow(c.fn.index); }
+    void operator()(const is::tail& t) { o.a = narrow(t.fn.index); }
+    void operator()(is::add a) { binary(a.a, a.b); }
+    void operator()(is::sub s) { binary(s.a, s.b); }
+    void operator()(is::mul m) { binary(m.a, m.b); }
+    void operator()(is::div d) { binary(d.a, d.b); }
+    void operator()(is::eq e) { binary(e.a, e.b); }
+    void operator()(is::neq n) { binary(n.a, n.b); }
+    void operator()(is::concat c) { binary(c.a, c.b); }
+    void operator()(is::negate n) { o.a = narrow(n.arg.index); }
+    void operator()(is::const_int i) { o.imm.integer = i.value; }
+    void operator()(is::const_real r) { o.imm.real = r.value; }
+    void operator()(is::const_symbol s) { o.imm.symbol = s.sym; }
+    void operator()(is::load_const c) { o.a = narrow(c.index); }
+    void operator()(is::hard_match m) { binary(m.lhs, m.rhs); }
+    void operator()(is::try_match m) { binary(m.lhs, m.rhs); }
+    void operator()(is::try_match_conj m) { binary(m.lhs, m.rhs); }
+    void operator()(is::const_binding_slot s) { o.a = narrow(s.slot.index); }
+    void operator()(is::mk_tuple_1 t) { o.a = narrow(t.a.index); }
+    void operator()(is::mk_tuple_2 t) { binary(t.a, t.b); }
+    void operator()(is::mk_tuple_3 t) {
+        binary(t.a, t.b);
+        o.c = narrow(t.c.index);
+    }
+    void operator()(is::jump j) { o.a = narrow(j.target.index); }
+    void operator()(is::test_true t) { o.a = narrow(t.slot.index); }
+    void operator()(is::false_jump j) { o.a = narrow(j.target.index); }
+    void operator()(is::rewind r) { o.a = narrow(r.slot.index); }
+    void operator()(is::no_clause n) { o.a = narrow(n.unmatched.index); }
+    void operator()(is::dot d) { binary(d.object, d.attr_name); }
+    void operator()(is::is_list i) { o.a = narrow(i.arg.index); }
+    void operator()(is::is_symbol i) { o.a = narrow(i.arg.index); }
+    void operator()(is::is_string i) { o.a = narrow(i.arg.index); }
+    void operator()(is::to_string t) { o.a = narrow(t.arg.index); }
+    void operator()(is::inspect i) { o.a = narrow(i.arg.index); }
+    void operator()(is::raise r) { o.a = narrow(r.arg.index); }
+    void operator()(is::apply a) {
+        binary(a.mod, a.fn);
+        o.c = narrow(a.arglist.index);
+    }
+    void operator()(is::mk_cons c) { binary(c.lhs, c.rhs); }
+    void operator()(is::push_front p) { binary(p.elem, p.list); }
+    void operator()(const is::frame_id& f) { o.imm.symbol = lix::symbol(f.id); }
+    void operator()(is::enter_args e) {
+        o.a = narrow(e.first.index);
+        o.b = narrow(static_cast<std::size_t>(e.arity));
+        o.c = narrow(e.overflow.index);
+    }
+    void operator()(is::test_arity t) { o.a = narrow(static_cast<std::size_t>(t.arity)); }
+    void operator()(is::collect_args c) { o.a = narrow(c.first.index); }
+    void operator()(is::match_tuple m) {
+        o.a = narrow(m.subject.index);
+        o.b = narrow(static_cast<std::size_t>(m.arity));
+    }
+    void operator()(is::match_list m) {
+        o.a = narrow(m.subject.index);
+        o.b = narrow(static_cast<std::size_t>(m.length));
+    }
+    void operator()(is::match_cons m) { o.a = narrow(m.subject.index); }
+    void operator()(is::test_equal t) { binary(t.a, t.b); }
+    void operator()(is::check_match c) { o.a = narrow(c.subject.index); }
+    void operator()(is::test_arity_jump t) {
+        o.a = narrow(static_cast<std::size_t>(t.arity));
+        o.c = narrow(t.target.index);
+    }
+    void operator()(is::match_tuple_jump m) {
+        o.a = narrow(m.subject.index);
+        o.b = narrow(static_cast<std::size_t>(m.arity));
+        o.c = narrow(m.target.index);
+    }
+    void operator()(is::match_list_jump m) {
+        o.a = narrow(m.subject.index);
+        o.b = narrow(static_cast<std::size_t>(m.length));
+        o.c = narrow(m.target.index);
+    }
+    void operator()(is::match_cons_jump m) {
+        o.a = narrow(m.subject.index);
+        o.c = narrow(m.target.index);
+    }
+    void operator()(is::test_equal_jump t) {
+        binary(t.a, t.b);
+        o.c = narrow(t.target.index);
+    }
+    void operator()(is::test_symbol_jump t) {
+        o.a          = narrow(t.subject.index);
+        o.c          = narrow(t.target.index);
+        o.imm.symbol = t.sym;
+    }
+    void operator()(is::test_int_jump t) {
+        o.a           = narrow(t.subject.index);
+        o.c           = narrow(t.target.index);
+        o.imm.integer = t.value;
+    }
+    void operator()(is::hard_match_jump m) {
+        binary(m.lhs, m.rhs);
+        o.c           = narrow(m.target.index);
+        o.imm.integer = m.move_rhs ? 1 : 0;
+    }
+
+    // Everything else is read back from the variant form through `src`
+    template <typename Other>
+    void operator()(const Other&) {}
+
+    void binary(slot_ref_t a, slot_ref_t b) {
+        o.a = narrow(a.index);
+        o.b = narrow(b.index);
+    }
+};
+
+}  // namespace
+
+op lix::code::lower(const instr& in) {
+    op ret;
+    ret.code = static_cast<opcode>(in.instr_var().index());
+    ret.src  = &in;
+    in.visit(lowering_visitor{ret});
+    return ret;
+}
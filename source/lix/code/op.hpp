@@ -0,0 +1,152 @@
+#ifndef LIX_CODE_OP_HPP_INCLUDED
+#define LIX_CODE_OP_HPP_INCLUDED
+
+#include <lix/code/instr.hpp>
+#include <lix/symbol.hpp>
+#include <lix/value_fwd.hpp>
+
+#include <cinttypes>
+#include <type_traits>
+#include <variant>
+
+namespace lix::code {
+
+/**
+ * The opcodes of the lowered instruction stream. The order here MUST match the
+ * order of the alternatives in is_types::any_var, as lowering an instruction
+ * is just a cast of the variant index. (This is checked below.)
+ */
+#define LIX_CODE_OPCODES(X)                                                                        \
+    X(ret)                                                                                         \
+    X(call)                                                                                        \
+    X(tail)                                                                                        \
+    X(call_mfa)                                                                                    \
+    X(tail_mfa)                                                                                    \
+    X(add)                                                                                         \
+    X(sub)                                                                                         \
+    X(mul)                                                                                         \
+    X(div)                                                                                         \
+    X(eq)                                                                                          \
+    X(neq)                                                                                         \
+    X(concat)                                                                                      \
+    X(negate)                                                                                      \
+    X(const_int)                                                                                   \
+    X(const_real)                                                                                  \
+    X(const_symbol)                                                                                \
+    X(load_const)                                                                                  \
+    X(hard_match)                                                                                  \
+    X(try_match)                                                                                   \
+    X(try_match_conj)                                                                              \
+    X(const_binding_slot)                                                                          \
+    X(mk_tuple_0)                                                                                  \
+    X(mk_tuple_1)                                                                                  \
+    X(mk_tuple_2)                                                                                  \
+    X(mk_tuple_3)                                                                                  \
+    X(mk_tuple_4)                                                                                  \
+    X(mk_tuple_5)                                                                                  \
+    X(mk_tuple_6)                                                                                  \
+    X(mk_tuple_7)                                                                                  \
+    X(mk_tuple_n)                                                                                  \
+    X(mk_list)                                                                                     \
+    X(mk_map)                                                                                      \
+    X(jump)                                                                                        \
+    X(test_true)                                                                                   \
+    X(false_jump)                                                                                  \
+    X(rewind)                                                                                      \
+    X(no_clause)                                                                                   \
+    X(dot)                                                                                         \
+    X(is_list)                                                                                     \
+    X(is_symbol)                                                                                   \
+    X(is_string)                                                                                   \
+    X(to_string)                                                                                   \
+    X(inspect)                                                                                     \
+    X(apply)                                                                                       \
+    X(raise)                                                                                       \
+    X(mk_closure)                                                                                  \
+    X(mk_cons)                                                                                     \
+    X(push_front)                                                                                  \
+    X(frame_id)                                                                                    \
+    X(enter_args)                                                                                  \
+    X(test_arity)                                                                                  \
+    X(collect_args)                                                                                \
+    X(switch_shape)                                                                                \
+    X(match_tuple)                                                                                 \
+    X(match_list)                                                                                  \
+    X(match_cons)                                                                                  \
+    X(test_equal)                                                                                  \
+    X(check_match)                                                                                 \
+    X(tail_self)                                                                                   \
+    X(test_arity_jump)                                                                             \
+    X(match_tuple_jump)                                                                            \
+    X(match_list_jump)                                                                             \
+    X(match_cons_jump)                                                                             \
+    X(test_equal_jump)                                                                             \
+    X(test_symbol_jump)                                                                            \
+    X(test_int_jump)                                                                               \
+    X(hard_match_jump)
+
+enum class opcode : std::uint8_t {
+#define X(name) name,
+    LIX_CODE_OPCODES(X)
+#undef X
+};
+
+#define X(name)                                                                                    \
+    static_assert(std::is_same<std::variant_alternative_t<static_cast<std::size_t>(opcode::name),  \
+                                                          is_types::any_var>,                      \
+                               is_types::name>::value,                                             \
+                  "Opcode list is out of sync with is_types::any_var for '" #name "'");
+LIX_CODE_OPCODES(X)
+#undef X
+
+static_assert(std::variant_size<is_types::any_var>::value
+                  == static_cast<std::size_t>(opcode::hard_match_jump) + 1,
+              "Opcode list is out of sync with is_types::any_var");
+
+/**
+ * A single lowered instruction. Lowered instructions are fixed-width and are
+ * laid out densely so that the executor can dispatch on `code` alone, without
+ * visiting the instruction variant.
+ *
+ * Instructions with only slot and offset operands carry them inline in `a`,
+ * `b`, and `c`. Constants, and the interned name of a frame_id, are held in
+ * `imm`. Instructions with variable-width operands (call_mfa, mk_list, ...)
+ * refer back to their variant form via `src`. call_mfa and tail_mfa hold the
+ * index of their inline cache site in `a` (see call_cache_table). call and
+ * tail hold their function slot in `a`, and their arguments in `src`.
+ * load_const holds the address of its value in the constant pool of the code,
+ * which is filled in when the code is lowered (see code::constants()).
+ */
+struct op {
+    opcode        code;
+    std::uint32_t a = 0;
+    std::uint32_t b = 0;
+    std::uint32_t c = 0;
+    union immediate {
+        std::int64_t      integer;
+        double            real;
+        lix::symbol       symbol;
+        const lix::value* constant;
+        immediate()
+            : integer(0) {}
+    } imm;
+    const instr* src = nullptr;
+
+    template <typename Instr>
+    const Instr& get() const noexcept {
+        assert(src);
+        auto ptr = std::get_if<Instr>(&src->instr_var());
+        assert(ptr && "Lowered op does not hold the requested instruction");
+        return *ptr;
+    }
+};
+
+/**
+ * Lower a single instruction into its fixed-width form. The given instruction
+ * must outlive the returned op.
+ */
+op lower(const instr&);
+
+}  // namespace lix::code
+
+#endif  // LIX_CODE_OP_HPP_INCLUDED
@@ -0,0 +1,968 @@
+#include "optimize.hpp"
+
+#include <lix/code/instr.hpp>
+#include <lix/value.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace lix::code;
+
+namespace {
+
+namespace is = lix::code::is_types;
+
+using program       = std::vector<instr>;
+using constant_pool = std::vector<lix::value>;
+
+/// The depth of the stack before an instruction runs, if it is always the same
+using depth_t = std::optional<std::size_t>;
+
+/**
+ * A slot operand that is a position on the stack rather than a value to be
+ * read, such as the depth to rewind to.
+ */
+struct position {
+    slot_ref_t& ref;
+};
+
+/**
+ * The slot operands of each instruction. Every instruction must be listed, so
+ * that adding one without telling the optimizer about it fails to compile.
+ */
+// clang-format off
+auto slots(is::ret& i)                { return std::tie(i.slot); }
+auto slots(is::call& i)               { return std::tie(i.fn, i.args); }
+auto slots(is::tail& i)               { return std::tie(i.fn, i.args); }
+auto slots(is::call_mfa& i)           { return std::tie(i.args); }
+auto slots(is::tail_mfa& i)           { return std::tie(i.args); }
+auto slots(is::add& i)                { return std::tie(i.a, i.b); }
+auto slots(is::sub& i)                { return std::tie(i.a, i.b); }
+auto slots(is::mul& i)                { return std::tie(i.a, i.b); }
+auto slots(is::div& i)                { return std::tie(i.a, i.b); }
+auto slots(is::eq& i)                 { return std::tie(i.a, i.b); }
+auto slots(is::neq& i)                { return std::tie(i.a, i.b); }
+auto slots(is::concat& i)             { return std::tie(i.a, i.b); }
+auto slots(is::negate& i)             { return std::tie(i.arg); }
+auto slots(is::const_int&)            { return std::tie(); }
+auto slots(is::const_real&)           { return std::tie(); }
+auto slots(is::const_symbol&)         { return std::tie(); }
+auto slots(is::load_const&)           { return std::tie(); }
+auto slots(is::hard_match& i)         { return std::tie(i.lhs, i.rhs); }
+auto slots(is::try_match& i)          { return std::tie(i.lhs, i.rhs); }
+auto slots(is::try_match_conj& i)     { return std::tie(i.lhs, i.rhs); }
+auto slots(is::const_binding_slot& i) { return std::make_tuple(position{i.slot}); }
+auto slots(is::mk_tuple_0&)           { return std::tie(); }
+auto slots(is::mk_tuple_1& i)         { return std::tie(i.a); }
+auto slots(is::mk_tuple_2& i)         { return std::tie(i.a, i.b); }
+auto slots(is::mk_tuple_3& i)         { return std::tie(i.a, i.b, i.c); }
+auto slots(is::mk_tuple_4& i)         { return std::tie(i.a, i.b, i.c, i.d); }
+auto slots(is::mk_tuple_5& i)         { return std::tie(i.a, i.b, i.c, i.d, i.e); }
+auto slots(is::mk_tuple_6& i)         { return std::tie(i.a, i.b, i.c, i.d, i.e, i.f); }
+auto slots(is::mk_tuple_7& i)         { return std::tie(i.a, i.b, i.c, i.d, i.e, i.f, i.g); }
+auto slots(is::mk_tuple_n& i)         { return std::tie(i.slots); }
+auto slots(is::mk_list& i)            { return std::tie(i.slots); }
+auto slots(is::mk_map& i)             { return std::tie(i.slots); }
+auto slots(is::jump&)                 { return std::tie(); }
+auto slots(is::test_true& i)          { return std::tie(i.slot); }
+auto slots(is::false_jump&)           { return std::tie(); }
+auto slots(is::rewind& i)             { return std::make_tuple(position{i.slot}); }
+auto slots(is::no_clause& i)          { return std::tie(i.unmatched); }
+auto slots(is::dot& i)                { return std::tie(i.object, i.attr_name); }
+auto slots(is::is_list& i)            { return std::tie(i.arg); }
+auto slots(is::is_symbol& i)          { return std::tie(i.arg); }
+auto slots(is::is_string& i)          { return std::tie(i.arg); }
+auto slots(is::to_string& i)          { return std::tie(i.arg); }
+auto slots(is::inspect& i)            { return std::tie(i.arg); }
+auto slots(is::apply& i)              { return std::tie(i.mod, i.fn, i.arglist); }
+auto slots(is::raise& i)              { return std::tie(i.arg); }
+auto slots(is::mk_closure& i)         { return std::tie(i.captures); }
+auto slots(is::mk_cons& i)            { return std::tie(i.lhs, i.rhs); }
+auto slots(is::push_front& i)         { return std::tie(i.elem, i.list); }
+auto slots(is::frame_id&)             { return std::tie(); }
+auto slots(is::enter_args& i)         { return std::make_tuple(position{i.first}); }
+auto slots(is::test_arity&)           { return std::tie(); }
+auto slots(is::collect_args& i)       { return std::make_tuple(position{i.first}); }
+auto slots(is::switch_shape& i)       { return std::tie(i.subject); }
+auto slots(is::match_tuple& i)        { return std::tie(i.subject); }
+auto slots(is::match_list& i)         { return std::tie(i.subject); }
+auto slots(is::match_cons& i)         { return std::tie(i.subject); }
+auto slots(is::test_equal& i)         { return std::tie(i.a, i.b); }
+auto slots(is::check_match& i)        { return std::tie(i.subject); }
+auto slots(is::tail_self& i)          { return std::tuple<position, std::vector<slot_ref_t>&>{
+                                                   position{i.first}, i.args}; }
+auto slots(is::test_arity_jump&)      { return std::tie(); }
+auto slots(is::match_tuple_jump& i)   { return std::tie(i.subject); }
+auto slots(is::match_list_jump& i)    { return std::tie(i.subject); }
+auto slots(is::match_cons_jump& i)    { return std::tie(i.subject); }
+auto slots(is::test_equal_jump& i)    { return std::tie(i.a, i.b); }
+auto slots(is::test_symbol_jump& i)   { return std::tie(i.subject); }
+auto slots(is::test_int_jump& i)      { return std::tie(i.subject); }
+auto slots(is::hard_match_jump& i)    { return std::tie(i.lhs, i.rhs); }
+// clang-format on
+
+/// Calls `fn(slot_ref_t&, bool is_position)` for each slot operand it is given
+template <typename Fn>
+struct slot_visitor {
+    Fn& fn;
+    void operator()(slot_ref_t& s) { fn(s, false); }
+    void operator()(position p) { fn(p.ref, true); }
+    void operator()(std::vector<slot_ref_t>& v) {
+        for (auto& s : v) {
+            fn(s, false);
+        }
+    }
+};
+
+/// Call `fn(slot_ref_t&, bool is_position)` for each slot operand of an instruction
+template <typename Fn>
+void for_each_slot(instr& in, Fn&& fn) {
+    std::visit(
+        [&](auto& i) {
+            std::apply([&](auto&&... slot) { (slot_visitor<Fn>{fn}(slot), ...); }, slots(i));
+        },
+        in.instr_var());
+}
+
+/**
+ * Calls `fn(inst_offset_t&)` for each instruction offset of an instruction.
+ * Those are the branch targets, and also where the body of a closure begins
+ * and ends.
+ */
+template <typename Fn>
+struct offset_visitor {
+    Fn& fn;
+    void operator()(is::jump& j) { fn(j.target); }
+    void operator()(is::false_jump& j) { fn(j.target); }
+    void operator()(is::switch_shape& sw) {
+        for (auto& c : sw.cases) {
+            fn(c.target);
+        }
+        fn(sw.otherwise);
+    }
+    void operator()(is::enter_args& e) { fn(e.overflow); }
+    void operator()(is::mk_closure& c) {
+        fn(c.code_begin);
+        fn(c.code_end);
+    }
+    void operator()(is::tail_self& t) { fn(t.entry); }
+    void operator()(is::test_arity_jump& t) { fn(t.target); }
+    void operator()(is::match_tuple_jump& m) { fn(m.target); }
+    void operator()(is::match_list_jump& m) { fn(m.target); }
+    void operator()(is::match_cons_jump& m) { fn(m.target); }
+    void operator()(is::test_equal_jump& t) { fn(t.target); }
+    void operator()(is::test_symbol_jump& t) { fn(t.target); }
+    void operator()(is::test_int_jump& t) { fn(t.target); }
+    void operator()(is::hard_match_jump& m) { fn(m.target); }
+    template <typename Other>
+    void operator()(Other&) {}
+};
+
+template <typename Fn>
+void for_each_offset(instr& in, Fn&& fn) {
+    std::visit(offset_visitor<Fn>{fn}, in.instr_var());
+}
+
+/// Call `fn(inst_offset_t&)` for each place an instruction may jump to within the frame
+template <typename Fn>
+void for_each_branch(instr& in, Fn&& fn) {
+    if (std::holds_alternative<is::mk_closure>(in.instr_var())) {
+        return;
+    }
+    for_each_offset(in, fn);
+}
+
+bool is_match(const instr& in) {
+    auto& var = in.instr_var();
+    return std::holds_alternative<is::match_tuple>(var)
+        || std::holds_alternative<is::match_list>(var)
+        || std::holds_alternative<is::match_cons>(var);
+}
+
+bool is_const(const instr& in) {
+    auto& var = in.instr_var();
+    return std::holds_alternative<is::const_int>(var) || std::holds_alternative<is::const_real>(var)
+        || std::holds_alternative<is::const_symbol>(var)
+        || std::holds_alternative<is::load_const>(var);
+}
+
+/// A way control may leave an instruction, and the depth of the stack along it
+struct edge {
+    std::size_t target;
+    depth_t     depth;
+    /// Whether this is a jump rather than falling through to the next instruction
+    bool branch;
+};
+
+/**
+ * Where control may go after an instruction, given the depth of the stack
+ * before it. Match instructions push their elements only if they match, and
+ * are followed by a test of whether they did, so falling through from them
+ * assumes that they matched.
+ */
+struct flow_visitor {
+    const program&     prog;
+    std::size_t        index;
+    depth_t            depth;
+    std::vector<edge>& out;
+
+    static depth_t plus(depth_t d, std::size_t n) {
+        return d ? depth_t{*d + n} : std::nullopt;
+    }
+    void fall(depth_t d) { out.push_back({index + 1, d, false}); }
+    void push(std::size_t n) { fall(plus(depth, n)); }
+    void branch(inst_offset_t target, depth_t d) { out.push_back({target.index, d, true}); }
+
+    // Instructions that push their result
+    void operator()(const is::call&) { push(1); }
+    void operator()(const is::tail&) { push(1); }
+    void operator()(const is::call_mfa&) { push(1); }
+    void operator()(const is::tail_mfa&) { push(1); }
+    void operator()(is::add) { push(1); }
+    void operator()(is::sub) { push(1); }
+    void operator()(is::mul) { push(1); }
+    void operator()(is::div) { push(1); }
+    void operator()(is::eq) { push(1); }
+    void operator()(is::neq) { push(1); }
+    void operator()(is::concat) { push(1); }
+    void operator()(is::negate) { push(1); }
+    void operator()(is::const_int) { push(1); }
+    void operator()(is::const_real) { push(1); }
+    void operator()(is::const_symbol) { push(1); }
+    void operator()(is::load_const) { push(1); }
+    void operator()(is::const_binding_slot) { push(1); }
+    void operator()(is::mk_tuple_0) { push(1); }
+    void operator()(is::mk_tuple_1) { push(1); }
+    void operator()(is::mk_tuple_2) { push(1); }
+    void operator()(is::mk_tuple_3) { push(1); }
+    void operator()(is::mk_tuple_4) { push(1); }
+    void operator()(is::mk_tuple_5) { push(1); }
+    void operator()(is::mk_tuple_6) { push(1); }
+    void operator()(is::mk_tuple_7) { push(1); }
+    void operator()(const is::mk_tuple_n&) { push(1); }
+    void operator()(const is::mk_list&) { push(1); }
+    void operator()(const is::mk_map&) { push(1); }
+    void operator()(const is::mk_closure&) { push(1); }
+    void operator()(is::mk_cons) { push(1); }
+    void operator()(is::push_front) { push(1); }
+    void operator()(is::dot) { push(1); }
+    void operator()(is::is_list) { push(1); }
+    void operator()(is::is_symbol) { push(1); }
+    void operator()(is::is_string) { push(1); }
+    void operator()(is::to_string) { push(1); }
+    void operator()(is::inspect) { push(1); }
+    void operator()(is::apply) { push(1); }
+
+    // Instructions that leave the stack as it is
+    void operator()(is::hard_match) { push(0); }
+    void operator()(is::try_match) { push(0); }
+    void operator()(is::try_match_conj) { push(0); }
+    void operator()(is::test_true) { push(0); }
+    void operator()(const is::frame_id&) { push(0); }
+    void operator()(is::test_arity) { push(0); }
+    void operator()(is::test_equal) { push(0); }
+    void operator()(is::check_match) { push(0); }
+
+    void operator()(is::match_tuple m) { push(static_cast<std::size_t>(m.arity)); }
+    void operator()(is::match_list m) { push(static_cast<std::size_t>(m.length)); }
+    void operator()(is::match_cons) { push(2); }
+
+    void operator()(is::ret) {}
+    void operator()(is::raise) {}
+    void operator()(is::no_clause) {}
+    void operator()(is::jump j) { branch(j.target, depth); }
+    void operator()(is::false_jump j) {
+        // After a failed match, the stack is as it was before the match
+        const bool after_match = index != 0 && is_match(prog[index - 1]);
+        branch(j.target, after_match ? std::nullopt : depth);
+        push(0);
+    }
+    void operator()(is::rewind r) { fall(r.slot.index); }
+    void operator()(const is::switch_shape& sw) {
+        for (auto& c : sw.cases) {
+            branch(c.target, depth);
+        }
+        branch(sw.otherwise, depth);
+    }
+    void operator()(is::enter_args e) {
+        branch(e.overflow, std::nullopt);
+        fall(e.first.index + static_cast<std::size_t>(e.arity));
+    }
+    void operator()(is::collect_args c) { fall(c.first.index + 1); }
+    void operator()(const is::tail_self& t) { branch(t.entry, std::nullopt); }
+
+    void operator()(is::test_arity_jump t) {
+        branch(t.target, depth);
+        push(0);
+    }
+    void operator()(is::match_tuple_jump m) {
+        branch(m.target, depth);
+        push(static_cast<std::size_t>(m.arity));
+    }
+    void operator()(is::match_list_jump m) {
+        branch(m.target, depth);
+        push(static_cast<std::size_t>(m.length));
+    }
+    void operator()(is::match_cons_jump m) {
+        branch(m.target, depth);
+        push(2);
+    }
+    void operator()(is::test_equal_jump t) {
+        branch(t.target, depth);
+        push(0);
+    }
+    void operator()(is::test_symbol_jump t) {
+        branch(t.target, depth);
+        push(0);
+    }
+    void operator()(is::test_int_jump t) {
+        branch(t.target, depth);
+        push(0);
+    }
+    void operator()(is::hard_match_jump m) { branch(m.target, depth); }
+
+    template <typename Other>
+    void operator()(const Other&) = delete;
+};
+
+std::vector<edge> flow_of(const program& prog, std::size_t index, depth_t depth) {
+    std::vector<edge> out;
+    prog[index].visit(flow_visitor{prog, index, depth, out});
+    return out;
+}
+
+/// Integer arithmetic as the executor does it, or nothing if it would overflow or trap
+std::optional<std::int64_t> int_arith(const is::any_var& op, std::int64_t a, std::int64_t b) {
+    constexpr auto max = (std::numeric_limits<std::int64_t>::max)();
+    constexpr auto min = (std::numeric_limits<std::int64_t>::min)();
+    if (std::holds_alternative<is::add>(op)) {
+        if ((b > 0 && a > max - b) || (b < 0 && a < min - b)) {
+            return std::nullopt;
+        }
+        return a + b;
+    } else if (std::holds_alternative<is::sub>(op)) {
+        if ((b < 0 && a > max + b) || (b > 0 && a < min + b)) {
+            return std::nullopt;
+        }
+        return a - b;
+    } else if (std::holds_alternative<is::mul>(op)) {
+        if (a != 0 && b != 0
+            && (a > 0 ? (b > 0 ? a > max / b : b < min / a)
+                      : (b > 0 ? a < min / b : b < max / a))) {
+            return std::nullopt;
+        }
+        return a * b;
+    } else {
+        if (b == 0 || (a == min && b == -1)) {
+            return std::nullopt;
+        }
+        return a / b;
+    }
+}
+
+std::optional<double> as_real(const instr& in) {
+    if (auto i = std::get_if<is::const_int>(&in.instr_var())) {
+        return static_cast<double>(i->value);
+    } else if (auto r = std::get_if<is::const_real>(&in.instr_var())) {
+        return r->value;
+    }
+    return std::nullopt;
+}
+
+/// The string that a constant pushes, if it pushes one
+lix::opt_ref<const lix::string> as_string(const instr& in, const constant_pool& pool) {
+    if (auto load = std::get_if<is::load_const>(&in.instr_var())) {
+        return pool[load->index].as_string();
+    }
+    return lix::nullopt;
+}
+
+/// The index of a constant in `pool`, which is added to it unless it is there already
+std::size_t intern(constant_pool& pool, lix::value val) {
+    auto iter = std::find(pool.begin(), pool.end(), val);
+    if (iter != pool.end()) {
+        return static_cast<std::size_t>(iter - pool.begin());
+    }
+    pool.push_back(std::move(val));
+    return pool.size() - 1;
+}
+
+/// Fold add/sub/mul/div of two constants. New strings are interned in `pool`.
+std::optional<instr>
+fold_arith(const is::any_var& op, const instr* lhs, const instr* rhs, constant_pool& pool) {
+    if (!lhs || !rhs) {
+        return std::nullopt;
+    }
+    auto l_int = std::get_if<is::const_int>(&lhs->instr_var());
+    auto r_int = std::get_if<is::const_int>(&rhs->instr_var());
+    if (l_int && r_int) {
+        if (auto n = int_arith(op, l_int->value, r_int->value)) {
+            return instr(is::const_int{*n});
+        }
+        return std::nullopt;
+    }
+    auto l_real = as_real(*lhs);
+    auto r_real = as_real(*rhs);
+    if (l_real && r_real) {
+        if (std::holds_alternative<is::add>(op)) {
+            return instr(is::const_real{*l_real + *r_real});
+        } else if (std::holds_alternative<is::sub>(op)) {
+            return instr(is::const_real{*l_real - *r_real});
+        } else if (std::holds_alternative<is::mul>(op)) {
+            return instr(is::const_real{*l_real * *r_real});
+        } else if (*r_real != 0) {
+            return instr(is::const_real{*l_real / *r_real});
+        }
+        return std::nullopt;
+    }
+    auto l_str = as_string(*lhs, pool);
+    auto r_str = as_string(*rhs, pool);
+    if (l_str && r_str && std::holds_alternative<is::add>(op)) {
+        return instr(is::load_const{intern(pool, lix::string(*l_str + *r_str))});
+    }
+    return std::nullopt;
+}
+
+/// Whether two constants are equal, as the values they push would compare
+std::optional<bool> const_equal(const instr* lhs, const instr* rhs, const constant_pool& pool) {
+    if (!lhs || !rhs) {
+        return std::nullopt;
+    }
+    auto& l = lhs->instr_var();
+    auto& r = rhs->instr_var();
+    if (l.index() != r.index()) {
+        // Integers, reals, and symbols are never put in the constant pool, so
+        // a load_const cannot push the same value as the other constants
+        return false;
+    } else if (auto i = std::get_if<is::const_int>(&l)) {
+        return i->value == std::get<is::const_int>(r).value;
+    } else if (auto d = std::get_if<is::const_real>(&l)) {
+        return d->value == std::get<is::const_real>(r).value;
+    } else if (auto s = std::get_if<is::const_symbol>(&l)) {
+        return s->sym == std::get<is::const_symbol>(r).sym;
+    } else if (auto c = std::get_if<is::load_const>(&l)) {
+        return pool[c->index] == pool[std::get<is::load_const>(r).index];
+    }
+    return std::nullopt;
+}
+
+instr const_bool(bool b) { return is::const_symbol{lix::symbol(b ? "true" : "false")}; }
+
+/**
+ * Fold an instruction whose operands are all constants into the constant it
+ * would push. `constant(slot)` gives the constant instruction that pushed a
+ * slot, or null. `pool` is the constant pool of the code.
+ */
+template <typename Constant>
+std::optional<instr> fold(const instr& in, Constant&& constant, constant_pool& pool) {
+    auto& var = in.instr_var();
+    if (auto a = std::get_if<is::add>(&var)) {
+        return fold_arith(var, constant(a->a), constant(a->b), pool);
+    } else if (auto s = std::get_if<is::sub>(&var)) {
+        return fold_arith(var, constant(s->a), constant(s->b), pool);
+    } else if (auto m = std::get_if<is::mul>(&var)) {
+        return fold_arith(var, constant(m->a), constant(m->b), pool);
+    } else if (auto d = std::get_if<is::div>(&var)) {
+        return fold_arith(var, constant(d->a), constant(d->b), pool);
+    } else if (auto e = std::get_if<is::eq>(&var)) {
+        if (auto equal = const_equal(constant(e->a), constant(e->b), pool)) {
+            return const_bool(*equal);
+        }
+    } else if (auto n = std::get_if<is::neq>(&var)) {
+        if (auto equal = const_equal(constant(n->a), constant(n->b), pool)) {
+            return const_bool(!*equal);
+        }
+    } else if (auto neg = std::get_if<is::negate>(&var)) {
+        auto arg = constant(neg->arg);
+        auto sym = arg ? std::get_if<is::const_symbol>(&arg->instr_var()) : nullptr;
+        if (sym && (sym->sym == lix::symbol("true") || sym->sym == lix::symbol("false"))) {
+            return const_bool(sym->sym == lix::symbol("false"));
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * Runs the passes over a block of code until none of them finds anything more
+ * to do. Passes work on the instructions as a vector, and those that remove
+ * instructions renumber every offset that refers past them.
+ */
+class optimizer {
+    program         _prog;
+    constant_pool   _constants;
+    optimize_stats& _stats;
+
+    // The results of _analyze(), indexed by instruction
+    std::vector<char>                     _reached;
+    std::vector<char>                     _is_entry;
+    std::vector<char>                     _is_target;
+    std::vector<depth_t>                  _depth;
+    std::vector<std::vector<std::size_t>> _preds;
+
+    void        _analyze();
+    void        _compact(const std::vector<char>& dead);
+    std::size_t _thread(std::size_t target) const;
+
+    bool _clean_jumps();
+    bool _fuse();
+    bool _fold();
+    bool _remove_dead_consts();
+    bool _remove_dead_consts_once();
+    void _compact_constants();
+
+    std::optional<std::vector<std::size_t>> _dead_push_span(std::size_t);
+
+public:
+    optimizer(program prog, constant_pool constants, optimize_stats& stats)
+        : _prog(std::move(prog))
+        , _constants(std::move(constants))
+        , _stats(stats) {}
+
+    code run();
+};
+
+/**
+ * Find the instructions that can run, the depth of the stack before each of
+ * them, and where each of them can be reached from. The code is entered at
+ * the beginning, and at the beginning of each closure body that can be
+ * created.
+ */
+void optimizer::_analyze() {
+    const auto n = _prog.size();
+    _reached.assign(n, false);
+    _is_entry.assign(n, false);
+    _is_target.assign(n, false);
+    _depth.assign(n, std::nullopt);
+    _preds.assign(n, {});
+    if (n == 0) {
+        return;
+    }
+
+    std::vector<std::size_t> work;
+    auto                     reach = [&](std::size_t i, depth_t depth) {
+        assert(i < n && "Control leaves the code");
+        if (!_reached[i]) {
+            _reached[i] = true;
+            _depth[i]   = depth;
+            work.push_back(i);
+        } else if (_depth[i] && _depth[i] != depth) {
+            _depth[i] = std::nullopt;
+            work.push_back(i);
+        }
+    };
+    _is_entry[0] = true;
+    reach(0, 0);
+    while (!work.empty()) {
+        auto i = work.back();
+        work.pop_back();
+        if (auto clos = std::get_if<is::mk_closure>(&_prog[i].instr_var())) {
+            _is_entry[clos->code_begin.index] = true;
+            reach(clos->code_begin.index, std::nullopt);
+        }
+        for (auto& e : flow_of(_prog, i, _depth[i])) {
+            reach(e.target, e.depth);
+        }
+    }
+
+    for (auto i = 0u; i < n; ++i) {
+        if (!_reached[i]) {
+            continue;
+        }
+        for (auto& e : flow_of(_prog, i, _depth[i])) {
+            _preds[e.target].push_back(i);
+            if (e.branch) {
+                _is_target[e.target] = true;
+            }
+        }
+    }
+}
+
+/// Remove the given instructions. Offsets to a removed instruction go to the one after it.
+void optimizer::_compact(const std::vector<char>& dead) {
+    std::vector<std::size_t> new_index(_prog.size() + 1);
+    program                  kept;
+    kept.reserve(_prog.size());
+    for (auto i = 0u; i < _prog.size(); ++i) {
+        new_index[i] = kept.size();
+        if (!dead[i]) {
+            kept.push_back(std::move(_prog[i]));
+        }
+    }
+    new_index[_prog.size()] = kept.size();
+    for (auto& in : kept) {
+        for_each_offset(in, [&](inst_offset_t& off) { off.index = new_index[off.index]; });
+    }
+    _prog = std::move(kept);
+}
+
+/// Where control really goes when it jumps to `target`, skipping over jumps
+std::size_t optimizer::_thread(std::size_t target) const {
+    // Bounded, in case of a loop of jumps
+    for (auto hops = 0u; hops < _prog.size(); ++hops) {
+        auto j = std::get_if<is::jump>(&_prog[target].instr_var());
+        if (!j) {
+            break;
+        }
+        target = j->target.index;
+    }
+    return target;
+}
+
+/**
+ * Thread jumps to jumps, and remove unreachable instructions, jumps to the
+ * next instruction, and rewinds that don't change anything: those to the
+ * depth the stack already has, those followed by a rewind further down, and
+ * those just before a return of a slot below them.
+ */
+bool optimizer::_clean_jumps() {
+    _analyze();
+    const auto        n = _prog.size();
+    std::vector<char> dead(n, false);
+    bool              changed = false;
+    auto              remove  = [&](std::size_t i) {
+        dead[i] = true;
+        ++_stats.jumps;
+        changed = true;
+    };
+    for (auto i = 0u; i < n; ++i) {
+        if (dead[i]) {
+            continue;
+        } else if (!_reached[i]) {
+            remove(i);
+            continue;
+        }
+        for_each_branch(_prog[i], [&](inst_offset_t& off) {
+            auto dest = _thread(off.index);
+            if (dest != off.index) {
+                off.index = dest;
+                ++_stats.jumps;
+                changed = true;
+            }
+        });
+
+        auto& var  = _prog[i].instr_var();
+        auto  next = i + 1;
+        if (auto j = std::get_if<is::jump>(&var); j && j->target.index == next) {
+            remove(i);
+        } else if (auto fj = std::get_if<is::false_jump>(&var); fj && fj->target.index == next) {
+            remove(i);
+        } else if (auto r = std::get_if<is::rewind>(&var)) {
+            if (_depth[i] == r->slot.index) {
+                remove(i);
+            } else if (next == n) {
+                continue;
+            } else if (auto ret = std::get_if<is::ret>(&_prog[next].instr_var());
+                       ret && ret->slot.index < r->slot.index) {
+                // Returning discards the frame anyway
+                remove(i);
+            } else if (auto r2 = std::get_if<is::rewind>(&_prog[next].instr_var());
+                       r2 && r2->slot.index <= r->slot.index && !_is_target[next]
+                       && !_is_entry[next]) {
+                r->slot = r2->slot;
+                remove(next);
+            }
+        }
+    }
+    if (changed) {
+        _compact(dead);
+    }
+    return changed;
+}
+
+/// Fuse a test and the false_jump after it, and a hard_match and the jump after it
+bool optimizer::_fuse() {
+    _analyze();
+    const auto        n = _prog.size();
+    std::vector<char> dead(n, false);
+    bool              changed = false;
+    for (auto i = 0u; i + 1 < n; ++i) {
+        const auto next = i + 1;
+        if (!_reached[i] || _is_target[next] || _is_entry[next]) {
+            continue;
+        }
+        auto&                var = _prog[i].instr_var();
+        std::optional<instr> fused;
+        if (auto fj = std::get_if<is::false_jump>(&_prog[next].instr_var())) {
+            const auto target = fj->target;
+            if (auto t = std::get_if<is::test_arity>(&var)) {
+                fused = is::test_arity_jump{t->arity, target};
+            } else if (auto m = std::get_if<is::match_tuple>(&var)) {
+                fused = is::match_tuple_jump{m->subject, m->arity, target};
+            } else if (auto m = std::get_if<is::match_list>(&var)) {
+                fused = is::match_list_jump{m->subject, m->length, target};
+            } else if (auto m = std::get_if<is::match_cons>(&var)) {
+                fused = is::match_cons_jump{m->subject, target};
+            } else if (auto t = std::get_if<is::test_equal>(&var)) {
+                fused = is::test_equal_jump{t->a, t->b, target};
+            }
+        } else if (auto j = std::get_if<is::jump>(&_prog[next].instr_var())) {
+            if (auto m = std::get_if<is::hard_match>(&var)) {
+                // The result of a branch is matched into a slot below the
+                // rewind at the end of the branches, or is returned, so the
+                // value it is matched with needn't be copied
+                auto& target = _prog[j->target.index].instr_var();
+                auto  r      = std::get_if<is::rewind>(&target);
+                auto  ret    = std::get_if<is::ret>(&target);
+                bool  move   = (r && m->lhs.index < r->slot.index && r->slot.index <= m->rhs.index)
+                          || (ret && ret->slot != m->rhs);
+                fused     = is::hard_match_jump{m->lhs, m->rhs, j->target, move};
+                _stats.moves += move ? 1 : 0;
+            }
+        }
+        if (fused) {
+            _prog[i]   = std::move(*fused);
+            dead[next] = true;
+            ++_stats.fused;
+            changed = true;
+            ++i;
+        }
+    }
+    if (changed) {
+        _compact(dead);
+    }
+    return changed;
+}
+
+/**
+ * Fold operations on constants, and turn tests for equality with a constant
+ * symbol or integer into tests against an immediate. This follows which slots
+ * hold constants along straight-line code only.
+ */
+bool optimizer::_fold() {
+    _analyze();
+    bool                                    changed = false;
+    std::vector<std::optional<std::size_t>> consts;
+    auto constant = [&](slot_ref_t s) -> const instr* {
+        if (s.index < consts.size() && consts[s.index]) {
+            return &_prog[*consts[s.index]];
+        }
+        return nullptr;
+    };
+    for (auto i = 0u; i < _prog.size(); ++i) {
+        if (!_reached[i]) {
+            continue;
+        }
+        const bool straight = !_is_entry[i] && _preds[i].size() == 1 && _preds[i][0] == i - 1;
+        if (!straight || !_depth[i]) {
+            consts.clear();
+        }
+        if (!_depth[i]) {
+            continue;
+        }
+        consts.resize(*_depth[i]);
+
+        auto& in = _prog[i];
+        if (auto folded = fold(in, constant, _constants)) {
+            in = std::move(*folded);
+            ++_stats.folded;
+            changed = true;
+        } else if (auto t = std::get_if<is::test_equal_jump>(&in.instr_var())) {
+            auto against = [&](slot_ref_t c, slot_ref_t subject) -> std::optional<instr> {
+                auto k = constant(c);
+                if (!k) {
+                    return std::nullopt;
+                } else if (auto sym = std::get_if<is::const_symbol>(&k->instr_var())) {
+                    return instr(is::test_symbol_jump{subject, sym->sym, t->target});
+                } else if (auto n = std::get_if<is::const_int>(&k->instr_var())) {
+                    return instr(is::test_int_jump{subject, n->value, t->target});
+                }
+                return std::nullopt;
+            };
+            auto spec = against(t->a, t->b);
+            if (!spec) {
+                spec = against(t->b, t->a);
+            }
+            if (spec) {
+                in = std::move(*spec);
+                ++_stats.fused;
+                changed = true;
+            }
+        }
+
+        if (is_const(in)) {
+            consts.push_back(i);
+        } else if (std::holds_alternative<is::enter_args>(in.instr_var())
+                   || std::holds_alternative<is::collect_args>(in.instr_var())) {
+            // These replace slots below the top of the stack
+            consts.clear();
+        }
+    }
+    return changed;
+}
+
+/// Remove constants that nothing reads
+bool optimizer::_remove_dead_consts() {
+    bool changed = false;
+    while (_remove_dead_consts_once()) {
+        changed = true;
+    }
+    return changed;
+}
+
+/**
+ * Remove every constant that nothing reads and whose span doesn't overlap the
+ * span of another one being removed, with a single analysis and a single
+ * compaction. Removing a push only renumbers the slots within its span, so
+ * the analysis stays true for the rest of the code. Constants that had to be
+ * left are found on the next call.
+ */
+bool optimizer::_remove_dead_consts_once() {
+    _analyze();
+    const auto        n = _prog.size();
+    std::vector<char> dead(n, false);
+    std::vector<char> claimed(n, false);
+    bool              changed = false;
+    for (auto p = 0u; p < n; ++p) {
+        if (claimed[p] || !_reached[p] || !_depth[p] || !is_const(_prog[p])) {
+            continue;
+        }
+        auto span = _dead_push_span(p);
+        if (!span
+            || std::any_of(span->begin(), span->end(), [&](auto q) { return claimed[q]; })) {
+            continue;
+        }
+        const auto k = *_depth[p];
+        for (auto q : *span) {
+            claimed[q] = true;
+            for_each_slot(_prog[q], [&](slot_ref_t& s, bool) {
+                if (s.index > k) {
+                    --s.index;
+                }
+            });
+        }
+        claimed[p] = true;
+        dead[p]    = true;
+        ++_stats.dead_slots;
+        changed = true;
+    }
+    if (changed) {
+        _compact(dead);
+    }
+    return changed;
+}
+
+/**
+ * Find the span of the value pushed by the instruction at `p`: the
+ * instructions that run while it is on the stack, before it is rewound. If
+ * nothing in the span reads the value, it can be removed by renumbering the
+ * slots above it in the span, so those instructions must run only after `p`.
+ * Returns nothing if the value can't be removed.
+ */
+std::optional<std::vector<std::size_t>> optimizer::_dead_push_span(std::size_t p) {
+    const auto k = *_depth[p];
+    const auto n = _prog.size();
+
+    std::vector<char>        live(n, false);
+    std::vector<char>        done(n, false);
+    std::vector<std::size_t> work;
+    for (auto& e : flow_of(_prog, p, _depth[p])) {
+        work.push_back(e.target);
+    }
+    while (!work.empty()) {
+        auto q = work.back();
+        work.pop_back();
+        if (q == p || _is_entry[q]) {
+            return std::nullopt;
+        } else if (done[q]) {
+            continue;
+        }
+        done[q]   = true;
+        auto& in  = _prog[q];
+        auto& var = in.instr_var();
+        if (auto r = std::get_if<is::rewind>(&var); r && r->slot.index <= k) {
+            // The value is gone from here on
+            continue;
+        } else if (auto r = std::get_if<is::ret>(&var); r && r->slot.index < k) {
+            continue;
+        } else if (std::holds_alternative<is::enter_args>(var)
+                   || std::holds_alternative<is::collect_args>(var)) {
+            return std::nullopt;
+        }
+        bool reads = false;
+        for_each_slot(in, [&](slot_ref_t& s, bool) { reads = reads || s.index == k; });
+        if (reads) {
+            return std::nullopt;
+        }
+        live[q] = true;
+        if (auto t = std::get_if<is::tail_self>(&var)) {
+            // Replaces the arguments, below us, and rewinds to just above them
+            if (t->first.index + t->args.size() > k) {
+                return std::nullopt;
+            }
+            continue;
+        }
+        for (auto& e : flow_of(_prog, q, _depth[q])) {
+            work.push_back(e.target);
+        }
+    }
+
+    std::vector<std::size_t> span;
+    for (auto q = 0u; q < n; ++q) {
+        if (!live[q]) {
+            continue;
+        }
+        for (auto pred : _preds[q]) {
+            if (pred != p && !live[pred]) {
+                return std::nullopt;
+            }
+        }
+        span.push_back(q);
+    }
+    return span;
+}
+
+/// Drop the constants that no load_const refers to any more, and renumber the rest
+void optimizer::_compact_constants() {
+    constexpr auto           unused = (std::numeric_limits<std::size_t>::max)();
+    std::vector<std::size_t> new_index(_constants.size(), unused);
+    for (auto& in : _prog) {
+        if (auto load = std::get_if<is::load_const>(&in.instr_var())) {
+            new_index[load->index] = 0;
+        }
+    }
+    constant_pool kept;
+    for (auto i = 0u; i < _constants.size(); ++i) {
+        if (new_index[i] != unused) {
+            new_index[i] = kept.size();
+            kept.push_back(std::move(_constants[i]));
+        }
+    }
+    for (auto& in : _prog) {
+        if (auto load = std::get_if<is::load_const>(&in.instr_var())) {
+            load->index = new_index[load->index];
+        }
+    }
+    _constants = std::move(kept);
+}
+
+code optimizer::run() {
+    _stats.instrs_before += _prog.size();
+    // Each pass can uncover more work for the others. Every change shrinks or
+    // simplifies the code, so this settles after a few rounds.
+    for (auto round = 0; round < 16; ++round) {
+        bool changed = _clean_jumps();
+        changed      = _fuse() || changed;
+        changed      = _fold() || changed;
+        changed      = _remove_dead_consts() || changed;
+        if (!changed) {
+            break;
+        }
+    }
+    _compact_constants();
+    _stats.instrs_after += _prog.size();
+    return code(_prog.begin(), _prog.end(), std::move(_constants));
+}
+
+}  // namespace
+
+code lix::code::optimize(const code& c, optimize_stats* stats) {
+    optimize_stats local;
+    optimizer      opt{program(c.begin(), c.end()), c.constants(), stats ? *stats : local};
+    return opt.run();
+}
@@ -0,0 +1,48 @@
+#ifndef LIX_CODE_OPTIMIZE_HPP_INCLUDED
+#define LIX_CODE_OPTIMIZE_HPP_INCLUDED
+
+#include <lix/code/code.hpp>
+
+#include <cstddef>
+
+namespace lix::code {
+
+/// What `optimize()` did, totalled over the blocks of code it was given
+struct optimize_stats {
+    std::size_t instrs_before = 0;
+    std::size_t instrs_after  = 0;
+    /// Arithmetic and comparisons of constants replaced by their result
+    std::size_t folded = 0;
+    /// Pairs of instructions fused into a superinstruction
+    std::size_t fused = 0;
+    /// Constants removed because nothing reads the slot they push
+    std::size_t dead_slots = 0;
+    /// Jumps and rewinds removed or retargeted, and unreachable instructions removed
+    std::size_t jumps = 0;
+    /// Matches that may move their right-hand side instead of copying it
+    std::size_t moves = 0;
+};
+
+/**
+ * Optimize a block of code as the compiler emitted it. The result computes the
+ * same values, raises the same errors, and uses the same frame layout for
+ * closures, but usually in fewer instructions:
+ *
+ * - Arithmetic and comparisons on constants are folded into a constant.
+ * - A test followed by a false_jump is fused into a superinstruction, and
+ *   tests against a constant symbol or integer no longer push the constant.
+ * - A hard_match followed by a jump is fused, and moves the matched value if
+ *   the jump target rewinds it anyway.
+ * - Constants that nothing reads are removed, and the slots above them are
+ *   renumbered. The constant pool keeps only the values still loaded, and a
+ *   folded string that is already in it is not added again.
+ * - Jumps to jumps are threaded, and jumps to the next instruction, no-op and
+ *   consecutive rewinds, and unreachable instructions are removed.
+ *
+ * If `stats` is given, what was done is added to it.
+ */
+code optimize(const code&, optimize_stats* stats = nullptr);
+
+}  // namespace lix::code
+
+#endif  // LIX_CODE_OPTIMIZE_HPP_INCLUDED
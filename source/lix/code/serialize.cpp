@@ -0,0 +1,671 @@
+#include "serialize.hpp"
+
+#include <lix/code/instr.hpp>
+#include <lix/value.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace lix::code;
+
+namespace is = lix::code::is_types;
+
+void byte_writer::write_uint(std::uint64_t n) {
+    while (n >= 0x80) {
+        write_byte(static_cast<std::uint8_t>(n | 0x80));
+        n >>= 7;
+    }
+    write_byte(static_cast<std::uint8_t>(n));
+}
+
+void byte_writer::write_int(std::int64_t n) {
+    auto u = static_cast<std::uint64_t>(n);
+    write_uint((u << 1) ^ (n < 0 ? ~std::uint64_t(0) : 0));
+}
+
+void byte_writer::write_real(double d) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &d, sizeof bits);
+    for (auto i = 0; i < 8; ++i) {
+        write_byte(static_cast<std::uint8_t>(bits >> (i * 8)));
+    }
+}
+
+void byte_writer::write_string(std::string_view str) {
+    write_uint(str.size());
+    write_raw(str);
+}
+
+void byte_reader::_check(std::size_t n) const {
+    if (remaining() < n) {
+        throw std::runtime_error{"Unexpected end of serialized lix data"};
+    }
+}
+
+std::uint8_t byte_reader::read_byte() {
+    _check(1);
+    return static_cast<std::uint8_t>(*_ptr++);
+}
+
+std::uint64_t byte_reader::read_uint() {
+    std::uint64_t ret   = 0;
+    unsigned      shift = 0;
+    while (true) {
+        auto b = read_byte();
+        if (shift >= 64) {
+            throw std::runtime_error{"Invalid varint in serialized lix data"};
+        }
+        ret |= std::uint64_t(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            return ret;
+        }
+        shift += 7;
+    }
+}
+
+std::int64_t byte_reader::read_int() {
+    auto u = read_uint();
+    return static_cast<std::int64_t>((u >> 1) ^ (~(u & 1) + 1));
+}
+
+double byte_reader::read_real() {
+    std::uint64_t bits = 0;
+    for (auto i = 0; i < 8; ++i) {
+        bits |= std::uint64_t(read_byte()) << (i * 8);
+    }
+    double d;
+    std::memcpy(&d, &bits, sizeof d);
+    return d;
+}
+
+std::string_view byte_reader::read_string() {
+    auto len = read_uint();
+    return read_raw(static_cast<std::size_t>(len));
+}
+
+std::string_view byte_reader::read_raw(std::size_t n) {
+    _check(n);
+    std::string_view ret{_ptr, n};
+    _ptr += n;
+    return ret;
+}
+
+std::uint64_t string_table_writer::intern(std::string_view str) {
+    auto iter = _indices.find(str);
+    if (iter == _indices.end()) {
+        iter = _indices.emplace(std::string(str), _strings.size()).first;
+        _strings.push_back(iter->first);
+    }
+    return iter->second;
+}
+
+void string_table_writer::write(byte_writer& out) const {
+    out.write_uint(_strings.size());
+    for (auto str : _strings) {
+        out.write_string(str);
+    }
+}
+
+string_table_reader::string_table_reader(byte_reader& in) {
+    auto count = in.read_uint();
+    for (auto i = 0u; i < count; ++i) {
+        _strings.push_back(in.read_string());
+    }
+}
+
+std::string_view string_table_reader::get(std::uint64_t index) const {
+    if (index >= _strings.size()) {
+        throw std::runtime_error{"Invalid string reference in serialized lix data"};
+    }
+    return _strings[static_cast<std::size_t>(index)];
+}
+
+namespace {
+
+/**
+ * The serialized fields of each instruction, as a tuple of references. The
+ * same list drives both writing and reading, so they can't disagree.
+ */
+// clang-format off
+auto fields(is::ret& i)                { return std::tie(i.slot); }
+auto fields(is::call& i)               { return std::tie(i.fn, i.args); }
+auto fields(is::tail& i)               { return std::tie(i.fn, i.args); }
+auto fields(is::call_mfa& i)           { return std::tie(i.module, i.fn, i.args); }
+auto fields(is::tail_mfa& i)           { return std::tie(i.module, i.fn, i.args); }
+auto fields(is::add& i)                { return std::tie(i.a, i.b); }
+auto fields(is::sub& i)                { return std::tie(i.a, i.b); }
+auto fields(is::mul& i)                { return std::tie(i.a, i.b); }
+auto fields(is::div& i)                { return std::tie(i.a, i.b); }
+auto fields(is::eq& i)                 { return std::tie(i.a, i.b); }
+auto fields(is::neq& i)                { return std::tie(i.a, i.b); }
+auto fields(is::concat& i)             { return std::tie(i.a, i.b); }
+auto fields(is::negate& i)             { return std::tie(i.arg); }
+auto fields(is::const_int& i)          { return std::tie(i.value); }
+auto fields(is::const_real& i)         { return std::tie(i.value); }
+auto fields(is::const_symbol& i)       { return std::tie(i.sym); }
+auto fields(is::load_const& i)         { return std::tie(i.index); }
+auto fields(is::hard_match& i)         { return std::tie(i.lhs, i.rhs); }
+auto fields(is::try_match& i)          { return std::tie(i.lhs, i.rhs); }
+auto fields(is::try_match_conj& i)     { return std::tie(i.lhs, i.rhs); }
+auto fields(is::const_binding_slot& i) { return std::tie(i.slot); }
+auto fields(is::mk_tuple_0&)           { return std::tie(); }
+auto fields(is::mk_tuple_1& i)         { return std::tie(i.a); }
+auto fields(is::mk_tuple_2& i)         { return std::tie(i.a, i.b); }
+auto fields(is::mk_tuple_3& i)         { return std::tie(i.a, i.b, i.c); }
+auto fields(is::mk_tuple_4& i)         { return std::tie(i.a, i.b, i.c, i.d); }
+auto fields(is::mk_tuple_5& i)         { return std::tie(i.a, i.b, i.c, i.d, i.e); }
+auto fields(is::mk_tuple_6& i)         { return std::tie(i.a, i.b, i.c, i.d, i.e, i.f); }
+auto fields(is::mk_tuple_7& i)         { return std::tie(i.a, i.b, i.c, i.d, i.e, i.f, i.g); }
+auto fields(is::mk_tuple_n& i)         { return std::tie(i.slots); }
+auto fields(is::mk_list& i)            { return std::tie(i.slots); }
+auto fields(is::mk_map& i)             { return std::tie(i.slots); }
+auto fields(is::jump& i)               { return std::tie(i.target); }
+auto fields(is::test_true& i)          { return std::tie(i.slot); }
+auto fields(is::false_jump& i)         { return std::tie(i.target); }
+auto fields(is::rewind& i)             { return std::tie(i.slot); }
+auto fields(is::no_clause& i)          { return std::tie(i.unmatched); }
+auto fields(is::dot& i)                { return std::tie(i.object, i.attr_name); }
+auto fields(is::is_list& i)            { return std::tie(i.arg); }
+auto fields(is::is_symbol& i)          { return std::tie(i.arg); }
+auto fields(is::is_string& i)          { return std::tie(i.arg); }
+auto fields(is::to_string& i)          { return std::tie(i.arg); }
+auto fields(is::inspect& i)            { return std::tie(i.arg); }
+auto fields(is::apply& i)              { return std::tie(i.mod, i.fn, i.arglist); }
+auto fields(is::raise& i)              { return std::tie(i.arg); }
+auto fields(is::mk_closure& i)         { return std::tie(i.code_begin, i.code_end, i.captures); }
+auto fields(is::mk_cons& i)            { return std::tie(i.lhs, i.rhs); }
+auto fields(is::push_front& i)         { return std::tie(i.elem, i.list); }
+auto fields(is::frame_id& i)           { return std::tie(i.id); }
+auto fields(is::enter_args& i)         { return std::tie(i.first, i.arity, i.overflow); }
+auto fields(is::test_arity& i)         { return std::tie(i.arity); }
+auto fields(is::collect_args& i)       { return std::tie(i.first); }
+auto fields(is::switch_shape& i)       { return std::tie(i.subject, i.cases, i.otherwise); }
+auto fields(is::match_tuple& i)        { return std::tie(i.subject, i.arity); }
+auto fields(is::match_list& i)         { return std::tie(i.subject, i.length); }
+auto fields(is::match_cons& i)         { return std::tie(i.subject); }
+auto fields(is::test_equal& i)         { return std::tie(i.a, i.b); }
+auto fields(is::check_match& i)        { return std::tie(i.subject); }
+auto fields(is::tail_self& i)          { return std::tie(i.first, i.args, i.entry); }
+auto fields(is::test_arity_jump& i)    { return std::tie(i.arity, i.target); }
+auto fields(is::match_tuple_jump& i)   { return std::tie(i.subject, i.arity, i.target); }
+auto fields(is::match_list_jump& i)    { return std::tie(i.subject, i.length, i.target); }
+auto fields(is::match_cons_jump& i)    { return std::tie(i.subject, i.target); }
+auto fields(is::test_equal_jump& i)    { return std::tie(i.a, i.b, i.target); }
+auto fields(is::test_symbol_jump& i)   { return std::tie(i.subject, i.sym, i.target); }
+auto fields(is::test_int_jump& i)      { return std::tie(i.subject, i.value, i.target); }
+auto fields(is::hard_match_jump& i)    { return std::tie(i.lhs, i.rhs, i.target, i.move_rhs); }
+// clang-format on
+
+/// A placeholder instruction for the reader to fill in
+template <typename Instr>
+Instr blank() {
+    return Instr{};
+}
+template <>
+is::const_symbol blank() {
+    return is::const_symbol{lix::symbol("")};
+}
+template <>
+is::call_mfa blank() {
+    return is::call_mfa{lix::symbol(""), lix::symbol(""), {}};
+}
+template <>
+is::tail_mfa blank() {
+    return is::tail_mfa{lix::symbol(""), lix::symbol(""), {}};
+}
+template <>
+is::const_binding_slot blank() {
+    return is::const_binding_slot{slot_ref_t{0}};
+}
+template <>
+is::test_symbol_jump blank() {
+    return is::test_symbol_jump{slot_ref_t{0}, lix::symbol(""), inst_offset_t{0}};
+}
+
+struct field_writer {
+    byte_writer&         out;
+    string_table_writer& strings;
+
+    void operator()(slot_ref_t s) { out.write_uint(s.index); }
+    void operator()(inst_offset_t o) { out.write_uint(o.index); }
+    void operator()(bool b) { out.write_byte(b ? 1 : 0); }
+    void operator()(std::size_t n) { out.write_uint(n); }
+    void operator()(std::int64_t i) { out.write_int(i); }
+    void operator()(double d) { out.write_real(d); }
+    void operator()(lix::symbol s) { out.write_uint(strings.intern(s.string())); }
+    void operator()(const std::string& s) { out.write_uint(strings.intern(s)); }
+    void operator()(const std::vector<slot_ref_t>& slots) {
+        out.write_uint(slots.size());
+        for (auto s : slots) {
+            (*this)(s);
+        }
+    }
+    void operator()(const std::vector<is::shape_case>& cases) {
+        out.write_uint(cases.size());
+        for (auto& c : cases) {
+            out.write_byte(static_cast<std::uint8_t>(c.key.kind));
+            (*this)(c.key.integer);
+            (*this)(c.key.sym);
+            (*this)(c.target);
+        }
+    }
+};
+
+struct field_reader {
+    byte_reader&               in;
+    const string_table_reader& strings;
+
+    /// Read the length of a sequence, each element of which takes at least a byte
+    std::size_t read_length() {
+        auto n = in.read_uint();
+        if (n > in.remaining()) {
+            throw std::runtime_error{"Unexpected end of serialized lix data"};
+        }
+        return static_cast<std::size_t>(n);
+    }
+
+    void operator()(slot_ref_t& s) { s.index = static_cast<std::size_t>(in.read_uint()); }
+    void operator()(inst_offset_t& o) { o.index = static_cast<std::size_t>(in.read_uint()); }
+    void operator()(bool& b) { b = in.read_byte() != 0; }
+    void operator()(std::size_t& n) { n = static_cast<std::size_t>(in.read_uint()); }
+    void operator()(std::int64_t& i) { i = in.read_int(); }
+    void operator()(double& d) { d = in.read_real(); }
+    void operator()(lix::symbol& s) { s = lix::symbol(strings.read_ref(in)); }
+    void operator()(std::string& s) { s = std::string(strings.read_ref(in)); }
+    void operator()(std::vector<slot_ref_t>& slots) {
+        slots.resize(read_length());
+        for (auto& s : slots) {
+            (*this)(s);
+        }
+    }
+    void operator()(std::vector<is::shape_case>& cases) {
+        cases.resize(read_length());
+        for (auto& c : cases) {
+            auto kind = in.read_byte();
+            if (kind > static_cast<std::uint8_t>(is::shape_kind::integer)) {
+                throw std::runtime_error{"Invalid shape in serialized lix code"};
+            }
+            c.key.kind = static_cast<is::shape_kind>(kind);
+            (*this)(c.key.integer);
+            (*this)(c.key.sym);
+            (*this)(c.target);
+        }
+    }
+};
+
+template <typename Instr>
+instr read_instr(byte_reader& in, const string_table_reader& strings) {
+    auto inst = blank<Instr>();
+    std::apply([&](auto&... field) { (field_reader{in, strings}(field), ...); }, fields(inst));
+    return instr(std::move(inst));
+}
+
+using instr_reader_fn = instr (*)(byte_reader&, const string_table_reader&);
+
+template <std::size_t... Is>
+constexpr auto make_reader_table(std::index_sequence<Is...>) {
+    return std::array<instr_reader_fn, sizeof...(Is)>{
+        {&read_instr<std::variant_alternative_t<Is, is::any_var>>...}};
+}
+
+constexpr auto instr_readers
+    = make_reader_table(std::make_index_sequence<std::variant_size_v<is::any_var>>());
+
+/// The kinds of values that the compiler puts in a constant pool
+enum class constant_tag : std::uint8_t {
+    integer,
+    real,
+    symbol,
+    string,
+    tuple,
+    list,
+};
+
+void write_constant(byte_writer& out, string_table_writer& strings, const lix::value& val) {
+    auto write_tag = [&](constant_tag t) { out.write_byte(static_cast<std::uint8_t>(t)); };
+    if (auto i = val.as_integer()) {
+        write_tag(constant_tag::integer);
+        out.write_int(*i);
+    } else if (auto r = val.as_real()) {
+        write_tag(constant_tag::real);
+        out.write_real(*r);
+    } else if (auto sym = val.as_symbol()) {
+        write_tag(constant_tag::symbol);
+        out.write_uint(strings.intern(sym->string()));
+    } else if (auto str = val.as_string()) {
+        write_tag(constant_tag::string);
+        out.write_uint(strings.intern(*str));
+    } else if (auto tup = val.as_tuple()) {
+        write_tag(constant_tag::tuple);
+        out.write_uint(tup->size());
+        for (auto i = 0u; i < tup->size(); ++i) {
+            write_constant(out, strings, (*tup)[i]);
+        }
+    } else if (auto list = val.as_list()) {
+        write_tag(constant_tag::list);
+        out.write_uint(list->size());
+        for (auto& el : *list) {
+            write_constant(out, strings, el);
+        }
+    } else {
+        throw std::runtime_error{"Cannot serialize constant: " + inspect(val)};
+    }
+}
+
+lix::value read_constant(byte_reader& in, const string_table_reader& strings) {
+    auto read_seq = [&] {
+        std::vector<lix::value> ret;
+        auto                    size = in.read_uint();
+        for (auto i = 0u; i < size; ++i) {
+            ret.push_back(read_constant(in, strings));
+        }
+        return ret;
+    };
+    switch (static_cast<constant_tag>(in.read_byte())) {
+    case constant_tag::integer:
+        return in.read_int();
+    case constant_tag::real:
+        return in.read_real();
+    case constant_tag::symbol:
+        return lix::symbol(strings.read_ref(in));
+    case constant_tag::string:
+        return lix::string(strings.read_ref(in));
+    case constant_tag::tuple:
+        return lix::tuple(read_seq());
+    case constant_tag::list: {
+        auto els = read_seq();
+        return lix::list(std::make_move_iterator(els.begin()), std::make_move_iterator(els.end()));
+    }
+    }
+    throw std::runtime_error{"Invalid constant in serialized lix code"};
+}
+
+/**
+ * Checks the things that the executor trusts the compiler to get right, so
+ * that corrupt code is rejected when it is read rather than crashing when it
+ * runs: every branch lands on an instruction, control never falls off the end
+ * of the code, and every slot operand refers below the top of the stack.
+ *
+ * The depth of the stack before each instruction is tracked as a lower bound,
+ * since a call may pass more arguments than a function names, and the paths
+ * into an instruction may leave different depths.
+ */
+class code_checker {
+    const std::vector<instr>&               _instrs;
+    std::vector<std::optional<std::size_t>> _depth;
+    std::vector<std::size_t>                _work;
+
+    static constexpr std::size_t max_operand = (std::numeric_limits<std::uint32_t>::max)();
+
+    [[noreturn]] static void _invalid(const char* what) {
+        throw std::runtime_error{std::string("Invalid ") + what + " in serialized lix code"};
+    }
+
+    void _reach(std::size_t index, std::size_t depth) {
+        if (index >= _instrs.size()) {
+            _invalid("instruction offset");
+        } else if (depth > max_operand) {
+            _invalid("stack depth");
+        }
+        auto& known = _depth[index];
+        if (!known || depth < *known) {
+            known = depth;
+            _work.push_back(index);
+        }
+    }
+
+    struct visitor {
+        code_checker& self;
+        std::size_t   index;
+        std::size_t   depth;
+
+        void read(slot_ref_t s) const {
+            if (s.index >= depth) {
+                _invalid("slot");
+            }
+        }
+        void position(slot_ref_t s) const {
+            if (s.index > depth) {
+                _invalid("slot");
+            }
+        }
+        static std::size_t count(std::int64_t n) {
+            if (n < 0 || static_cast<std::uint64_t>(n) > max_operand) {
+                _invalid("arity");
+            }
+            return static_cast<std::size_t>(n);
+        }
+        void branch(inst_offset_t target, std::size_t d) const { self._reach(target.index, d); }
+        void fall(std::size_t d) const { self._reach(index + 1, d); }
+
+        /// Check every slot of an instruction as a value that it reads
+        template <typename Instr>
+        void reads(const Instr& in) const {
+            auto copy = in;
+            std::apply([&](const auto&... field) { (check_read(field), ...); }, fields(copy));
+        }
+        void check_read(slot_ref_t s) const { read(s); }
+        void check_read(const std::vector<slot_ref_t>& slots) const {
+            for (auto s : slots) {
+                read(s);
+            }
+        }
+        template <typename Other>
+        void check_read(const Other&) const {}
+
+        template <typename Instr>
+        void push(const Instr& in, std::size_t n) const {
+            reads(in);
+            fall(depth + n);
+        }
+        template <typename Instr>
+        void test_jump(const Instr& in, std::size_t n) const {
+            reads(in);
+            branch(in.target, depth);
+            fall(depth + n);
+        }
+
+        // clang-format off
+        void operator()(const is::call& i)             { push(i, 1); }
+        void operator()(const is::tail& i)             { push(i, 1); }
+        void operator()(const is::call_mfa& i)         { push(i, 1); }
+        void operator()(const is::tail_mfa& i)         { push(i, 1); }
+        void operator()(is::add i)                     { push(i, 1); }
+        void operator()(is::sub i)                     { push(i, 1); }
+        void operator()(is::mul i)                     { push(i, 1); }
+        void operator()(is::div i)                     { push(i, 1); }
+        void operator()(is::eq i)                      { push(i, 1); }
+        void operator()(is::neq i)                     { push(i, 1); }
+        void operator()(is::concat i)                  { push(i, 1); }
+        void operator()(is::negate i)                  { push(i, 1); }
+        void operator()(is::const_int i)               { push(i, 1); }
+        void operator()(is::const_real i)              { push(i, 1); }
+        void operator()(const is::const_symbol& i)     { push(i, 1); }
+        void operator()(is::load_const i)              { push(i, 1); }
+        void operator()(is::mk_tuple_0 i)              { push(i, 1); }
+        void operator()(is::mk_tuple_1 i)              { push(i, 1); }
+        void operator()(is::mk_tuple_2 i)              { push(i, 1); }
+        void operator()(is::mk_tuple_3 i)              { push(i, 1); }
+        void operator()(is::mk_tuple_4 i)              { push(i, 1); }
+        void operator()(is::mk_tuple_5 i)              { push(i, 1); }
+        void operator()(is::mk_tuple_6 i)              { push(i, 1); }
+        void operator()(is::mk_tuple_7 i)              { push(i, 1); }
+        void operator()(const is::mk_tuple_n& i)       { push(i, 1); }
+        void operator()(const is::mk_list& i)          { push(i, 1); }
+        void operator()(const is::mk_map& i)           { push(i, 1); }
+        void operator()(is::mk_cons i)                 { push(i, 1); }
+        void operator()(is::push_front i)              { push(i, 1); }
+        void operator()(is::dot i)                     { push(i, 1); }
+        void operator()(is::is_list i)                 { push(i, 1); }
+        void operator()(is::is_symbol i)               { push(i, 1); }
+        void operator()(is::is_string i)               { push(i, 1); }
+        void operator()(is::to_string i)               { push(i, 1); }
+        void operator()(is::inspect i)                 { push(i, 1); }
+        void operator()(is::apply i)                   { push(i, 1); }
+        void operator()(is::hard_match i)              { push(i, 0); }
+        void operator()(is::try_match i)               { push(i, 0); }
+        void operator()(is::try_match_conj i)          { push(i, 0); }
+        void operator()(is::test_true i)               { push(i, 0); }
+        void operator()(const is::frame_id& i)         { push(i, 0); }
+        void operator()(is::test_equal i)              { push(i, 0); }
+        void operator()(is::check_match i)             { push(i, 0); }
+        void operator()(is::match_cons i)              { push(i, 2); }
+        void operator()(is::ret i)                     { reads(i); }
+        void operator()(is::raise i)                   { reads(i); }
+        void operator()(is::no_clause i)               { reads(i); }
+        void operator()(is::jump j)                    { branch(j.target, depth); }
+        void operator()(is::hard_match_jump m)         { reads(m); branch(m.target, depth); }
+        void operator()(is::test_equal_jump t)         { test_jump(t, 0); }
+        void operator()(const is::test_symbol_jump& t) { test_jump(t, 0); }
+        void operator()(is::test_int_jump t)           { test_jump(t, 0); }
+        void operator()(is::match_cons_jump m)         { test_jump(m, 2); }
+        // clang-format on
+
+        void operator()(is::test_arity t) {
+            count(t.arity);
+            fall(depth);
+        }
+        void operator()(is::test_arity_jump t) {
+            count(t.arity);
+            test_jump(t, 0);
+        }
+        void operator()(is::match_tuple m) { push(m, count(m.arity)); }
+        void operator()(is::match_list m) { push(m, count(m.length)); }
+        void operator()(is::match_tuple_jump m) { test_jump(m, count(m.arity)); }
+        void operator()(is::match_list_jump m) { test_jump(m, count(m.length)); }
+        void operator()(is::false_jump j) {
+            // A failed match leaves the stack as it was before the match
+            auto prev   = index != 0 ? &self._instrs[index - 1].instr_var() : nullptr;
+            auto pushed = std::size_t(0);
+            if (auto m = prev ? std::get_if<is::match_tuple>(prev) : nullptr) {
+                pushed = static_cast<std::size_t>(m->arity);
+            } else if (auto l = prev ? std::get_if<is::match_list>(prev) : nullptr) {
+                pushed = static_cast<std::size_t>(l->length);
+            } else if (prev && std::holds_alternative<is::match_cons>(*prev)) {
+                pushed = 2;
+            }
+            branch(j.target, depth - (std::min)(depth, pushed));
+            fall(depth);
+        }
+        void operator()(const is::switch_shape& sw) {
+            read(sw.subject);
+            for (auto& c : sw.cases) {
+                branch(c.target, depth);
+            }
+            branch(sw.otherwise, depth);
+        }
+        void operator()(is::rewind r) {
+            position(r.slot);
+            fall(r.slot.index);
+        }
+        void operator()(is::const_binding_slot s) {
+            position(s.slot);
+            fall(depth + 1);
+        }
+        void operator()(is::enter_args e) {
+            position(e.first);
+            auto arity = count(e.arity);
+            branch(e.overflow, e.first.index + arity + 1);
+            fall(e.first.index + arity);
+        }
+        void operator()(is::collect_args c) {
+            position(c.first);
+            fall(c.first.index + 1);
+        }
+        void operator()(const is::tail_self& t) {
+            position(t.first);
+            check_read(t.args);
+            branch(t.entry, t.first.index + t.args.size());
+        }
+        void operator()(const is::mk_closure& c) {
+            check_read(c.captures);
+            fall(depth + 1);
+        }
+
+        template <typename Other>
+        void operator()(const Other&) = delete;
+    };
+
+public:
+    explicit code_checker(const std::vector<instr>& instrs)
+        : _instrs(instrs)
+        , _depth(instrs.size()) {}
+
+    void run() {
+        if (_instrs.empty()) {
+            return;
+        }
+        _reach(0, 0);
+        // A closure may be loaded without the code that creates it having
+        // run, so every closure body is entered. It begins with the captures
+        // in the first slots, followed by the arguments.
+        for (auto& in : _instrs) {
+            if (auto c = std::get_if<is::mk_closure>(&in.instr_var())) {
+                if (c->code_begin.index >= c->code_end.index
+                    || c->code_end.index > _instrs.size()) {
+                    _invalid("closure");
+                }
+                _reach(c->code_begin.index, c->captures.size());
+            }
+        }
+        while (!_work.empty()) {
+            auto i = _work.back();
+            _work.pop_back();
+            _instrs[i].visit(visitor{*this, i, *_depth[i]});
+        }
+    }
+};
+
+}  // namespace
+
+void lix::code::write_code(byte_writer& out, string_table_writer& strings, const code& c) {
+    out.write_uint(c.constants().size());
+    for (auto& val : c.constants()) {
+        write_constant(out, strings, val);
+    }
+    out.write_uint(c.size());
+    for (auto& inst : c) {
+        out.write_byte(static_cast<std::uint8_t>(inst.instr_var().index()));
+        inst.visit([&](auto copy) {
+            std::apply([&](const auto&... field) { (field_writer{out, strings}(field), ...); },
+                       fields(copy));
+        });
+    }
+}
+
+code lix::code::read_code(byte_reader& in, const string_table_reader& strings) {
+    std::vector<lix::value> constants;
+    auto                    n_constants = static_cast<std::size_t>(in.read_uint());
+    for (auto i = 0u; i < n_constants; ++i) {
+        constants.push_back(read_constant(in, strings));
+    }
+    // Every instruction takes at least a byte
+    auto count = in.read_uint();
+    if (count > in.remaining()) {
+        throw std::runtime_error{"Unexpected end of serialized lix data"};
+    }
+    std::vector<instr> instrs;
+    instrs.reserve(static_cast<std::size_t>(count));
+    for (auto i = 0u; i < count; ++i) {
+        auto opcode = in.read_byte();
+        if (opcode >= instr_readers.size()) {
+            throw std::runtime_error{"Invalid instruction in serialized lix code"};
+        }
+        auto& inst = instrs.emplace_back(instr_readers[opcode](in, strings));
+        auto  load = std::get_if<is::load_const>(&inst.instr_var());
+        if (load && load->index >= constants.size()) {
+            throw std::runtime_error{"Invalid constant reference in serialized lix code"};
+        }
+    }
+    code_checker(instrs).run();
+    return code(instrs.begin(), instrs.end(), std::move(constants));
+}
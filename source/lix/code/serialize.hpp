@@ -0,0 +1,107 @@
+#ifndef LIX_CODE_SERIALIZE_HPP_INCLUDED
+#define LIX_CODE_SERIALIZE_HPP_INCLUDED
+
+#include <lix/code/code.hpp>
+
+#include <cinttypes>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lix::code {
+
+/**
+ * The version of the serialized bytecode format. Bump this whenever the
+ * instruction set or its encoding changes so that stale bytecode is rejected
+ * rather than misread.
+ */
+constexpr std::uint32_t bytecode_version = 8;
+
+/**
+ * Appends a compact, position-independent binary encoding to a buffer.
+ * Unsigned integers are LEB128 varints, signed integers are zigzag-encoded
+ * varints, reals are their 8 little-endian bytes, and strings are a length
+ * followed by their bytes.
+ */
+class byte_writer {
+    std::string _buf;
+
+public:
+    void write_byte(std::uint8_t b) { _buf.push_back(static_cast<char>(b)); }
+    void write_uint(std::uint64_t);
+    void write_int(std::int64_t);
+    void write_real(double);
+    void write_string(std::string_view);
+    void write_raw(std::string_view bytes) { _buf.append(bytes); }
+
+    const std::string& bytes() const noexcept { return _buf; }
+    std::string        release() noexcept { return std::move(_buf); }
+};
+
+/**
+ * Reads back what a byte_writer wrote. Reading past the end of the input
+ * throws std::runtime_error.
+ */
+class byte_reader {
+    const char* _ptr;
+    const char* _end;
+
+    void _check(std::size_t n) const;
+
+public:
+    explicit byte_reader(std::string_view bytes)
+        : _ptr(bytes.data())
+        , _end(bytes.data() + bytes.size()) {}
+
+    std::uint8_t     read_byte();
+    std::uint64_t    read_uint();
+    std::int64_t     read_int();
+    double           read_real();
+    std::string_view read_string();
+    std::string_view read_raw(std::size_t n);
+
+    bool        at_end() const noexcept { return _ptr == _end; }
+    std::size_t remaining() const noexcept { return static_cast<std::size_t>(_end - _ptr); }
+};
+
+/**
+ * Collects the strings and symbol names used by serialized code so that each
+ * is stored once. Code refers to them by their index in the table.
+ */
+class string_table_writer {
+    std::vector<std::string_view>                      _strings;
+    std::map<std::string, std::uint64_t, std::less<>> _indices;
+
+public:
+    std::uint64_t intern(std::string_view);
+    void          write(byte_writer&) const;
+};
+
+/**
+ * A string table read back from serialized data. The strings refer into the
+ * buffer being read, and are only valid as long as it is.
+ */
+class string_table_reader {
+    std::vector<std::string_view> _strings;
+
+public:
+    explicit string_table_reader(byte_reader&);
+
+    std::string_view get(std::uint64_t index) const;
+    std::string_view read_ref(byte_reader& in) const { return get(in.read_uint()); }
+};
+
+/// Write the constant pool and the instructions of a block of code
+void write_code(byte_writer&, string_table_writer&, const code&);
+
+/**
+ * Read a block of code written by `write_code()`. Throws std::runtime_error if
+ * the data is truncated, or if the code it holds could branch out of itself or
+ * read a slot that isn't on the stack.
+ */
+code read_code(byte_reader&, const string_table_reader&);
+
+}  // namespace lix::code
+
+#endif  // LIX_CODE_SERIALIZE_HPP_INCLUDED
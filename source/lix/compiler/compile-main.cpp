@@ -1,40 +1,91 @@
 #include <lix/parser/parse.hpp>
+#include <lix/code/optimize.hpp>
 #include <lix/compiler/compile.hpp>
+#include <lix/compiler/program.hpp>
 #include <lix/exec/kernel.hpp>
 #include <lix/compiler/macro.hpp>
+#include <lix/libs/libs.hpp>
 
 #include <algorithm>
 #include <fstream>
 #include <iostream>
 
 namespace {
-int compile_istream(std::istream& in) {
+void report(const lix::code::optimize_stats& stats) {
+    std::cerr << stats.instrs_before << " instructions before optimizing, " << stats.instrs_after
+              << " after (" << stats.folded << " folded, " << stats.fused << " fused, "
+              << stats.dead_slots << " dead slots, " << stats.jumps << " jumps and rewinds, "
+              << stats.moves << " moves)\n";
+}
+
+int compile_istream(std::istream& in, const char* out_path, bool optimize) {
     std::string code;
     using iter = std::istreambuf_iterator<char>;
     std::copy(iter(in), iter{}, std::back_inserter(code));
     try {
+        if (out_path) {
+            // Compile in the same context that lix-eval will load the program into
+            auto ctx   = lix::libs::create_context<lix::libs::Enum, lix::libs::IO>();
+            lix::code::optimize_stats stats;
+            auto                      image
+                = lix::compile_program(ctx, lix::ast::parse(code), optimize ? &stats : nullptr);
+            std::ofstream out{out_path, std::ios::binary};
+            if (!out) {
+                std::cerr << "Failed to open file for writing: " << out_path << '\n';
+                return 2;
+            }
+            out.write(image.data(), static_cast<std::streamsize>(image.size()));
+            if (optimize) {
+                report(stats);
+            }
+            return out.good() ? 0 : 1;
+        }
         auto ctx   = lix::exec::build_kernel_context();
         auto node  = lix::ast::parse(code);
         node       = lix::expand_macros(ctx, node);
         auto block = lix::compile(node);
+        if (optimize) {
+            lix::code::optimize_stats stats;
+            block = lix::code::optimize(block, &stats);
+            report(stats);
+        }
         std::cout << block;
     } catch (const lix::ast::parse_error& e) {
         std::cerr << "FAIL:\n" << e.what() << '\n';
         return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "FAIL: " << e.what() << '\n';
+        return 1;
     }
     return 0;
 }
 }
 
 int main(int argc, char** argv) {
+    // Usage: lix-compile [-O] [-o <output>] [<input>]
+    const char* out_path = nullptr;
+    bool        optimize = false;
+    while (argc >= 2) {
+        if (argv[1] == std::string("-O")) {
+            optimize = true;
+            argc -= 1;
+            argv += 1;
+        } else if (argc >= 3 && argv[1] == std::string("-o")) {
+            out_path = argv[2];
+            argc -= 2;
+            argv += 2;
+        } else {
+            break;
+        }
+    }
     if (argc == 2) {
         std::ifstream in{argv[1]};
         if (!in) {
             std::cerr << "Failed to open filed: " << argv[1] << '\n';
             return 2;
         }
-        return compile_istream(in);
+        return compile_istream(in, out_path, optimize);
     } else {
-        return compile_istream(std::cin);
+        return compile_istream(std::cin, out_path, optimize);
     }
-}
\ No newline at end of file
+}
@@ -7,7 +7,9 @@
 
 #include <lix/util/args.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <iterator>
 #include <list>
 #include <map>
 #include <optional>
@@ -36,8 +38,6 @@ struct capture {
 };
 using capture_list = std::vector<capture>;
 
-struct expand_quoted {};
-
 struct drop_argument {
     template <typename O>
     drop_argument(O) {}
@@ -61,6 +61,256 @@ opt_ref<const string> get_var_string(const ast::node& n) {
     return varsym->string();
 }
 
+/**
+ * The elements of a tuple expression, or null if `n` isn't one. Pairs are
+ * tuples in the AST, while other tuples are calls to `{}`.
+ */
+const std::vector<ast::node>* tuple_elements(const ast::node& n) {
+    if (auto tup = n.as_tuple()) {
+        return &tup->nodes;
+    } else if (auto call = n.as_call()) {
+        auto target = call->target().as_symbol();
+        auto args   = call->arguments().as_list();
+        if (target && target->string() == "{}" && args) {
+            return &args->nodes;
+        }
+    }
+    return nullptr;
+}
+
+/// The head and tail of a list that is a cons, `[hd|tail]`, or null if it isn't one
+const ast::list* cons_arguments(const ast::list& l) {
+    if (l.nodes.size() != 1) {
+        return nullptr;
+    }
+    auto inner_call = l.nodes[0].as_call();
+    if (!inner_call) {
+        return nullptr;
+    }
+    auto call_sym = inner_call->target().as_symbol();
+    if (!call_sym || call_sym->string() != "|") {
+        return nullptr;
+    }
+    auto args = inner_call->arguments().as_list();
+    return args && args->nodes.size() == 2 ? &*args : nullptr;
+}
+
+std::optional<lix::value> constant_value(const ast::node& n);
+
+std::optional<std::vector<lix::value>> constant_values(const std::vector<ast::node>& nodes) {
+    std::vector<lix::value> ret;
+    for (auto& n : nodes) {
+        auto val = constant_value(n);
+        if (!val) {
+            return std::nullopt;
+        }
+        ret.push_back(std::move(*val));
+    }
+    return ret;
+}
+
+/**
+ * The value of an expression that evaluates to the same value every time: a
+ * number, symbol, or string literal, or a tuple or list literal of those.
+ * Anything with a variable, a call, or a cons in it is not constant.
+ */
+std::optional<lix::value> constant_value(const ast::node& n) {
+    if (auto i = n.as_integer()) {
+        return lix::value(*i);
+    } else if (auto r = n.as_real()) {
+        return lix::value(*r);
+    } else if (auto sym = n.as_symbol()) {
+        return lix::value(*sym);
+    } else if (auto str = n.as_string()) {
+        return lix::value(*str);
+    } else if (auto elems = tuple_elements(n)) {
+        if (auto vals = constant_values(*elems)) {
+            return lix::value(lix::tuple(std::move(*vals)));
+        }
+    } else if (auto list = n.as_list(); list && !cons_arguments(*list)) {
+        if (auto vals = constant_values(list->nodes)) {
+            return lix::value(lix::list(std::make_move_iterator(vals->begin()),
+                                        std::make_move_iterator(vals->end())));
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * Converts a quoted expression to the value that `quote` evaluates to. This is
+ * the AST of the expression, except that calls have empty metadata.
+ */
+struct quoted_value {
+    lix::value operator()(const ast::list& l) const {
+        std::vector<lix::value> vals;
+        for (auto& n : l.nodes) {
+            vals.push_back(n.visit(*this));
+        }
+        return lix::list(std::make_move_iterator(vals.begin()),
+                         std::make_move_iterator(vals.end()));
+    }
+    lix::value operator()(const ast::tuple& t) const {
+        std::vector<lix::value> vals;
+        for (auto& n : t.nodes) {
+            vals.push_back(n.visit(*this));
+        }
+        return lix::tuple(std::move(vals));
+    }
+    lix::value operator()(const ast::call& c) const {
+        return lix::tuple::make(c.target().visit(*this), lix::list(), c.arguments().visit(*this));
+    }
+    lix::value operator()(ast::integer i) const { return i; }
+    lix::value operator()(ast::real r) const { return r; }
+    lix::value operator()(const ast::symbol& s) const { return s; }
+    lix::value operator()(const ast::string& s) const { return s; }
+};
+
+/**
+ * The outermost shape of value that a clause pattern requires, or nothing if
+ * it may match values of any shape. Anything other than a literal, such as a
+ * variable, may match anything.
+ */
+std::optional<is::shape_key> pattern_shape(const ast::node& n) {
+    using is::shape_kind;
+    if (auto i = n.as_integer()) {
+        return is::shape_key{shape_kind::integer, *i};
+    } else if (auto sym = n.as_symbol()) {
+        return is::shape_key{shape_kind::symbol, 0, *sym};
+    } else if (auto list = n.as_list()) {
+        return is::shape_key{list->nodes.empty() ? shape_kind::empty_list
+                                                 : shape_kind::nonempty_list};
+    }
+    auto elems = tuple_elements(n);
+    if (!elems) {
+        return std::nullopt;
+    }
+    const auto arity = static_cast<std::int64_t>(elems->size());
+    if (!elems->empty()) {
+        if (auto tag = elems->front().as_symbol()) {
+            return is::shape_key{shape_kind::tagged_tuple, arity, *tag};
+        }
+    }
+    return is::shape_key{shape_kind::tuple, arity};
+}
+
+/**
+ * Decides which clauses of a `case` or `fn` are worth trying, given the shape
+ * of each clause's pattern in one position. A value is classified by the first
+ * of `keys()` that it has. The clauses it may match are those whose pattern
+ * has that shape, or no particular shape at all.
+ */
+class clause_dispatch {
+    std::vector<std::optional<is::shape_key>> _patterns;
+    std::vector<is::shape_key>                _keys;
+
+    static bool _may_match(const std::optional<is::shape_key>& pattern,
+                           const is::shape_key*                key) {
+        if (!pattern) {
+            return true;
+        }
+        if (!key) {
+            // The value has none of the shapes that we switch on
+            return false;
+        }
+        if (pattern->kind == is::shape_kind::tuple && key->kind == is::shape_kind::tagged_tuple) {
+            return pattern->integer == key->integer;
+        }
+        return *pattern == *key;
+    }
+
+public:
+    explicit clause_dispatch(std::vector<std::optional<is::shape_key>> patterns)
+        : _patterns(std::move(patterns)) {
+        auto n_shaped = std::count_if(_patterns.begin(), _patterns.end(), [](auto& p) {
+            return p.has_value();
+        });
+        if (n_shaped < 2) {
+            // One shaped clause isn't worth a switch. Try everything in order.
+            std::fill(_patterns.begin(), _patterns.end(), std::nullopt);
+        }
+        for (auto& pat : _patterns) {
+            if (pat && std::find(_keys.begin(), _keys.end(), *pat) == _keys.end()) {
+                _keys.push_back(*pat);
+            }
+        }
+        // A tagged tuple is also an untagged one, so it must be tested first
+        std::stable_partition(_keys.begin(), _keys.end(), [](auto& key) {
+            return key.kind == is::shape_kind::tagged_tuple;
+        });
+    }
+
+    std::size_t                       size() const noexcept { return _patterns.size(); }
+    const std::vector<is::shape_key>& keys() const noexcept { return _keys; }
+
+    /**
+     * The first clause from `first` on that a value of shape `key` may match,
+     * or `size()` if there is none. A null `key` is a value of none of the
+     * shapes in `keys()`.
+     */
+    std::size_t next_clause(std::size_t first, const is::shape_key* key) const {
+        for (auto i = first; i < _patterns.size(); ++i) {
+            if (_may_match(_patterns[i], key)) {
+                return i;
+            }
+        }
+        return _patterns.size();
+    }
+
+    /**
+     * The clause to try first if it's the same for values of every shape, or
+     * nothing if it takes a switch.
+     */
+    std::optional<std::size_t> uniform_first() const { return _uniform_next(0, std::nullopt); }
+
+    /**
+     * The clause to try after clause `i` fails, if it's the same for every
+     * value that may have been sent to clause `i`.
+     */
+    std::optional<std::size_t> uniform_next(std::size_t i) const {
+        return _uniform_next(i + 1, _patterns[i]);
+    }
+
+private:
+    std::optional<std::size_t> _uniform_next(std::size_t                          first,
+                                             const std::optional<is::shape_key>& reached_by) const {
+        std::optional<std::size_t> ret;
+        auto                       agrees = [&](const is::shape_key* key) {
+            auto next = next_clause(first, key);
+            if (ret && *ret != next) {
+                return false;
+            }
+            ret = next;
+            return true;
+        };
+        if (!reached_by && !agrees(nullptr)) {
+            return std::nullopt;
+        }
+        for (auto& key : _keys) {
+            if (_may_match(reached_by, &key) && !agrees(&key)) {
+                return std::nullopt;
+            }
+        }
+        return ret;
+    }
+};
+
+/// The pattern of a `pattern -> body` clause, if it is well-formed
+opt_ref<const ast::node> branch_clause_head(const ast::node& clause) {
+    auto call = clause.as_call();
+    if (!call) {
+        return std::nullopt;
+    }
+    auto args = call->arguments().as_list();
+    if (!args || args->nodes.size() != 2) {
+        return std::nullopt;
+    }
+    auto lhs_list = args->nodes[0].as_list();
+    if (!lhs_list || lhs_list->nodes.size() != 1) {
+        return std::nullopt;
+    }
+    return lhs_list->nodes[0];
+}
+
 struct minifun_rewriter {
     std::string  arg_prefix;
     ast::integer n_args;
@@ -153,6 +403,20 @@ struct block_compiler {
      */
     int clause_test_depth = 0;
 
+    /**
+     * The module function whose clauses are being compiled, if we are in one
+     * and not in an anonymous fn within it. Its tail calls to itself loop
+     * back to `entry`, its enter_args, with new arguments from `first_arg`.
+     */
+    struct self_function {
+        std::string   module;
+        std::string   name;
+        slot_ref_t    first_arg;
+        std::size_t   max_arity;
+        inst_offset_t entry;
+    };
+    std::optional<self_function> self_fn;
+
     /**
      * We keep track of where the expressions end up in the slot stack and
      * increment while we advance instructions that produce values
@@ -231,6 +495,9 @@ struct block_compiler {
      * Compile a tuple expression. We have dedicated bytecode for each arity up to 7
      */
     slot_ref_t _compile_tuple(const std::vector<ast::node>& nodes) {
+        if (auto vals = constant_values(nodes)) {
+            return _compile_constant(lix::tuple(std::move(*vals)));
+        }
         switch (nodes.size()) {
         case 0:
             builder.push_instr(is::mk_tuple_0{});
@@ -489,14 +756,11 @@ struct block_compiler {
             return *mfa_ret_slot;
         }
 
-        builder.push_instr(is::mk_tuple_n{std::move(arg_slots)});
-        auto arg_slot = consume_slot();
-
         auto fn_slot = compile(lhs);
         if (tail == tail_call::enable) {
-            builder.push_instr(is::tail{fn_slot, arg_slot});
+            builder.push_instr(is::tail{fn_slot, std::move(arg_slots)});
         } else {
-            builder.push_instr(is::call{fn_slot, arg_slot});
+            builder.push_instr(is::call{fn_slot, std::move(arg_slots)});
         }
 
         return consume_slot();
@@ -531,7 +795,9 @@ struct block_compiler {
             // Not a valid dot expression, but we don't worry that here
             return nullopt;
         }
-        if (tail == tail_call::enable) {
+        if (tail == tail_call::enable && _is_self_call(*modname, *fn_name, arg_slots.size())) {
+            builder.push_instr(is::tail_self{self_fn->first_arg, arg_slots, self_fn->entry});
+        } else if (tail == tail_call::enable) {
             builder.push_instr(is::tail_mfa{*modname, *fn_name, arg_slots});
         } else {
             builder.push_instr(is::call_mfa{*modname, *fn_name, arg_slots});
@@ -539,6 +805,12 @@ struct block_compiler {
         return consume_slot();
     }
 
+    /// Whether calling `mod.fn` with `argc` arguments re-enters the function being compiled
+    bool _is_self_call(lix::symbol mod, lix::symbol fn, std::size_t argc) const {
+        return self_fn && argc <= self_fn->max_arity && mod.string() == self_fn->module
+            && fn.string() == self_fn->name;
+    }
+
     slot_ref_t _compile_assign(const std::vector<ast::node>& args, const ast::meta& meta) {
         if (clause_test_depth != 0) {
             throw compile_error{
@@ -558,13 +830,71 @@ struct block_compiler {
         }
         // We get here if we're not just a variable assignment, ie. A more
         // complete match expression.
-        binding_expr_depth++;
-        auto lhs_slot = compile(args[0]);
-        binding_expr_depth--;
-        builder.push_instr(is::hard_match{lhs_slot, rhs_slot});
+        auto check = [&] { builder.push_instr(is::check_match{rhs_slot}); };
+        _compile_destructure(args[0], rhs_slot, check);
         return rhs_slot;
     }
 
+    /**
+     * Compile a match of `pattern` against the value in `subject`. Tuples,
+     * lists, and conses are taken apart in place: their elements are pushed
+     * into slots, variables in the pattern name those slots, and literals and
+     * bound variables are compared with them. Nothing is allocated except the
+     * tail of a cons. Any other pattern is built as a runtime pattern value
+     * and matched with `try_match`. `on_test()` is called after each test is
+     * emitted, to handle its failure.
+     */
+    template <typename OnTest>
+    void _compile_destructure(const ast::node& pattern, slot_ref_t subject, OnTest& on_test) {
+        if (auto var_name = get_var_string(pattern)) {
+            if (auto var_slot = slot_for_variable(*var_name)) {
+                builder.push_instr(is::test_equal{*var_slot, subject});
+                on_test();
+            } else {
+                top_varmap().emplace(*var_name, subject);
+            }
+            return;
+        }
+        if (pattern.as_integer() || pattern.as_real() || pattern.as_symbol()
+            || pattern.as_string()) {
+            auto literal_slot = compile(pattern);
+            builder.push_instr(is::test_equal{literal_slot, subject});
+            on_test();
+            return;
+        }
+        const std::vector<ast::node>* elems = tuple_elements(pattern);
+        if (elems) {
+            builder.push_instr(
+                is::match_tuple{subject, static_cast<std::int64_t>(elems->size())});
+        } else if (auto list = pattern.as_list()) {
+            if (auto cons = cons_arguments(*list)) {
+                builder.push_instr(is::match_cons{subject});
+                on_test();
+                auto head_slot = consume_slot();
+                auto tail_slot = consume_slot();
+                _compile_destructure(cons->nodes[0], head_slot, on_test);
+                _compile_destructure(cons->nodes[1], tail_slot, on_test);
+                return;
+            }
+            elems = &list->nodes;
+            builder.push_instr(
+                is::match_list{subject, static_cast<std::int64_t>(elems->size())});
+        } else {
+            binding_expr_depth++;
+            auto pattern_slot = compile(pattern);
+            binding_expr_depth--;
+            builder.push_instr(is::try_match{pattern_slot, subject});
+            on_test();
+            return;
+        }
+        on_test();
+        const auto first_elem = current_end_slot;
+        current_end_slot.index += elems->size();
+        for (auto i = 0u; i < elems->size(); ++i) {
+            _compile_destructure((*elems)[i], slot_ref_t{first_elem.index + i}, on_test);
+        }
+    }
+
     slot_ref_t
     _compile_pipe(const std::vector<ast::node>& pipe_args, const ast::meta& meta, tail_call tail) {
         auto lhs_node = pipe_args[0];
@@ -637,32 +967,98 @@ struct block_compiler {
         return _compile_branch_clauses(match_slot, res_slot, clause_list.nodes, meta, tail);
     }
 
+    /**
+     * Compile the clauses of a `case` or `fn`. Before the first clause, and
+     * after any clause fails, a `switch_shape` on the subject skips ahead to
+     * the next clause that may match it, if the patterns differ in shape.
+     * `compile_clause(i)` compiles clause `i` and returns the jumps that its
+     * tests take on failure. If no clause matches, control reaches the code
+     * that follows.
+     */
+    template <typename CompileClause>
+    void _compile_clause_dispatch(const clause_dispatch& dispatch,
+                                  slot_ref_t             subject,
+                                  slot_ref_t             rewind_to,
+                                  CompileClause&&        compile_clause) {
+        struct pending_switch {
+            is::switch_shape* inst;
+            std::size_t       first;
+        };
+        std::vector<pending_switch> switches;
+        auto                        emit_switch = [&](std::size_t first) {
+            auto& sw = builder.push_instr(is::switch_shape{subject, {}, invalid_inst});
+            switches.push_back(pending_switch{&sw, first});
+        };
+
+        const auto                                n_clauses = dispatch.size();
+        std::vector<inst_offset_t>                labels;
+        std::vector<std::vector<is::false_jump*>> fail_jumps;
+        if (!dispatch.uniform_first()) {
+            emit_switch(0);
+        }
+        for (auto i = 0u; i < n_clauses; ++i) {
+            labels.push_back(current_instruction());
+            if (i != 0) {
+                // Rewind the stack for any work that a failed clause may have
+                // done in its test
+                builder.push_instr(is::rewind{rewind_to});
+                current_end_slot = rewind_to;
+            }
+            fail_jumps.push_back(compile_clause(i));
+        }
+        for (auto i = 0u; i < n_clauses; ++i) {
+            if (!dispatch.uniform_next(i)) {
+                for (auto jump : fail_jumps[i]) {
+                    jump->target = current_instruction();
+                }
+                emit_switch(i + 1);
+            }
+        }
+        // Where we go when no clause matches
+        labels.push_back(current_instruction());
+
+        for (auto i = 0u; i < n_clauses; ++i) {
+            if (auto next = dispatch.uniform_next(i)) {
+                for (auto jump : fail_jumps[i]) {
+                    jump->target = labels[*next];
+                }
+            }
+        }
+        for (auto& sw : switches) {
+            sw.inst->otherwise = labels[dispatch.next_clause(sw.first, nullptr)];
+            for (auto& key : dispatch.keys()) {
+                auto target = labels[dispatch.next_clause(sw.first, &key)];
+                if (target != sw.inst->otherwise) {
+                    sw.inst->cases.push_back(is::shape_case{key, target});
+                }
+            }
+        }
+    }
+
     slot_ref_t _compile_branch_clauses(slot_ref_t                    match_slot,
                                        slot_ref_t                    res_slot,
                                        const std::vector<ast::node>& clauses,
                                        const ast::meta&              meta,
                                        tail_call                     tail) {
-        const auto                 rewind_to = current_end_slot;
-        std::vector<inst_offset_t> exit_inst_offsets;
-        std::vector<is::jump*>     exit_instrs;
-        is::false_jump*            prev_false_jump = nullptr;
+        std::vector<std::optional<is::shape_key>> shapes;
         for (auto& n : clauses) {
-            if (prev_false_jump) {
-                // Resolve the false-jump of the prior clause
-                prev_false_jump->target = current_instruction();
-                // Rewind the stack for any work that the prior clause may have
-                // done in its test
-                builder.push_instr(is::rewind{rewind_to});
-                current_end_slot = rewind_to;
-            }
-            auto [false_jump_target_, end_jump]
-                = _compile_branch_clause(match_slot, res_slot, n, tail);
-            exit_instrs.push_back(end_jump);
-            prev_false_jump = false_jump_target_;
-        }
-        // We must have compiled at least one clause, so we'll have a trailing fail target
-        assert(prev_false_jump);
-        prev_false_jump->target = current_instruction();
+            auto head = branch_clause_head(n);
+            shapes.push_back(head ? pattern_shape(*head) : std::nullopt);
+        }
+        const auto             rewind_to = current_end_slot;
+        std::vector<is::jump*> exit_instrs;
+        _compile_clause_dispatch(clause_dispatch{std::move(shapes)},
+                                 match_slot,
+                                 rewind_to,
+                                 [&](std::size_t i) {
+                                     auto [fail_jumps, end_jump]
+                                         = _compile_branch_clause(match_slot,
+                                                                  res_slot,
+                                                                  clauses[i],
+                                                                  tail);
+                                     exit_instrs.push_back(end_jump);
+                                     return fail_jumps;
+                                 });
         builder.push_instr(is::rewind{rewind_to});
         current_end_slot = rewind_to;
         if (meta.fn_details()) {
@@ -690,10 +1086,11 @@ struct block_compiler {
         return res_slot;
     }
 
-    std::pair<is::false_jump*, is::jump*> _compile_branch_clause(slot_ref_t       match_slot,
-                                                                 slot_ref_t       res_slot,
-                                                                 const ast::node& n,
-                                                                 tail_call        tail) {
+    std::pair<std::vector<is::false_jump*>, is::jump*>
+    _compile_branch_clause(slot_ref_t       match_slot,
+                           slot_ref_t       res_slot,
+                           const ast::node& n,
+                           tail_call        tail) {
         auto call = n.as_call();
         assert(call);
         auto arrow = call->target().as_symbol();
@@ -710,16 +1107,15 @@ struct block_compiler {
         auto& rhs = args->nodes[1];
         // Each clause gets it's own new scope
         variable_scopes.emplace_back();
-        // Compile the test expression:
-        binding_expr_depth++;
+        // Compile the test expression. Each test jumps away if it fails, to
+        // be resolved later:
+        std::vector<is::false_jump*> fail_jumps;
+        auto                         fail = [&] {
+            fail_jumps.push_back(&builder.push_instr(is::false_jump{invalid_inst}));
+        };
         clause_test_depth++;
-        auto test_slot = compile(lhs);
+        _compile_destructure(lhs, match_slot, fail);
         clause_test_depth--;
-        binding_expr_depth--;
-        // Do a conditional jump
-        builder.push_instr(is::try_match{test_slot, match_slot});
-        // Jump will be resolved later:
-        auto fail_jump = &builder.push_instr(is::false_jump{invalid_inst});
         // Now compile our right-hand side
         auto rhs_slot = compile(rhs, tail);
         // Add an instruction to put the result of our RHS into the result slot
@@ -727,7 +1123,7 @@ struct block_compiler {
         // Jump to the rewind trampoline
         auto exit_jump = &builder.push_instr(is::jump{invalid_inst});
         variable_scopes.pop_back();
-        return {fail_jump, exit_jump};
+        return {std::move(fail_jumps), exit_jump};
     }
 
     void _find_closure_variables(const ast::node& node, capture_list& dest) {
@@ -818,34 +1214,134 @@ struct block_compiler {
         return consume_slot();
     }
 
+    /**
+     * Compile the clauses of a function. The arguments are passed in the slots
+     * following the captures, one slot per argument, and `enter_args` pads
+     * them to the largest arity of any clause. Each clause first checks the
+     * number of arguments, then matches its parameters against their slots
+     * directly. Clauses are dispatched on the argument whose patterns tell
+     * them apart best. The arguments are only gathered into a tuple if no
+     * clause matches, to report the failure.
+     */
     slot_ref_t _compile_anon_fn_inner(const std::vector<ast::node>& args, const ast::meta& meta) {
-        // The argument is always the first slot (after captures):
-        const slot_ref_t arg_slot = consume_slot();
-        // Convert the clause list into a case statement that we match against
-        // with the argument list
-        std::vector<ast::node> new_clauses;
+        struct fn_clause {
+            const std::vector<ast::node>& params;
+            const ast::node&              body;
+        };
+        std::vector<fn_clause> clauses;
+        std::size_t            max_arity = 0;
         for (auto& clause : args) {
             auto call = clause.as_call();
             assert(call);
+            auto arrow = call->target().as_symbol();
+            if (!arrow || arrow->string() != "->") {
+                throw compile_error{"Invalid clause. Must have an l2r arrow", call->meta()};
+            }
             auto arg_list = call->arguments().as_list();
             assert(arg_list);
-            auto fn_args     = arg_list->nodes[0];
-            auto fn_arg_list = fn_args.as_list();
+            assert(arg_list->nodes.size() == 2);
+            auto fn_arg_list = arg_list->nodes[0].as_list();
             assert(fn_arg_list);
-            auto                   fn_arg_tup = ast::tuple(std::move(fn_arg_list->nodes));
-            std::vector<ast::node> new_args;
-            std::vector<ast::node> oneoff;
-            oneoff.push_back(std::move(fn_arg_tup));
-            new_args.push_back(ast::list(std::move(oneoff)));
-            new_args.push_back(arg_list->nodes[1]);
-            new_clauses.emplace_back(
-                ast::node(ast::call(symbol("->"), {}, ast::list(std::move(new_args)))));
-        }
-        // Compile the code for the actual anon fn. Enable TCO for the inner branches.
-        return _compile_branches(arg_slot,
-                                 ast::list(std::move(new_clauses)),
-                                 meta,
-                                 tail_call::enable);
+            clauses.push_back(fn_clause{fn_arg_list->nodes, arg_list->nodes[1]});
+            max_arity = (std::max)(max_arity, fn_arg_list->nodes.size());
+        }
+        assert(!clauses.empty());
+
+        const slot_ref_t first_arg = current_end_slot;
+        const auto       entry     = current_instruction();
+        auto&            enter     = builder.push_instr(
+            is::enter_args{first_arg, static_cast<std::int64_t>(max_arity), invalid_inst});
+        auto outer_self_fn = std::move(self_fn);
+        self_fn.reset();
+        if (auto dets = meta.fn_details()) {
+            self_fn = self_function{dets->first, dets->second, first_arg, max_arity, entry};
+        }
+        current_end_slot.index += max_arity;
+        // Create a binding slot where the result of the function will go
+        auto res_slot = consume_slot();
+        builder.push_instr(is::const_binding_slot{res_slot});
+
+        // Dispatch on the argument whose patterns differ in shape the most
+        std::size_t dispatch_arg = 0;
+        std::size_t best_shaped  = 0;
+        for (auto arg = 0u; arg < max_arity; ++arg) {
+            std::size_t n_shaped = 0;
+            for (auto& clause : clauses) {
+                if (arg < clause.params.size() && pattern_shape(clause.params[arg])) {
+                    ++n_shaped;
+                }
+            }
+            if (n_shaped > best_shaped) {
+                dispatch_arg = arg;
+                best_shaped  = n_shaped;
+            }
+        }
+        std::vector<std::optional<is::shape_key>> shapes;
+        for (auto& clause : clauses) {
+            shapes.push_back(dispatch_arg < clause.params.size()
+                                 ? pattern_shape(clause.params[dispatch_arg])
+                                 : std::nullopt);
+        }
+
+        const auto             rewind_to = current_end_slot;
+        std::vector<is::jump*> exit_instrs;
+        _compile_clause_dispatch(
+            clause_dispatch{std::move(shapes)},
+            slot_ref_t{first_arg.index + dispatch_arg},
+            rewind_to,
+            [&](std::size_t clause_idx) {
+                auto& clause = clauses[clause_idx];
+                // Each clause gets it's own new scope
+                variable_scopes.emplace_back();
+                // Jumps will be resolved by the dispatch:
+                std::vector<is::false_jump*> fail_jumps;
+                auto                         fail = [&] {
+                    fail_jumps.push_back(&builder.push_instr(is::false_jump{invalid_inst}));
+                };
+                builder.push_instr(
+                    is::test_arity{static_cast<std::int64_t>(clause.params.size())});
+                fail();
+                clause_test_depth++;
+                for (auto i = 0u; i < clause.params.size(); ++i) {
+                    // A plain parameter names its argument slot. Binding a
+                    // copy would keep the argument shared for the whole call.
+                    _compile_destructure(clause.params[i],
+                                         slot_ref_t{first_arg.index + i},
+                                         fail);
+                }
+                clause_test_depth--;
+                auto rhs_slot = compile(clause.body, tail_call::enable);
+                builder.push_instr(is::hard_match{res_slot, rhs_slot});
+                exit_instrs.push_back(&builder.push_instr(is::jump{invalid_inst}));
+                variable_scopes.pop_back();
+                return fail_jumps;
+            });
+        builder.push_instr(is::rewind{rewind_to});
+        current_end_slot = rewind_to;
+
+        // No clause matched, or there were too many arguments for any of them
+        enter.overflow = current_instruction();
+        builder.push_instr(is::collect_args{first_arg});
+        current_end_slot = slot_ref_t{first_arg.index + 1};
+        if (meta.fn_details()) {
+            auto& dets        = *meta.fn_details();
+            auto  fname_str   = dets.first + "." + dets.second;
+            auto  fname_slot  = compile(ast::node(fname_str));
+            auto  badarg_slot = compile("badarg"_sym);
+            builder.push_instr(is::mk_tuple_3{badarg_slot, fname_slot, first_arg});
+            auto raise_tup_slot = consume_slot();
+            builder.push_instr(is::raise{raise_tup_slot});
+        } else {
+            builder.push_instr(is::no_clause{first_arg});
+        }
+
+        for (auto jump : exit_instrs) {
+            jump->target = current_instruction();
+        }
+        builder.push_instr(is::rewind{rewind_to});
+        current_end_slot = rewind_to;
+        self_fn          = std::move(outer_self_fn);
+        return res_slot;
     }
 
     /**
@@ -901,7 +1397,31 @@ struct block_compiler {
         return _compile_quoted(rhs);
     }
 
-    slot_ref_t _compile_quoted(const ast::node& node) { return node.visit(*this, expand_quoted{}); }
+    /**
+     * Quoted expressions have no variables in them, so the value of one is
+     * always a constant
+     */
+    slot_ref_t _compile_quoted(const ast::node& node) {
+        return _compile_constant(node.visit(quoted_value{}));
+    }
+
+    /**
+     * Push a constant. Integers, reals, and symbols are held in their
+     * instruction. Anything else is built once, into the constant pool, rather
+     * than every time the code runs.
+     */
+    slot_ref_t _compile_constant(lix::value val) {
+        if (auto i = val.as_integer()) {
+            builder.push_instr(is::const_int{*i});
+        } else if (auto r = val.as_real()) {
+            builder.push_instr(is::const_real{*r});
+        } else if (auto sym = val.as_symbol()) {
+            builder.push_instr(is::const_symbol{*sym});
+        } else {
+            builder.push_instr(is::load_const{builder.add_constant(std::move(val))});
+        }
+        return consume_slot();
+    }
 
     /**
      * ========================================================================
@@ -921,7 +1441,11 @@ struct block_compiler {
                 }
             }
         }
-        // Not a const, just a list
+        // Not a cons, just a list
+        if (auto vals = constant_values(l.nodes)) {
+            return _compile_constant(lix::list(std::make_move_iterator(vals->begin()),
+                                               std::make_move_iterator(vals->end())));
+        }
         std::vector<slot_ref_t> slots;
         for (auto& n : l.nodes) {
             auto next_slot = compile(n);
@@ -931,30 +1455,11 @@ struct block_compiler {
         return consume_slot();
     }
 
-    slot_ref_t operator()(const ast::list& list, expand_quoted) {
-        std::vector<slot_ref_t> slots;
-        for (auto& el : list.nodes) {
-            slots.push_back(_compile_quoted(el));
-        }
-        builder.push_instr(is::mk_list{std::move(slots)});
-        return consume_slot();
-    }
-
     /**
      * Compile a tuple
      */
     slot_ref_t operator()(const ast::tuple& tup, tail_call) { return _compile_tuple(tup.nodes); }
 
-    slot_ref_t operator()(const ast::tuple& t, expand_quoted) {
-        std::vector<slot_ref_t> slots;
-        for (auto& el : t.nodes) {
-            slots.push_back(_compile_quoted(el));
-        }
-        // TODO: Branch based on slot count
-        builder.push_instr(is::mk_tuple_n{std::move(slots)});
-        return consume_slot();
-    }
-
     /**
      * Compile a call. This is also where we "expand" intrinsic macros.
      *
@@ -997,14 +1502,6 @@ struct block_compiler {
         }
     }
 
-    slot_ref_t operator()(const ast::call& c, expand_quoted) {
-        auto target = _compile_quoted(c.target());
-        auto meta   = _compile_quoted(ast::node(ast::list()));
-        auto args   = _compile_quoted(c.arguments());
-        builder.push_instr(is::mk_tuple_3{target, meta, args});
-        return consume_slot();
-    }
-
     /**
      * Compile an integer literal. Simple.
      */
@@ -1032,10 +1529,7 @@ struct block_compiler {
     /**
      * Strings
      */
-    slot_ref_t operator()(const ast::string& s, drop_argument) {
-        builder.push_instr(is::const_str{s});
-        return consume_slot();
-    }
+    slot_ref_t operator()(const ast::string& s, drop_argument) { return _compile_constant(s); }
 };
 
 std::string make_error_whatstring(const std::string& what, lix::opt_ref<const ast::meta> meta) {
@@ -0,0 +1,98 @@
+#include "program.hpp"
+
+#include <lix/code/optimize.hpp>
+#include <lix/compiler/compile.hpp>
+#include <lix/compiler/macro.hpp>
+#include <lix/exec/context.hpp>
+#include <lix/exec/exec.hpp>
+#include <lix/exec/image.hpp>
+#include <lix/exec/kernel.hpp>
+#include <lix/parser/node.hpp>
+
+#include <algorithm>
+#include <cassert>
+
+using namespace lix;
+
+namespace {
+
+bool is_symbol(const ast::node& node, std::string_view name) {
+    auto sym = node.as_symbol();
+    return sym && *sym == symbol(name);
+}
+
+/// Check whether an expanded expression is a call to `__lix.compile_module`
+bool is_module_definition(const ast::node& node) {
+    auto call = node.as_call();
+    if (!call) {
+        return false;
+    }
+    auto dot = call->target().as_call();
+    if (!dot || !is_symbol(dot->target(), ".")) {
+        return false;
+    }
+    auto dot_args = dot->arguments().as_list();
+    return dot_args && dot_args->nodes.size() == 2
+        && is_symbol(dot_args->nodes[0], "__lix")
+        && is_symbol(dot_args->nodes[1], "compile_module");
+}
+
+/**
+ * Compile a module definition, as running the call to `__lix.compile_module`
+ * would, but with the given optimizer stats
+ */
+void compile_module_definition(exec::context&        ctx,
+                               const ast::node&      node,
+                               code::optimize_stats* optimized) {
+    // The arguments are the name and the quoted body. Evaluate them to get the
+    // body back as an AST
+    auto args = exec::executor(lix::compile(node.as_call()->arguments())).execute_all(ctx);
+    auto list = args.as_list();
+    assert(list && list->size() == 2);
+    auto iter = list->begin();
+    auto name = iter->as_symbol();
+    assert(name);
+    exec::compile_module(ctx, *name, ast::node::from_value(*++iter), optimized);
+}
+
+std::vector<ast::node> top_level_statements(const ast::node& node) {
+    if (auto call = node.as_call(); call && is_symbol(call->target(), "__block__")) {
+        if (auto stmts = call->arguments().as_list()) {
+            return stmts->nodes;
+        }
+    }
+    return {node};
+}
+
+}  // namespace
+
+std::string lix::compile_program(exec::context&        ctx,
+                                 const ast::node&      script,
+                                 code::optimize_stats* optimized) {
+    auto before   = ctx.module_names();
+    auto expanded = expand_macros(ctx, script);
+
+    std::vector<ast::node> entry_stmts;
+    for (auto& stmt : top_level_statements(expanded)) {
+        if (is_module_definition(stmt)) {
+            compile_module_definition(ctx, stmt, optimized);
+        } else {
+            entry_stmts.push_back(stmt);
+        }
+    }
+    if (entry_stmts.empty()) {
+        entry_stmts.push_back(ast::symbol("nil"));
+    }
+    auto entry = lix::compile(ast::call(symbol("__block__"), {}, ast::list(std::move(entry_stmts))));
+    if (optimized) {
+        entry = code::optimize(entry, optimized);
+    }
+
+    std::vector<std::string> new_modules;
+    for (auto& name : ctx.module_names()) {
+        if (std::find(before.begin(), before.end(), name) == before.end()) {
+            new_modules.push_back(name);
+        }
+    }
+    return exec::save_program_image(ctx, new_modules, entry);
+}
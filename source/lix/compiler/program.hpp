@@ -0,0 +1,43 @@
+#ifndef LIX_COMPILER_PROGRAM_HPP_INCLUDED
+#define LIX_COMPILER_PROGRAM_HPP_INCLUDED
+
+#include <string>
+
+namespace lix {
+
+namespace ast {
+
+class node;
+
+}  // namespace ast
+
+namespace exec {
+
+class context;
+
+}  // namespace exec
+
+namespace code {
+
+struct optimize_stats;
+
+}  // namespace code
+
+/**
+ * Compile a script to a program image that can be loaded with
+ * `exec::load_program_image()` without parsing or compiling anything.
+ *
+ * Module definitions at the top level of the script are evaluated in the given
+ * context at compile time, and the modules they define are saved in the image.
+ * The rest of the top level becomes the entry code of the image.
+ *
+ * If `optimized` is given, the code of the modules and of the entry is run
+ * through `code::optimize()`, and what it did is added to `optimized`.
+ */
+std::string compile_program(exec::context&        ctx,
+                            const ast::node&      script,
+                            code::optimize_stats* optimized = nullptr);
+
+}  // namespace lix
+
+#endif  // LIX_COMPILER_PROGRAM_HPP_INCLUDED
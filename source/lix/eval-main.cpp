@@ -1,17 +1,20 @@
 #include <lix/eval.hpp>
+#include <lix/exec/exec.hpp>
+#include <lix/exec/image.hpp>
 #include <lix/libs/libs.hpp>
+#include <lix/util/mapped_file.hpp>
 
 #include <fstream>
 #include <iostream>
 
 namespace {
-int run_istream(std::istream& in) {
-    std::string code;
-    using iter = std::istreambuf_iterator<char>;
-    std::copy(iter(in), iter{}, std::back_inserter(code));
+int run_code(std::string_view code) {
     try {
         auto ctx = lix::libs::create_context<lix::libs::Enum, lix::libs::IO>();
-        auto rc  = lix::eval(code, ctx);
+        auto rc  = lix::exec::is_module_image(code)
+            // Precompiled by `lix-compile -o`:
+            ? lix::exec::executor(lix::exec::load_program_image(ctx, code)).execute_all(ctx)
+            : lix::eval(code, ctx);
         std::cout << rc << '\n';
     } catch (const std::exception& e) {
         std::cerr << "FAIL: " << e.what() << '\n';
@@ -19,18 +22,26 @@ int run_istream(std::istream& in) {
     }
     return 0;
 }
+
+int run_istream(std::istream& in) {
+    std::string code;
+    using iter = std::istreambuf_iterator<char>;
+    std::copy(iter(in), iter{}, std::back_inserter(code));
+    return run_code(code);
+}
 }  // namespace
 
 namespace lix {
 
 int eval_main(int argc, char** argv, char** = nullptr) {
     if (argc == 2) {
-        std::ifstream in{argv[1]};
-        if (!in) {
-            std::cerr << "Failed to open filed: " << argv[1] << '\n';
+        try {
+            lix::mapped_file file{argv[1]};
+            return run_code(file.contents());
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << '\n';
             return 2;
         }
-        return run_istream(in);
     } else {
         return run_istream(std::cin);
     }
@@ -38,4 +49,4 @@ int eval_main(int argc, char** argv, char** = nullptr) {
 
 }  // namespace lix
 
-// int main(int argc, char** argv) { return lix::eval_main(argc, argv); }
+int main(int argc, char** argv) { return lix::eval_main(argc, argv); }
@@ -24,7 +24,13 @@ lix::value lix::eval(const lix::ast::node& node) {
 }
 
 lix::value lix::eval(std::string_view str, lix::exec::context& ctx) {
-    return eval(lix::ast::parse(str), ctx);
+    auto code = ctx.find_cached_code(str);
+    if (!code) {
+        code = lix::compile(expand_macros(ctx, lix::ast::parse(str)));
+        ctx.cache_code(str, *code);
+    }
+    lix::exec::executor exec{*code};
+    return exec.execute_all(ctx);
 }
 
 lix::value lix::eval(const lix::ast::node& node, lix::exec::context& ctx) {
@@ -28,7 +28,7 @@ value eval(const lix::exec::closure& fn, exec::context&, const lix::tuple&);
 
 template <typename Callable, typename... Args>
 lix::value call(exec::context& ctx, const Callable& c, Args&&... args) {
-    return eval(c, ctx, lix::tuple({lix::value(std::forward<Args>(args))...}));
+    return eval(c, ctx, lix::tuple::make(std::forward<Args>(args)...));
 }
 
 lix::value
@@ -36,7 +36,7 @@ call_mfa_tup(exec::context& ctx, lix::symbol mod, lix::symbol fn, const lix::tup
 
 template <typename... Args>
 lix::value call_mfa(exec::context& ctx, lix::symbol mod, lix::symbol fn, Args&&... args) {
-    return call_mfa_tup(ctx, mod, fn, lix::tuple({lix::value(std::forward<Args>(args))...}));
+    return call_mfa_tup(ctx, mod, fn, lix::tuple::make(std::forward<Args>(args)...));
 }
 
 } // namespace lix
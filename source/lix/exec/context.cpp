@@ -1,22 +1,107 @@
 #include "context.hpp"
 
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
 using namespace lix;
 using namespace lix::exec;
 
+namespace {
+
+std::uint64_t next_module_epoch() {
+    static std::atomic<std::uint64_t> counter{0};
+    return ++counter;
+}
+
+}  // namespace
+
 namespace lix::exec::detail {
 
+struct compile_cache_entry {
+    std::size_t   hash;
+    std::string   source;
+    std::uint64_t module_epoch;
+    code::code    code;
+};
+
+/// Compiled code by the hash of its source, evicting the least recently used
+struct compile_cache {
+    using lru_list = std::list<compile_cache_entry>;
+
+    std::size_t max_entries;
+    /// Most recently used first
+    lru_list                                            lru;
+    std::unordered_map<std::size_t, lru_list::iterator> entries;
+
+    void touch(lru_list::iterator iter) { lru.splice(lru.begin(), lru, iter); }
+
+    /// Drop the least recently used entries until at most `n` remain, and count them
+    std::size_t shrink_to(std::size_t n) {
+        std::size_t evicted = 0;
+        while (lru.size() > n) {
+            entries.erase(lru.back().hash);
+            lru.pop_back();
+            ++evicted;
+        }
+        return evicted;
+    }
+};
+
+using module_table = std::map<std::string, module, std::less<>>;
+
 class context_impl {
 public:
-    std::map<std::string, module, std::less<>>     _modules;
+    /// Modules shared with the contexts this one was forked from or into
+    std::shared_ptr<const module_table> _shared_modules;
+    /// Modules registered since this context was created or last forked
+    module_table                                   _modules;
     std::vector<std::map<std::string, lix::value>> _environments;
+    std::uint64_t                                  _module_epoch = next_module_epoch();
+    std::optional<compile_cache>                   _compile_cache;
+    compile_cache_stats                            _compile_cache_stats;
 
     friend struct inst_evaluator;
 
+    const module* find_module(std::string_view name) const {
+        auto iter = _modules.find(name);
+        if (iter != _modules.end()) {
+            return &iter->second;
+        }
+        if (_shared_modules) {
+            auto shared_iter = _shared_modules->find(name);
+            if (shared_iter != _shared_modules->end()) {
+                return &shared_iter->second;
+            }
+        }
+        return nullptr;
+    }
+
     void register_module(const std::string& name, module mod) {
+        if (_shared_modules && _shared_modules->count(name)) {
+            throw std::runtime_error{"Double-registered module: " + name};
+        }
         const auto did_insert = _modules.emplace(name, std::move(mod)).second;
         if (!did_insert) {
             throw std::runtime_error{"Double-registered module: " + name};
         }
+        _module_epoch = next_module_epoch();
+    }
+
+    /// Move our own modules into a new shared table, so that forks can share them
+    void freeze() {
+        if (_modules.empty()) {
+            return;
+        }
+        auto merged = _shared_modules ? std::make_shared<module_table>(*_shared_modules)
+                                      : std::make_shared<module_table>();
+        merged->merge(_modules);
+        _shared_modules = std::move(merged);
+        // The modules we shared before were copied into the new table, so
+        // whatever was resolved in the old one must be resolved again
+        _module_epoch = next_module_epoch();
     }
 };
 
@@ -34,13 +119,102 @@ void context::register_module(const std::string& name, lix::exec::module mod) {
     _impl->register_module(name, mod);
 }
 
+std::uint64_t context::module_epoch() const noexcept { return _impl->_module_epoch; }
+
+void context::freeze() { _impl->freeze(); }
+
+context context::fork() const {
+    context ret;
+    ret._impl->_shared_modules = _impl->_shared_modules;
+    if (_impl->_modules.empty()) {
+        // The fork resolves every name to the same module as we do
+        ret._impl->_module_epoch = _impl->_module_epoch;
+    } else {
+        // Modules that aren't frozen are copied, and the fork resolves their
+        // names to its own copies
+        ret._impl->_modules = _impl->_modules;
+    }
+    ret._impl->_environments = _impl->_environments;
+    if (_impl->_compile_cache) {
+        ret.enable_compile_cache(_impl->_compile_cache->max_entries);
+    }
+    return ret;
+}
+
+void context::enable_compile_cache(std::size_t max_entries) {
+    if (!_impl->_compile_cache) {
+        _impl->_compile_cache.emplace();
+    }
+    _impl->_compile_cache->max_entries = max_entries;
+    _impl->_compile_cache_stats.evictions += _impl->_compile_cache->shrink_to(max_entries);
+}
+
+void context::disable_compile_cache() { _impl->_compile_cache.reset(); }
+
+compile_cache_stats context::get_compile_cache_stats() const noexcept {
+    auto ret = _impl->_compile_cache_stats;
+    ret.size = _impl->_compile_cache ? _impl->_compile_cache->entries.size() : 0;
+    return ret;
+}
+
+std::optional<code::code> context::find_cached_code(std::string_view source) {
+    auto& cache = _impl->_compile_cache;
+    if (!cache) {
+        return std::nullopt;
+    }
+    auto iter = cache->entries.find(std::hash<std::string_view>()(source));
+    if (iter != cache->entries.end() && iter->second->module_epoch == _impl->_module_epoch
+        && iter->second->source == source) {
+        ++_impl->_compile_cache_stats.hits;
+        cache->touch(iter->second);
+        return iter->second->code;
+    }
+    ++_impl->_compile_cache_stats.misses;
+    return std::nullopt;
+}
+
+void context::cache_code(std::string_view source, const code::code& code) {
+    auto& cache = _impl->_compile_cache;
+    if (!cache) {
+        return;
+    }
+    const auto                  hash = std::hash<std::string_view>()(source);
+    detail::compile_cache_entry entry{hash, std::string(source), _impl->_module_epoch, code};
+    auto                        iter = cache->entries.find(hash);
+    if (iter != cache->entries.end()) {
+        // A stale entry, or a hash collision, is replaced
+        *iter->second = std::move(entry);
+        cache->touch(iter->second);
+        return;
+    }
+    if (cache->max_entries == 0) {
+        return;
+    }
+    _impl->_compile_cache_stats.evictions += cache->shrink_to(cache->max_entries - 1);
+    cache->lru.push_front(std::move(entry));
+    cache->entries.emplace(hash, cache->lru.begin());
+}
+
 std::optional<lix::exec::module> context::get_module(const std::string_view& name) const {
-    auto mod_iter = _impl->_modules.find(name);
-    if (mod_iter == _impl->_modules.end()) {
+    auto mod = _impl->find_module(name);
+    if (!mod) {
         return std::nullopt;
     } else {
-        return mod_iter->second;
+        return *mod;
+    }
+}
+
+std::vector<std::string> context::module_names() const {
+    std::vector<std::string> ret;
+    if (_impl->_shared_modules) {
+        for (auto& [name, _] : *_impl->_shared_modules) {
+            ret.push_back(name);
+        }
+    }
+    for (auto& [name, _] : _impl->_modules) {
+        ret.push_back(name);
     }
+    return ret;
 }
 
 void context::set_environment_value(const std::string& name, lix::value val) {
@@ -11,6 +11,7 @@
 #include <lix/boxed.hpp>
 
 #include <cassert>
+#include <cinttypes>
 #include <map>
 #include <optional>
 #include <stack>
@@ -26,6 +27,18 @@ class context_impl;
 
 }  // namespace detail
 
+/**
+ * Counters for the compile cache of a context. See
+ * `context::enable_compile_cache()`.
+ */
+struct compile_cache_stats {
+    std::uint64_t hits   = 0;
+    std::uint64_t misses = 0;
+    /// Entries dropped to make room for others
+    std::uint64_t evictions = 0;
+    std::size_t   size      = 0;
+};
+
 class context {
     std::unique_ptr<detail::context_impl> _impl;
 
@@ -38,13 +51,66 @@ public:
     context(context&&);
     context& operator=(context&&);
 
-    std::optional<module> get_module(const std::string_view& name) const;
+    std::optional<module>    get_module(const std::string_view& name) const;
+    std::vector<std::string> module_names() const;
 
     void                      set_environment_value(const std::string&, lix::value);
     std::optional<lix::value> get_environment_value(const std::string& name) const;
 
     void register_module(const std::string& name, module mod);
 
+    /**
+     * Get the module epoch of this context. The epoch changes every time a
+     * module is registered, and when `freeze()` moves modules. Contexts only
+     * share an epoch while they resolve every module name to the same module,
+     * as a fork of a frozen context does with it until either registers a
+     * module.
+     */
+    std::uint64_t module_epoch() const noexcept;
+
+    /**
+     * Move the modules registered in this context into a table that its forks
+     * share. Call this once a context is fully loaded, before using it as a
+     * template for others. Must not be called while code runs in this context.
+     */
+    void freeze();
+
+    /**
+     * Create a new context that shares the frozen modules of this one without
+     * copying them, which makes a frozen, fully loaded context a cheap template
+     * for others. Modules registered since the last `freeze()` are copied into
+     * the new context instead. Modules registered in either context afterwards
+     * are only visible in that context. The new context starts with a copy of
+     * this one's environments, and with a compile cache of the same size if
+     * this one has one.
+     *
+     * Modules are shared by reference, so they must not be modified once
+     * registered. Forking does not modify this context, so it is as
+     * thread-safe as its other const members.
+     */
+    context fork() const;
+
+    /**
+     * Enable caching of the code that `lix::eval()` compiles from source
+     * strings, so that evaluating the same source again in this context skips
+     * parsing, macro expansion, and compilation. Cached code is keyed on a hash
+     * of the source and on the module epoch, since registering modules can
+     * change how the source expands. Once the cache holds `max_entries`,
+     * the least recently used entry makes room for each new one.
+     */
+    void enable_compile_cache(std::size_t max_entries = 1024);
+    void disable_compile_cache();
+
+    compile_cache_stats get_compile_cache_stats() const noexcept;
+
+    /**
+     * Look up code compiled from the given source in the compile cache,
+     * counting a hit or a miss. Returns nothing if the cache is disabled.
+     */
+    std::optional<code::code> find_cached_code(std::string_view source);
+    /// Store compiled code in the compile cache, if it is enabled
+    void cache_code(std::string_view source, const code::code& code);
+
     template <typename Func>
     auto push_environment(Func&& fn) {
         try {
@@ -4,8 +4,15 @@
 
 #include <lix/refl_get_member.hpp>
 
+#include <lix/code/call_cache.hpp>
+#include <lix/code/op.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 
 using namespace lix;
 using namespace lix::exec;
@@ -22,75 +29,80 @@ namespace is = lix::code::is_types;
 
 namespace lix::exec::detail {
 
+/**
+ * A call frame. Frames are plain data so that the executor can keep them in a
+ * single vector and reuse its storage for every call. The code is borrowed:
+ * the executor pins each code block it enters for as long as it runs.
+ */
 class exec_frame {
-    code::code     _code;
-    code::iterator _first_instr   = _code.begin();
-    code::iterator _current_instr = _first_instr;
-    code::iterator _end_instr     = _code.end();
-    stack          _stack;
-    std::string    _ident;
+    const code::code*  _code;
+    const code::op*    _first_op;
+    const code::op*    _pc;
+    const code::op*    _end_op;
+    stack::size_type   _caller_base;
+    std::size_t        _argc;
+    const std::string* _ident = nullptr;
 
 public:
-    explicit exec_frame(code::code c)
-        : _code(c) {}
-
-    explicit exec_frame(code::code c, code::iterator instr_inner)
-        : _code(c)
-        , _current_instr(instr_inner) {}
-
-    const auto& get_and_advance() {
-        assert(_current_instr != _end_instr);
-        return *_current_instr++;
-    }
-
-    const lix::value& nth(slot_ref_t off) const { return _stack.nth(off); }
-
-#if EXEC_DEBUG
-    void debug_print() const {
-        if (_stack.size() == 0) {
-            cerr << "    [empty]\n";
-        }
-        for (auto i = 0u; i < _stack.size(); ++i) {
-            cerr << "    [" << std::setw(3) << i << "]  " << inspect(nth(slot_ref_t{i})) << '\n';
-        }
+    explicit exec_frame(const code::code& c,
+                        code::iterator    instr_inner,
+                        stack::size_type  caller_base,
+                        std::size_t       argc) {
+        reset(c, instr_inner, argc);
+        _caller_base = caller_base;
     }
-#endif
 
-    const lix::value& top() const {
-        assert(_stack.size() != 0);
-        return nth({_stack.size() - 1});
+    /// Re-target this frame at new code, as for a tail call
+    void reset(const code::code& c, code::iterator instr_inner, std::size_t argc) noexcept {
+        _code     = &c;
+        _first_op = c.op_begin();
+        _pc       = c.op_at(instr_inner);
+        _end_op   = _first_op + c.size();
+        _argc     = argc;
+        _ident    = nullptr;
     }
 
-    void push(lix::value el) { _stack.push(std::move(el)); }
-    void pop() {
-        assert(_stack.size() != 0);
-        rewind({_stack.size() - 1});
+    const code::op& fetch() {
+        assert(_pc != _end_op);
+        return *_pc++;
     }
 
     void jump(inst_offset_t target) {
-        auto avail = std::distance(_first_instr, _end_instr);
         assert(target.index > 0);
-        assert(target.index < static_cast<std::size_t>(avail));
-        _current_instr = _first_instr + target.index;
+        assert(target.index < static_cast<std::size_t>(_end_op - _first_op));
+        _pc = _first_op + target.index;
     }
 
-    void bind_slot(slot_ref_t slot, lix::value el) {
-        auto& dest = _stack.nth_mut(slot);
-        assert(dest.as_binding_slot() && "Binding to non-binding slot");
-        dest = std::move(el);
-    }
+    /// Set the frame identity. The name must be interned.
+    void        set_ident(const std::string& name) noexcept { _ident = &name; }
+    std::string ident() const { return _ident ? *_ident : std::string(); }
 
-    void               set_ident(const std::string& name) { _ident = name; }
-    const std::string& ident() const { return _ident; }
+    stack::size_type caller_base() const noexcept { return _caller_base; }
+    /// The number of arguments the frame's function was called with
+    std::size_t argc() const noexcept { return _argc; }
 
-    void rewind(slot_ref_t new_top) { _stack.rewind(new_top); }
+    /// Re-enter the frame's function at `entry` with new arguments, as for a self tail call
+    void loop(inst_offset_t entry, std::size_t argc) {
+        jump(entry);
+        _argc = argc;
+    }
 
-    const code::code& code() const { return _code; }
+    const code::code& code() const noexcept { return *_code; }
 };
 
 class executor_impl {
 public:
-    std::deque<exec_frame>    _call_frames;
+    /// Code kept alive for the frame at `depth`, and for any frames above it that borrow it
+    struct code_pin {
+        std::size_t depth;
+        code::code  code;
+    };
+
+    std::vector<exec_frame>   _call_frames;
+    std::deque<code_pin>      _pinned_code;
+    /// The pin most recently released, to be reused without touching its refcount
+    std::optional<code::code> _spare_pin;
+    stack                     _stack;
     bool                      _test_state = false;
     std::optional<lix::value> _bottom_ret;
 
@@ -104,38 +116,109 @@ public:
         return _call_frames.back();
     }
 
-    const lix::value& nth(slot_ref_t n) const { return _top_frame().nth(n); }
+    const lix::value& nth(slot_ref_t n) const { return _stack.nth(n); }
+
+#if EXEC_DEBUG
+    void debug_print() const {
+        if (_stack.size() == 0) {
+            cerr << "    [empty]\n";
+        }
+        for (auto i = 0u; i < _stack.size(); ++i) {
+            cerr << "    [" << std::setw(3) << i << "]  " << inspect(nth(slot_ref_t{i})) << '\n';
+        }
+    }
+#endif
+
+    void bind_slot(slot_ref_t slot, lix::value el) {
+        auto& dest = _stack.nth_mut(slot);
+        assert(dest.as_binding_slot() && "Binding to non-binding slot");
+        dest = std::move(el);
+    }
 
     void pop_frame_return(slot_ref_t r) {
-        auto rv = _top_frame().nth(r);
-        _call_frames.pop_back();
+        // The frame is going away, so we can steal the return value
+        auto rv = std::move(_stack.nth_mut(r));
+        _pop_frame();
         if (_call_frames.empty()) {
             _bottom_ret.emplace(std::move(rv));
         } else {
-            _top_frame().push(std::move(rv));
+            push(std::move(rv));
         }
     }
 
-    void push_frame(code::code c, code::iterator inst) { _call_frames.emplace_back(c, inst); }
-    void replace_frame(code::code c, code::iterator inst) {
-        _call_frames.back() = exec_frame(c, inst);
+    /**
+     * Keep the given code alive for as long as the frame at `depth` runs, and
+     * return a reference that the frame may borrow. Usually we are re-entering
+     * the code of the current frame, which outlives the new one, so that needs
+     * no pin of its own. A tail call from a frame that holds a pin replaces it.
+     */
+    const code::code& _pin(const code::code& c, std::size_t depth) {
+        if (!_call_frames.empty() && _top_frame().code().op_begin() == c.op_begin()) {
+            return _top_frame().code();
+        }
+        if (!_pinned_code.empty() && _pinned_code.back().depth == depth) {
+            _pinned_code.back().code = c;
+            return _pinned_code.back().code;
+        }
+        if (_spare_pin && _spare_pin->op_begin() == c.op_begin()) {
+            auto& pin = _pinned_code.emplace_back(code_pin{depth, std::move(*_spare_pin)});
+            _spare_pin.reset();
+            return pin.code;
+        }
+        return _pinned_code.emplace_back(code_pin{depth, c}).code;
     }
 
-    void push(value&& el) { _top_frame().push(std::move(el)); }
-    void push(const value& el) { _top_frame().push(el); }
-    void rewind(slot_ref_t slot) { _top_frame().rewind(slot); }
+    /// Pop the top frame and its values, and release its pin if it has one
+    void _pop_frame() noexcept {
+        _stack.pop_window(_top_frame().caller_base());
+        _call_frames.pop_back();
+        if (!_pinned_code.empty() && _pinned_code.back().depth == _call_frames.size()) {
+            _spare_pin = std::move(_pinned_code.back().code);
+            _pinned_code.pop_back();
+        }
+        if (_call_frames.empty()) {
+            _spare_pin.reset();
+        }
+    }
+
+    void push_frame(const code::code& c, code::iterator inst, std::size_t n_args = 0) {
+        auto& pinned = _pin(c, _call_frames.size());
+        _call_frames.emplace_back(pinned, inst, _stack.push_window(), n_args);
+    }
+    /**
+     * Replace the top frame for a tail call. The top `n_slots` values on the
+     * stack become the beginning of the new frame, which was called with
+     * `n_args` arguments.
+     */
+    void replace_frame(const code::code& c,
+                       code::iterator    inst,
+                       std::size_t       n_slots,
+                       std::size_t       n_args) {
+        // Pin first: `c` may belong to a value that is about to be discarded
+        auto& pinned = _pin(c, _call_frames.size() - 1);
+        _stack.slide_window(n_slots);
+        _top_frame().reset(pinned, inst, n_args);
+    }
+
+    void push(value&& el) { _stack.push(std::move(el)); }
+    void push(const value& el) { _stack.push(el); }
+    void rewind(slot_ref_t slot) { _stack.rewind(slot); }
 
     void jump(inst_offset_t target) { _top_frame().jump(target); }
 
-    inline void _exec_one(context& ctx);
+    void _run(context& ctx, std::size_t n);
 
     const code::code& current_code() const noexcept { return _top_frame().code(); }
 
-    std::optional<lix::value> execute_n(std::size_t n, context& ctx) {
-        while (!_call_frames.empty() && n) {
-            _exec_one(ctx);
-            --n;
+    /// Drop every frame, as when a raise escapes the executor
+    void unwind() noexcept {
+        while (!_call_frames.empty()) {
+            _pop_frame();
         }
+    }
+
+    std::optional<lix::value> execute_n(std::size_t n, context& ctx) {
+        _run(ctx, n);
         if (_call_frames.empty()) {
             assert(_bottom_ret);
             return _bottom_ret;
@@ -151,6 +234,7 @@ public:
     // we don't incure a table lookup each time we want a symbol
     const lix::symbol false_ = "false"_sym;
     const lix::symbol true_  = "true"_sym;
+    const lix::symbol nil_   = "nil"_sym;
 
 private:
     common_syms()                   = default;
@@ -202,68 +286,244 @@ public:
     void execute(is::const_int i) { ex.push(i.value); }
     void execute(is::const_real d) { ex.push(d.value); }
     void execute(is::const_symbol sym) { ex.push(lix::symbol{sym.sym}); }
-    void execute(const is::const_str& str) { ex.push(lix::string{str.string}); }
+    void execute(is::load_const c) { ex.push(ex.current_code().constants()[c.index]); }
     void execute(is::const_binding_slot s) { ex.push(binding_slot{s.slot}); }
 
     void execute(is::ret r) { ex.pop_frame_return(r.slot); }
 
-    void _call_closure(const exec::closure& closure, const lix::value& arg_tup, bool is_tail) {
-        if (is_tail) {
-            ex.replace_frame(closure.code(), closure.code_begin());
-        } else {
-            ex.push_frame(closure.code(), closure.code_begin());
+    /**
+     * Enter a closure. Arguments are passed as values on the stack following
+     * the captures, so `push_args` must push exactly `n_args` values.
+     */
+    template <typename PushArgs>
+    void _call_closure(const exec::closure& closure,
+                       std::size_t          n_args,
+                       PushArgs&&           push_args,
+                       bool                 is_tail) {
+        // NOTE: If the closure lives on the stack, the caller must have reserved
+        // room for the captures and the arguments, or else pushing them would
+        // move the closure out from under us.
+        const auto n_slots = closure.captures().size() + n_args;
+        ex._stack.reserve(n_slots);
+        if (!is_tail) {
+            ex.push_frame(closure.code(), closure.code_begin(), n_args);
         }
         for (auto& el : closure.captures()) {
             ex.push(el);
         }
-        ex.push(std::move(arg_tup));
+        push_args();
+        if (is_tail) {
+            ex.replace_frame(closure.code(), closure.code_begin(), n_slots, n_args);
+        }
+    }
+
+    /**
+     * The arguments of a tail call that may be moved out of the caller's
+     * frame, as a mask for `arg_refs`. The frame dies with the call, so only
+     * the callee itself and slots that are passed more than once must be left
+     * alone.
+     */
+    static std::uint64_t _tail_movable_args(const std::vector<slot_ref_t>& args,
+                                            const slot_ref_t*              callee) {
+        std::uint64_t movable = 0;
+        for (auto i = 0u; i < args.size() && i < 64; ++i) {
+            auto same_slot = [&](slot_ref_t other) { return other.index == args[i].index; };
+            if (callee && same_slot(*callee)) {
+                continue;
+            }
+            if (std::count_if(args.begin(), args.end(), same_slot) == 1) {
+                movable |= std::uint64_t(1) << i;
+            }
+        }
+        return movable;
+    }
+
+    /**
+     * Enter a closure with arguments taken from slots of the current frame.
+     * The slots in `movable` are moved rather than copied.
+     */
+    void _call_closure(const exec::closure&           closure,
+                       const std::vector<slot_ref_t>& args,
+                       bool                           is_tail,
+                       std::uint64_t                  movable = 0) {
+        ex._stack.reserve(closure.captures().size() + args.size());
+        // Entering a new frame moves the window, so hold on to the caller's
+        lix::value* caller = ex._stack.window_data();
+        _call_closure(
+            closure,
+            args.size(),
+            [&] {
+                for (auto i = 0u; i < args.size(); ++i) {
+                    auto& arg = caller[args[i].index];
+                    if (i < 64 && (movable >> i) & 1) {
+                        ex.push(std::move(arg));
+                    } else {
+                        ex.push(arg);
+                    }
+                }
+            },
+            is_tail);
+    }
+
+    /// Call a native function, lending it the argument slots of the current frame
+    lix::value _call_native(const lix::exec::function&     fn,
+                            const std::vector<slot_ref_t>& args,
+                            std::uint64_t                  movable = 0) {
+        // Most calls have few enough arguments to keep their refs on the C++ stack
+        constexpr std::size_t max_inline_args = 8;
+
+        std::array<const lix::value*, max_inline_args> inline_refs;
+        std::vector<const lix::value*>                 more_refs;
+        const lix::value**                             refs = inline_refs.data();
+        if (args.size() > max_inline_args) {
+            more_refs.resize(args.size());
+            refs = more_refs.data();
+        }
+        for (auto i = 0u; i < args.size(); ++i) {
+            refs[i] = &ex.nth(args[i]);
+        }
+        try {
+            return fn.call_args(ctx, arg_refs{refs, args.size(), movable});
+        } catch (const lix::compile_error& e) {
+            _raise_tuple("CompileError"_sym, e.line(), e.column(), e.what());
+        } catch (const std::runtime_error& e) {
+            _raise_tuple("RuntimeError"_sym, e.what());
+        }
     }
 
     template <typename CallInstr>
     void _dyn_call(const CallInstr& c, bool is_tail) {
-        auto& callee = ex.nth(c.fn);
-        auto  arg    = ex.nth(c.arg);
-        if (auto closure = callee.as_closure()) {
-            _call_closure(*closure, arg, is_tail);
-        } else if (auto fn = callee.as_function()) {
-            ex.push(_call_ll(*fn, arg));
+        const auto movable = is_tail ? _tail_movable_args(c.args, &c.fn) : 0;
+        if (auto closure = ex.nth(c.fn).as_closure()) {
+            // The closure is on the stack. Make room for the new frame, then
+            // look it up again in case it moved.
+            ex._stack.reserve(closure->captures().size() + c.args.size());
+            closure = ex.nth(c.fn).as_closure();
+            _call_closure(*closure, c.args, is_tail, movable);
+        } else if (auto fn = ex.nth(c.fn).as_function()) {
+            ex.push(_call_native(*fn, c.args, movable));
         } else {
-            _raise_tuple("badcall"_sym, callee);
+            _raise_tuple("badcall"_sym, ex.nth(c.fn));
         }
     }
-    void execute(is::call c) { _dyn_call(c, false); }
-    void execute(is::tail c) { _dyn_call(c, true); }
+    void execute(const is::call& c) { _dyn_call(c, false); }
+    void execute(const is::tail& c) { _dyn_call(c, true); }
 
-    template <typename CallInstr>
-    void _mfa_call(const CallInstr& c, bool is_tail) {
-        std::vector<lix::value> vals;
-        for (auto slot : c.args) {
-            vals.push_back(ex.nth(slot));
-        }
-        auto tup = lix::tuple(std::move(vals));
-        auto mod = ctx.get_module(c.module.string());
+    const code::call_cache_table::target_type* _resolve_mfa(lix::symbol modname,
+                                                            lix::symbol fn_name) const {
+        auto mod = ctx.get_module(modname.string());
         if (!mod) {
-            _raise_tuple("undefined"_sym, c.module);
+            _raise_tuple("undefined"_sym, modname);
         }
-        auto fun = mod->get_function(c.fn.string());
+        auto fun = mod->find_function(fn_name.string());
         if (!fun) {
-            _raise_tuple("undefined"_sym, c.module, c.fn);
+            _raise_tuple("undefined"_sym, modname, fn_name);
         }
-        if (auto closure = std::get_if<lix::exec::closure>(&*fun)) {
-            _call_closure(*closure, tup, is_tail);
-        } else if (auto native_fn = std::get_if<lix::exec::function>(&*fun)) {
-            ex.push(_call_ll(*native_fn, tup));
+        return fun;
+    }
+
+    template <typename CallInstr>
+    void _mfa_call(const CallInstr& c, std::uint32_t cache_site, bool is_tail) {
+        // Check the inline cache of this call site before doing any lookups
+        auto&      caches = ex.current_code().call_caches();
+        const auto epoch  = ctx.module_epoch();
+        auto       fun    = caches.lookup(cache_site, epoch);
+        if (!fun) {
+            fun = _resolve_mfa(c.module, c.fn);
+            caches.update(cache_site, epoch, fun);
+        }
+        const auto movable = is_tail ? _tail_movable_args(c.args, nullptr) : 0;
+        if (auto closure = std::get_if<lix::exec::closure>(fun)) {
+            _call_closure(*closure, c.args, is_tail, movable);
+        } else if (auto native_fn = std::get_if<lix::exec::function>(fun)) {
+            ex.push(_call_native(*native_fn, c.args, movable));
         } else {
             assert(false && "Unreachable");
             std::terminate();
         }
     }
 
-    void execute(const is::call_mfa& c) { _mfa_call(c, false); }
-    void execute(const is::tail_mfa& t) { _mfa_call(t, true); }
+    void execute(const code::op& op, const is::call_mfa& c) { _mfa_call(c, op.a, false); }
+    void execute(const code::op& op, const is::tail_mfa& t) { _mfa_call(t, op.a, true); }
+
+    void execute(const is::tail_self& t) {
+        // The new arguments may be read from the parameters they replace, so
+        // gather them above everything else before moving them into place.
+        // Arguments that are passed on unchanged stay where they are.
+        const auto movable = _tail_movable_args(t.args, nullptr);
+        const auto n_args  = t.args.size();
+        auto       changed = [&](std::size_t i) { return t.args[i].index != t.first.index + i; };
+        const auto gathered = slot_ref_t{ex._stack.size()};
+        ex._stack.reserve(n_args);
+        for (auto i = 0u; i < n_args; ++i) {
+            if (!changed(i)) {
+                continue;
+            } else if (i < 64 && (movable & (std::uint64_t(1) << i))) {
+                ex.push(std::move(ex._stack.nth_mut(t.args[i])));
+            } else {
+                ex.push(ex.nth(t.args[i]));
+            }
+        }
+        auto src = gathered;
+        for (auto i = 0u; i < n_args; ++i) {
+            if (changed(i)) {
+                ex._stack.nth_mut(slot_ref_t{t.first.index + i})
+                    = std::move(ex._stack.nth_mut(src));
+                ++src.index;
+            }
+        }
+        ex.rewind(slot_ref_t{t.first.index + n_args});
+        ex._top_frame().loop(t.entry, n_args);
+    }
 
     void execute(is::jump j) { ex.jump(j.target); }
 
+    static bool _has_shape(const is::shape_key& key, const lix::value& val) {
+        switch (key.kind) {
+        case is::shape_kind::tuple: {
+            auto tup = val.as_tuple();
+            return tup && tup->size() == static_cast<std::size_t>(key.integer);
+        }
+        case is::shape_kind::tagged_tuple: {
+            auto tup = val.as_tuple();
+            if (!tup || tup->size() != static_cast<std::size_t>(key.integer) || tup->size() == 0) {
+                return false;
+            }
+            auto tag = (*tup)[0].as_symbol();
+            return tag && *tag == key.sym;
+        }
+        case is::shape_kind::empty_list: {
+            auto list = val.as_list();
+            return list && list->size() == 0;
+        }
+        case is::shape_kind::nonempty_list: {
+            auto list = val.as_list();
+            return list && list->size() != 0;
+        }
+        case is::shape_kind::symbol: {
+            auto sym = val.as_symbol();
+            return sym && *sym == key.sym;
+        }
+        case is::shape_kind::integer: {
+            auto i = val.as_integer();
+            return i && *i == key.integer;
+        }
+        }
+        assert(false && "Unreachable");
+        std::terminate();
+    }
+
+    void execute(const is::switch_shape& sw) {
+        auto& subject = ex.nth(sw.subject);
+        for (auto& c : sw.cases) {
+            if (_has_shape(c.key, subject)) {
+                ex.jump(c.target);
+                return;
+            }
+        }
+        ex.jump(sw.otherwise);
+    }
+
     void execute(is::test_true t) {
         auto value     = ex.nth(t.slot).as_symbol();
         ex._test_state = value && value->string() == "true";
@@ -420,16 +680,14 @@ public:
     }
 
     bool _do_match(const cons& lhs, const lix::list& list) {
-        auto& head = lhs.head;
-        auto& tail = lhs.tail;
         if (list.size() < 1) {
             return false;
         }
-        auto head_matched = _match(head, *list.begin());
+        auto head_matched = _match(ex.nth(lhs.head), *list.begin());
         if (!head_matched) {
             return false;
         }
-        return _match(tail, list.pop_front());
+        return _match(ex.nth(lhs.tail), list.pop_front());
     }
 
     bool _match(const lix::value& lhs, const lix::value& rhs) {
@@ -439,7 +697,7 @@ public:
             auto& lhs_value = ex.nth(lhs_slot);
             if (lhs_value.as_binding_slot()) {
                 // Unbound slot
-                ex._top_frame().bind_slot(lhs_slot, rhs);
+                ex.bind_slot(lhs_slot, rhs);
                 return true;
             } else {
                 // Check that the already-bound value is equivalent to the
@@ -510,35 +768,84 @@ public:
         }
         execute(is::try_match{mat.lhs, mat.rhs});
     }
-    void execute(is::mk_tuple_0) { ex.push(lix::tuple{{}}); }
-    void execute(is::mk_tuple_1 t) { ex.push(lix::tuple{{ex.nth(t.a)}}); }
-    void execute(is::mk_tuple_2 t) { ex.push(lix::tuple{{ex.nth(t.a), ex.nth(t.b)}}); }
-    void execute(is::mk_tuple_3 t) { ex.push(lix::tuple{{ex.nth(t.a), ex.nth(t.b), ex.nth(t.c)}}); }
+    /*
+     * The destructuring matches. Values refer to their contents from the heap,
+     * so the elements stay valid while pushing moves the stack.
+     */
+    void execute(is::match_tuple m) {
+        auto tup       = ex.nth(m.subject).as_tuple();
+        ex._test_state = tup && tup->size() == static_cast<std::size_t>(m.arity);
+        if (ex._test_state) {
+            for (auto el = tup->val_begin(); el != tup->val_end(); ++el) {
+                ex.push(*el);
+            }
+        }
+    }
+    void execute(is::match_list m) {
+        auto list      = ex.nth(m.subject).as_list();
+        ex._test_state = list && list->size() == static_cast<std::size_t>(m.length);
+        if (ex._test_state) {
+            for (auto& el : *list) {
+                ex.push(el);
+            }
+        }
+    }
+    void execute(is::match_cons m) {
+        auto list      = ex.nth(m.subject).as_list();
+        ex._test_state = list && list->size() != 0;
+        if (ex._test_state) {
+            ex.push(*list->begin());
+            ex.push(list->pop_front());
+        }
+    }
+    void execute(is::test_equal t) { ex._test_state = ex.nth(t.a) == ex.nth(t.b); }
+    void execute(is::hard_match_jump m) {
+        auto binding = ex.nth(m.lhs).as_binding_slot();
+        if (m.move_rhs && binding && binding->slot != m.rhs
+            && ex.nth(binding->slot).as_binding_slot()) {
+            // The right-hand side is about to be rewound, so hand it over
+            ex.bind_slot(binding->slot, std::move(ex._stack.nth_mut(m.rhs)));
+        } else {
+            execute(is::hard_match{m.lhs, m.rhs});
+        }
+        ex.jump(m.target);
+    }
+    void execute(is::check_match c) {
+        if (!ex._test_state) {
+            _raise_tuple("badmatch"_sym, ex.nth(c.subject));
+        }
+    }
+
+    void execute(is::mk_tuple_0) { ex.push(lix::tuple::make()); }
+    void execute(is::mk_tuple_1 t) { ex.push(lix::tuple::make(ex.nth(t.a))); }
+    void execute(is::mk_tuple_2 t) { ex.push(lix::tuple::make(ex.nth(t.a), ex.nth(t.b))); }
+    void execute(is::mk_tuple_3 t) {
+        ex.push(lix::tuple::make(ex.nth(t.a), ex.nth(t.b), ex.nth(t.c)));
+    }
     void execute(is::mk_tuple_4 t) {
-        ex.push(lix::tuple{{ex.nth(t.a), ex.nth(t.b), ex.nth(t.c), ex.nth(t.d)}});
+        ex.push(lix::tuple::make(ex.nth(t.a), ex.nth(t.b), ex.nth(t.c), ex.nth(t.d)));
     }
     void execute(is::mk_tuple_5 t) {
-        ex.push(lix::tuple{{ex.nth(t.a), ex.nth(t.b), ex.nth(t.c), ex.nth(t.d), ex.nth(t.e)}});
+        ex.push(lix::tuple::make(ex.nth(t.a), ex.nth(t.b), ex.nth(t.c), ex.nth(t.d), ex.nth(t.e)));
     }
     void execute(is::mk_tuple_6 t) {
-        ex.push(lix::tuple{
-            {ex.nth(t.a), ex.nth(t.b), ex.nth(t.c), ex.nth(t.d), ex.nth(t.e), ex.nth(t.f)}});
+        ex.push(lix::tuple::make(
+            ex.nth(t.a), ex.nth(t.b), ex.nth(t.c), ex.nth(t.d), ex.nth(t.e), ex.nth(t.f)));
     }
     void execute(is::mk_tuple_7 t) {
-        ex.push(lix::tuple{{ex.nth(t.a),
-                            ex.nth(t.b),
-                            ex.nth(t.c),
-                            ex.nth(t.d),
-                            ex.nth(t.e),
-                            ex.nth(t.f),
-                            ex.nth(t.g)}});
+        ex.push(lix::tuple::make(ex.nth(t.a),
+                                 ex.nth(t.b),
+                                 ex.nth(t.c),
+                                 ex.nth(t.d),
+                                 ex.nth(t.e),
+                                 ex.nth(t.f),
+                                 ex.nth(t.g)));
     }
     void execute(const is::mk_tuple_n& t) {
-        std::vector<lix::value> new_tup;
-        for (auto slot : t.slots) {
-            new_tup.push_back(ex.nth(slot));
-        }
-        ex.push(lix::tuple(std::move(new_tup)));
+        ex.push(lix::tuple::generate(t.slots.size(),
+                                     [&](std::size_t i) -> const lix::value& {
+                                         return ex.nth(t.slots[i]);
+                                     }));
     }
     void execute(const is::mk_list& l) {
         std::vector<lix::value> new_list;
@@ -549,16 +856,16 @@ public:
                           std::make_move_iterator(new_list.end())));
     }
     void execute(const is::mk_map& m) {
-        lix::map map;
+        lix::map_builder builder;
         for (auto slot : m.slots) {
             auto& pair = ex.nth(slot);
             auto  tup  = pair.as_tuple();
-            if (!tup && tup->size() != 2) {
+            if (!tup || tup->size() != 2) {
                 _raise_tuple("badarg"_sym, "%{}", pair);
             }
-            map = map.insert((*tup)[0], (*tup)[1]);
+            builder.insert((*tup)[0], (*tup)[1]);
         }
-        ex.push(std::move(map));
+        ex.push(builder.freeze());
     }
     void execute(const is::mk_closure& clos) {
         std::vector<lix::value> captured;
@@ -570,11 +877,7 @@ public:
                           std::move(captured));
         ex.push(std::move(cl));
     }
-    void execute(const is::mk_cons& c) {
-        auto& lhs = ex.nth(c.lhs);
-        auto& rhs = ex.nth(c.rhs);
-        ex.push(cons{lhs, rhs});
-    }
+    void execute(const is::mk_cons& c) { ex.push(cons{c.lhs, c.rhs}); }
     void execute(is::no_clause n) { _raise_tuple("nomatch"_sym, ex.nth(n.unmatched)); }
     void execute(is::dot d) {
         auto& lhs = ex.nth(d.object);
@@ -666,9 +969,7 @@ public:
         if (!arg_list) {
             lix::raise(tuple::make("einval"_sym, "Third argument to apply() must be a list"));
         }
-        std::vector<lix::value> argtup_els{arg_list->begin(), arg_list->end()};
-        auto                    arg_tup = lix::tuple(std::move(argtup_els));
-        auto                    mod     = ctx.get_module(modname_sym->string());
+        auto mod = ctx.get_module(modname_sym->string());
         if (!mod) {
             lix::raise(
                 tuple::make("einval"_sym, "No such module to apply(): " + modname_sym->string()));
@@ -680,15 +981,20 @@ public:
                                        + modname_sym->string() + "'"));
         }
         if (auto fun = std::get_if<lix::exec::function>(&*fn)) {
-            ex.push(_call_ll(*fun, arg_tup));
+            std::vector<lix::value> argtup_els{arg_list->begin(), arg_list->end()};
+            ex.push(_call_ll(*fun, lix::tuple(std::move(argtup_els))));
         } else {
             auto clos = std::get_if<lix::exec::closure>(&*fn);
             assert(clos);
-            ex.push_frame(clos->code(), clos->code_begin());
-            for (auto& el : clos->captures()) {
-                ex.push(el);
-            }
-            ex.push(std::move(std::move(arg_tup)));
+            _call_closure(
+                *clos,
+                arg_list->size(),
+                [&] {
+                    for (auto& el : *arg_list) {
+                        ex.push(el);
+                    }
+                },
+                false);
         }
     }
 
@@ -702,7 +1008,33 @@ public:
         }
     }
 
-    void execute(const is::frame_id& id) { ex._top_frame().set_ident(id.id); }
+    void execute(const is::frame_id& id) { ex._top_frame().set_ident(lix::symbol(id.id).string()); }
+
+    void execute(is::enter_args e) {
+        const auto argc  = ex._top_frame().argc();
+        const auto arity = static_cast<std::size_t>(e.arity);
+        assert(ex._stack.size() == e.first.index + argc);
+        if (argc > arity) {
+            ex.jump(e.overflow);
+            return;
+        }
+        // Fill in the parameters that this call doesn't have
+        for (auto n = argc; n < arity; ++n) {
+            ex.push(sym.nil_);
+        }
+    }
+
+    void execute(is::test_arity t) {
+        ex._test_state = ex._top_frame().argc() == static_cast<std::size_t>(t.arity);
+    }
+
+    void execute(is::collect_args c) {
+        auto args = lix::tuple::generate(ex._top_frame().argc(), [&](std::size_t i) {
+            return std::move(ex._stack.nth_mut(slot_ref_t{c.first.index + i}));
+        });
+        ex.rewind(c.first);
+        ex.push(std::move(args));
+    }
 
     void _dot_boxed(const lix::boxed& b, const std::string& member) {
         auto val = b.get_member(member);
@@ -712,17 +1044,397 @@ public:
 
 }  // namespace lix::exec::detail
 
-void lix::exec::detail::executor_impl::_exec_one(context& ctx) {
-    const auto& instr = _top_frame().get_and_advance();
+/**
+ * The instruction dispatch loop. Each handler ends by fetching the next op from
+ * the top frame and dispatching on its opcode directly. With GCC and Clang we
+ * use computed goto so that every handler has its own indirect branch.
+ * Elsewhere, we fall back to a switch in a loop.
+ */
+#ifndef LIX_EXEC_COMPUTED_GOTO
+#if defined(__GNUC__) || defined(__clang__)
+#define LIX_EXEC_COMPUTED_GOTO 1
+#else
+#define LIX_EXEC_COMPUTED_GOTO 0
+#endif
+#endif
+
 #if EXEC_DEBUG
-    cerr << "lix::exec::detail::executor_impl::_exec_one\n";
-    cerr << "  Stack contents:\n";
-    _top_frame().debug_print();
-    cerr << "  execute -> " << instr << '\n' << endl;
+#define LIX_EXEC_DEBUG_OP()                                                                        \
+    cerr << "lix::exec::detail::executor_impl::_run\n";                                            \
+    cerr << "  Stack contents:\n";                                                                 \
+    debug_print();                                                                                 \
+    cerr << "  execute -> " << *op->src << '\n'                                                    \
+         << endl
+#else
+#define LIX_EXEC_DEBUG_OP() static_assert(true)
+#endif
+
+#define LIX_FETCH()                                                                                \
+    if (n == 0 || _call_frames.empty()) {                                                          \
+        return;                                                                                    \
+    }                                                                                              \
+    --n;                                                                                           \
+    op = &_top_frame().fetch();                                                                    \
+    LIX_EXEC_DEBUG_OP()
+
+#if LIX_EXEC_COMPUTED_GOTO
+#define LIX_OP(name) op_##name:
+#define LIX_NEXT()                                                                                 \
+    LIX_FETCH();                                                                                   \
+    goto* dispatch_table[static_cast<std::size_t>(op->code)]
+#else
+#define LIX_OP(name) case code::opcode::name:
+#define LIX_NEXT() break
+#endif
+
+#if LIX_EXEC_COMPUTED_GOTO && defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+void lix::exec::detail::executor_impl::_run(context& ctx, std::size_t n) {
+    exec_visitor    vis{ctx, *this};
+    const code::op* op = nullptr;
+    auto            s  = [](std::uint32_t idx) { return slot_ref_t{idx}; };
+    auto            o  = [](std::uint32_t idx) { return inst_offset_t{idx}; };
+
+#if LIX_EXEC_COMPUTED_GOTO
+    static const void* const dispatch_table[] = {
+#define X(name) &&op_##name,
+        LIX_CODE_OPCODES(X)
+#undef X
+    };
+    LIX_NEXT();
+#else
+    for (;;) {
+        LIX_FETCH();
+        switch (op->code) {
+#endif
+
+    // Returns and calls
+    LIX_OP(ret) {
+        vis.execute(is::ret{s(op->a)});
+        LIX_NEXT();
+    }
+    LIX_OP(call) {
+        vis.execute(op->get<is::call>());
+        LIX_NEXT();
+    }
+    LIX_OP(tail) {
+        vis.execute(op->get<is::tail>());
+        LIX_NEXT();
+    }
+    LIX_OP(call_mfa) {
+        vis.execute(*op, op->get<is::call_mfa>());
+        LIX_NEXT();
+    }
+    LIX_OP(tail_mfa) {
+        vis.execute(*op, op->get<is::tail_mfa>());
+        LIX_NEXT();
+    }
+    LIX_OP(apply) {
+        vis.execute(is::apply{s(op->a), s(op->b), s(op->c)});
+        LIX_NEXT();
+    }
+
+    // Arithmetic and comparison
+    LIX_OP(add) {
+        vis.execute(is::add{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(sub) {
+        vis.execute(is::sub{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(mul) {
+        vis.execute(is::mul{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(div) {
+        vis.execute(is::div{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(eq) {
+        vis.execute(is::eq{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(neq) {
+        vis.execute(is::neq{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(concat) {
+        vis.execute(is::concat{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(negate) {
+        vis.execute(is::negate{s(op->a)});
+        LIX_NEXT();
+    }
+
+    // Constants
+    LIX_OP(const_int) {
+        push(op->imm.integer);
+        LIX_NEXT();
+    }
+    LIX_OP(const_real) {
+        push(op->imm.real);
+        LIX_NEXT();
+    }
+    LIX_OP(const_symbol) {
+        push(op->imm.symbol);
+        LIX_NEXT();
+    }
+    LIX_OP(load_const) {
+        push(*op->imm.constant);
+        LIX_NEXT();
+    }
+    LIX_OP(const_binding_slot) {
+        vis.execute(is::const_binding_slot{s(op->a)});
+        LIX_NEXT();
+    }
+
+    // Matching
+    LIX_OP(hard_match) {
+        vis.execute(is::hard_match{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(try_match) {
+        vis.execute(is::try_match{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(try_match_conj) {
+        vis.execute(is::try_match_conj{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(no_clause) {
+        vis.execute(is::no_clause{s(op->a)});
+        LIX_NEXT();
+    }
+
+    // Data structures
+    LIX_OP(mk_tuple_0) {
+        vis.execute(is::mk_tuple_0{});
+        LIX_NEXT();
+    }
+    LIX_OP(mk_tuple_1) {
+        vis.execute(is::mk_tuple_1{s(op->a)});
+        LIX_NEXT();
+    }
+    LIX_OP(mk_tuple_2) {
+        vis.execute(is::mk_tuple_2{{s(op->a)}, s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(mk_tuple_3) {
+        vis.execute(is::mk_tuple_3{{{s(op->a)}, s(op->b)}, s(op->c)});
+        LIX_NEXT();
+    }
+    LIX_OP(mk_tuple_4) {
+        vis.execute(op->get<is::mk_tuple_4>());
+        LIX_NEXT();
+    }
+    LIX_OP(mk_tuple_5) {
+        vis.execute(op->get<is::mk_tuple_5>());
+        LIX_NEXT();
+    }
+    LIX_OP(mk_tuple_6) {
+        vis.execute(op->get<is::mk_tuple_6>());
+        LIX_NEXT();
+    }
+    LIX_OP(mk_tuple_7) {
+        vis.execute(op->get<is::mk_tuple_7>());
+        LIX_NEXT();
+    }
+    LIX_OP(mk_tuple_n) {
+        vis.execute(op->get<is::mk_tuple_n>());
+        LIX_NEXT();
+    }
+    LIX_OP(mk_list) {
+        vis.execute(op->get<is::mk_list>());
+        LIX_NEXT();
+    }
+    LIX_OP(mk_map) {
+        vis.execute(op->get<is::mk_map>());
+        LIX_NEXT();
+    }
+    LIX_OP(mk_closure) {
+        vis.execute(op->get<is::mk_closure>());
+        LIX_NEXT();
+    }
+    LIX_OP(mk_cons) {
+        vis.execute(is::mk_cons{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(push_front) {
+        vis.execute(is::push_front{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+
+    // Control flow
+    LIX_OP(jump) {
+        jump(o(op->a));
+        LIX_NEXT();
+    }
+    LIX_OP(test_true) {
+        vis.execute(is::test_true{s(op->a)});
+        LIX_NEXT();
+    }
+    LIX_OP(false_jump) {
+        if (!_test_state) {
+            jump(o(op->a));
+        }
+        LIX_NEXT();
+    }
+    LIX_OP(rewind) {
+        rewind(s(op->a));
+        LIX_NEXT();
+    }
+    LIX_OP(raise) {
+        vis.execute(is::raise{s(op->a)});
+        LIX_NEXT();
+    }
+    LIX_OP(frame_id) {
+        _top_frame().set_ident(op->imm.symbol.string());
+        LIX_NEXT();
+    }
+    LIX_OP(enter_args) {
+        vis.execute(is::enter_args{s(op->a), static_cast<std::int64_t>(op->b), o(op->c)});
+        LIX_NEXT();
+    }
+    LIX_OP(test_arity) {
+        _test_state = _top_frame().argc() == op->a;
+        LIX_NEXT();
+    }
+    LIX_OP(collect_args) {
+        vis.execute(is::collect_args{s(op->a)});
+        LIX_NEXT();
+    }
+    LIX_OP(switch_shape) {
+        vis.execute(op->get<is::switch_shape>());
+        LIX_NEXT();
+    }
+    LIX_OP(match_tuple) {
+        vis.execute(is::match_tuple{s(op->a), static_cast<std::int64_t>(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(match_list) {
+        vis.execute(is::match_list{s(op->a), static_cast<std::int64_t>(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(match_cons) {
+        vis.execute(is::match_cons{s(op->a)});
+        LIX_NEXT();
+    }
+    LIX_OP(test_equal) {
+        vis.execute(is::test_equal{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(check_match) {
+        vis.execute(is::check_match{s(op->a)});
+        LIX_NEXT();
+    }
+    LIX_OP(tail_self) {
+        vis.execute(op->get<is::tail_self>());
+        LIX_NEXT();
+    }
+
+    // Superinstructions
+    LIX_OP(test_arity_jump) {
+        _test_state = _top_frame().argc() == op->a;
+        if (!_test_state) {
+            jump(o(op->c));
+        }
+        LIX_NEXT();
+    }
+    LIX_OP(match_tuple_jump) {
+        vis.execute(is::match_tuple{s(op->a), static_cast<std::int64_t>(op->b)});
+        if (!_test_state) {
+            jump(o(op->c));
+        }
+        LIX_NEXT();
+    }
+    LIX_OP(match_list_jump) {
+        vis.execute(is::match_list{s(op->a), static_cast<std::int64_t>(op->b)});
+        if (!_test_state) {
+            jump(o(op->c));
+        }
+        LIX_NEXT();
+    }
+    LIX_OP(match_cons_jump) {
+        vis.execute(is::match_cons{s(op->a)});
+        if (!_test_state) {
+            jump(o(op->c));
+        }
+        LIX_NEXT();
+    }
+    LIX_OP(test_equal_jump) {
+        _test_state = nth(s(op->a)) == nth(s(op->b));
+        if (!_test_state) {
+            jump(o(op->c));
+        }
+        LIX_NEXT();
+    }
+    LIX_OP(test_symbol_jump) {
+        auto sym    = nth(s(op->a)).as_symbol();
+        _test_state = sym && *sym == op->imm.symbol;
+        if (!_test_state) {
+            jump(o(op->c));
+        }
+        LIX_NEXT();
+    }
+    LIX_OP(test_int_jump) {
+        auto i      = nth(s(op->a)).as_integer();
+        _test_state = i && *i == op->imm.integer;
+        if (!_test_state) {
+            jump(o(op->c));
+        }
+        LIX_NEXT();
+    }
+    LIX_OP(hard_match_jump) {
+        vis.execute(is::hard_match_jump{s(op->a), s(op->b), o(op->c), op->imm.integer != 0});
+        LIX_NEXT();
+    }
+
+    // Intrinsics
+    LIX_OP(dot) {
+        vis.execute(is::dot{s(op->a), s(op->b)});
+        LIX_NEXT();
+    }
+    LIX_OP(is_list) {
+        vis.execute(is::is_list{s(op->a)});
+        LIX_NEXT();
+    }
+    LIX_OP(is_symbol) {
+        vis.execute(is::is_symbol{s(op->a)});
+        LIX_NEXT();
+    }
+    LIX_OP(is_string) {
+        vis.execute(is::is_string{s(op->a)});
+        LIX_NEXT();
+    }
+    LIX_OP(to_string) {
+        vis.execute(is::to_string{s(op->a)});
+        LIX_NEXT();
+    }
+    LIX_OP(inspect) {
+        vis.execute(is::inspect{s(op->a)});
+        LIX_NEXT();
+    }
+
+#if !LIX_EXEC_COMPUTED_GOTO
+        }
+    }
 #endif
-    instr.visit([&](const auto& i) { exec_visitor{ctx, *this}.execute(i); });
 }
 
+#if LIX_EXEC_COMPUTED_GOTO && defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#undef LIX_OP
+#undef LIX_NEXT
+#undef LIX_FETCH
+#undef LIX_EXEC_DEBUG_OP
+
 executor::executor()
     : _impl(std::make_unique<lix::exec::detail::executor_impl>()) {}
 
@@ -732,15 +1444,17 @@ executor::executor(const code::code& c, code::iterator iter)
 }
 executor::executor(const code::code& c)
     : executor(c, c.begin()) {}
-executor::executor(const exec::closure& clos, const lix::value& arg)
+executor::executor(const exec::closure& clos, const lix::tuple& args)
     : _impl(std::make_unique<lix::exec::detail::executor_impl>()) {
-    _impl->push_frame(clos.code(), clos.code_begin());
+    _impl->push_frame(clos.code(), clos.code_begin(), args.size());
     // Push the values it has captured
     for (auto& el : clos.captures()) {
         _impl->push(el);
     }
-    // And the initial argument
-    _impl->push(std::move(arg));
+    // And then each argument
+    for (auto i = 0u; i < args.size(); ++i) {
+        _impl->push(args[i]);
+    }
 }
 
 executor::~executor() = default;
@@ -753,8 +1467,36 @@ std::optional<lix::value> lix::exec::executor::execute_n(lix::exec::context& ctx
 }
 lix::value lix::exec::executor::execute_all(lix::exec::context& ctx) {
     while (!_impl->_call_frames.empty()) {
-        _impl->_exec_one(ctx);
+        _impl->_run(ctx, std::numeric_limits<std::size_t>::max());
     }
     assert(_impl->_bottom_ret);
     return *_impl->_bottom_ret;
 }
+
+lix::value lix::exec::executor::call(lix::exec::context& ctx,
+                                     const exec::closure& clos,
+                                     arg_refs             args) {
+    assert(_impl->_call_frames.empty() && "Executor is already running");
+    _impl->_bottom_ret.reset();
+    _impl->push_frame(clos.code(), clos.code_begin(), args.size());
+    for (auto& el : clos.captures()) {
+        _impl->push(el);
+    }
+    for (auto i = 0u; i < args.size(); ++i) {
+        if (args.movable(i)) {
+            _impl->push(std::move(args.take(i)));
+        } else {
+            _impl->push(args[i]);
+        }
+    }
+    try {
+        while (!_impl->_call_frames.empty()) {
+            _impl->_run(ctx, std::numeric_limits<std::size_t>::max());
+        }
+    } catch (...) {
+        _impl->unwind();
+        throw;
+    }
+    assert(_impl->_bottom_ret);
+    return std::move(*_impl->_bottom_ret);
+}
@@ -23,13 +23,21 @@ public:
     executor();
     explicit executor(const code::code&);
     executor(const code::code&, code::iterator);
-    executor(const closure&, const lix::value&);
+    executor(const closure&, const lix::tuple& args);
     ~executor();
     executor(executor&&);
     executor& operator=(executor&&);
 
     std::optional<lix::value> execute_n(exec::context&, std::size_t n);
     lix::value                execute_all(exec::context&);
+
+    /**
+     * Run a closure to completion and return its result. The executor must
+     * not be running anything else. Its stack and frames are kept for the next
+     * call, so native functions that call back into lix many times should
+     * reuse a single executor. Movable arguments are moved into the closure.
+     */
+    lix::value call(exec::context&, const closure&, arg_refs args);
 };
 
 }  // namespace lix::exec
@@ -5,6 +5,45 @@
 using namespace lix;
 using namespace lix::exec;
 
+function& function::operator=(const function& other) noexcept {
+    other._cell->add_ref();
+    if (_cell && _cell->drop_ref()) {
+        delete _func();
+    }
+    _cell = other._cell;
+    return *this;
+}
+
+function& function::operator=(function&& other) noexcept {
+    if (this != &other) {
+        if (_cell && _cell->drop_ref()) {
+            delete _func();
+        }
+        _cell = std::exchange(other._cell, nullptr);
+    }
+    return *this;
+}
+
+function::~function() {
+    if (_cell && _cell->drop_ref()) {
+        delete _func();
+    }
+}
+
+const exec::detail::erased_fn_base* function::_func() const noexcept {
+    return static_cast<const exec::detail::erased_fn_base*>(_cell);
+}
+
 lix::value function::call_ll(context& ctx, const lix::value& val) const {
-    return _func->call(ctx, val);
+    return _func()->call(ctx, val);
+}
+
+lix::value function::call_args(context& ctx, arg_refs args) const {
+    return _func()->call_args(ctx, args);
+}
+
+lix::value exec::detail::erased_fn_base::call_args(context& ctx, arg_refs args) const {
+    auto tup = lix::tuple::generate(args.size(),
+                                    [&](std::size_t i) -> const lix::value& { return args[i]; });
+    return call(ctx, tup);
 }
@@ -17,13 +17,23 @@ class context;
 
 namespace detail {
 
-class erased_fn_base {
+class erased_fn_base : public lix::detail::value_cell_base {
 public:
     virtual ~erased_fn_base() = default;
 
     virtual lix::value call(context&, const lix::value&) const = 0;
+    virtual lix::value call_args(context&, arg_refs) const;
 };
 
+template <typename Func, typename = void>
+struct has_call_args : std::false_type {};
+
+template <typename Func>
+struct has_call_args<Func,
+                     std::void_t<decltype(std::declval<const Func&>().call_args(
+                         std::declval<context&>(), std::declval<arg_refs>()))>>
+    : std::true_type {};
+
 template <typename Func>
 class erased_fn_impl : public erased_fn_base {
     Func _fn;
@@ -56,14 +66,21 @@ public:
         using ret_type = decltype(_fn(ctx, val));
         return _do_call(ctx, val, lix::tag<ret_type>{});
     }
+
+    lix::value call_args(context& ctx, arg_refs args) const override {
+        if constexpr (has_call_args<Func>::value) {
+            return _fn.call_args(ctx, args);
+        } else {
+            return erased_fn_base::call_args(ctx, args);
+        }
+    }
 };
 
 }  // namespace detail
 
 template <typename Function, typename Void, typename Any>
 function::function(Function&& fn)
-    : _func(std::make_shared<detail::erased_fn_impl<std::decay_t<Function>>>(
-          std::forward<Function>(fn))) {}
+    : _cell(new detail::erased_fn_impl<std::decay_t<Function>>(std::forward<Function>(fn))) {}
 
 inline std::ostream& operator<<(std::ostream& o, const function&) {
     o << "<lix::exec::function>";
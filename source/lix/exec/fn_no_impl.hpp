@@ -1,8 +1,12 @@
 #ifndef LIX_EXEC_FN_NO_IMPL_HPP_INCLUDED
 #define LIX_EXEC_FN_NO_IMPL_HPP_INCLUDED
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <type_traits>
+#include <utility>
 
 #include <lix/value_fwd.hpp>
 
@@ -10,6 +14,38 @@ namespace lix::exec {
 
 class context;
 
+/**
+ * The arguments of a native function call, borrowed from wherever the caller
+ * keeps them. The executor passes references to its stack slots this way, so
+ * that a call does not need to copy its arguments into a tuple.
+ */
+class arg_refs {
+    const lix::value* const* _refs;
+    std::size_t              _size;
+    std::uint64_t            _movable;
+
+public:
+    /**
+     * Bit `n` of `movable` says that the caller will not look at argument `n`
+     * again, so the callee may move from it. The caller must own those values
+     * mutably.
+     */
+    arg_refs(const lix::value* const* refs, std::size_t size, std::uint64_t movable = 0) noexcept
+        : _refs(refs)
+        , _size(size)
+        , _movable(movable) {}
+
+    std::size_t       size() const noexcept { return _size; }
+    const lix::value& operator[](std::size_t n) const noexcept { return *_refs[n]; }
+
+    bool movable(std::size_t n) const noexcept { return n < 64 && (_movable >> n) & 1; }
+    /// Argument `n`, for the callee to move from. It must be movable
+    lix::value& take(std::size_t n) const noexcept {
+        assert(movable(n));
+        return const_cast<lix::value&>(*_refs[n]);
+    }
+};
+
 namespace detail {
 
 class erased_fn_base;
@@ -17,7 +53,13 @@ class erased_fn_base;
 }  // namespace detail
 
 class function {
-    std::shared_ptr<const detail::erased_fn_base> _func;
+    /**
+     * The `detail::erased_fn_base`, which is also the cell of a value holding
+     * the function
+     */
+    const lix::detail::value_cell_base* _cell;
+
+    const detail::erased_fn_base* _func() const noexcept;
 
 public:
     template <typename Function,
@@ -27,9 +69,32 @@ public:
                                                                 std::declval<const lix::value&>()))>
     function(Function&& fn);
 
+    function(const function& other) noexcept
+        : _cell(other._cell) {
+        _cell->add_ref();
+    }
+    function(function&& other) noexcept
+        : _cell(std::exchange(other._cell, nullptr)) {}
+    function& operator=(const function&) noexcept;
+    function& operator=(function&&) noexcept;
+    ~function();
+
     lix::value call_ll(context&, const lix::value&) const;
+    /**
+     * Call with borrowed arguments. Functions that know their parameter types
+     * (see `lix::wrap_function()`) read them in place. Others receive a tuple
+     * built from them.
+     */
+    lix::value call_args(context&, arg_refs) const;
 };
 
 }  // namespace lix::exec
 
+namespace lix::detail {
+
+template <>
+struct is_cell_handle<lix::exec::function> : std::true_type {};
+
+}  // namespace lix::detail
+
 #endif  // LIX_EXEC_FN_NO_IMPL_HPP_INCLUDED
\ No newline at end of file
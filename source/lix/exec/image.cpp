@@ -0,0 +1,281 @@
+#include "image.hpp"
+
+#include <lix/code/instr.hpp>
+#include <lix/code/serialize.hpp>
+#include <lix/exec/context.hpp>
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <stdexcept>
+
+using namespace lix;
+using namespace lix::exec;
+
+using lix::code::byte_reader;
+using lix::code::byte_writer;
+using lix::code::string_table_reader;
+using lix::code::string_table_writer;
+
+namespace {
+
+constexpr std::string_view image_magic = "LIXM";
+
+enum class value_tag : std::uint8_t {
+    integer,
+    real,
+    symbol,
+    string,
+    tuple,
+    list,
+    closure,
+};
+
+class image_writer {
+    string_table_writer                    _strings;
+    byte_writer                            _codes;
+    byte_writer                            _body;
+    std::map<const code::op*, std::size_t> _code_indices;
+
+    std::size_t _code_index(const code::code& c) {
+        auto [iter, did_insert] = _code_indices.emplace(c.op_begin(), _code_indices.size());
+        if (did_insert) {
+            code::write_code(_codes, _strings, c);
+        }
+        return iter->second;
+    }
+
+    void _write_closure(const closure& cl) {
+        _body.write_uint(_code_index(cl.code()));
+        _body.write_uint(static_cast<std::size_t>(cl.code_begin() - cl.code().begin()));
+        _body.write_uint(cl.captures().size());
+        for (auto& cap : cl.captures()) {
+            _write_value(cap);
+        }
+    }
+
+    void _write_tag(value_tag t) { _body.write_byte(static_cast<std::uint8_t>(t)); }
+
+    void _write_value(const lix::value& val) {
+        if (auto i = val.as_integer()) {
+            _write_tag(value_tag::integer);
+            _body.write_int(*i);
+        } else if (auto r = val.as_real()) {
+            _write_tag(value_tag::real);
+            _body.write_real(*r);
+        } else if (auto sym = val.as_symbol()) {
+            _write_tag(value_tag::symbol);
+            _body.write_uint(_strings.intern(sym->string()));
+        } else if (auto str = val.as_string()) {
+            _write_tag(value_tag::string);
+            _body.write_uint(_strings.intern(*str));
+        } else if (auto tup = val.as_tuple()) {
+            _write_tag(value_tag::tuple);
+            _body.write_uint(tup->size());
+            for (auto i = 0u; i < tup->size(); ++i) {
+                _write_value((*tup)[i]);
+            }
+        } else if (auto list = val.as_list()) {
+            _write_tag(value_tag::list);
+            _body.write_uint(list->size());
+            for (auto& el : *list) {
+                _write_value(el);
+            }
+        } else if (auto cl = val.as_closure()) {
+            _write_tag(value_tag::closure);
+            _write_closure(*cl);
+        } else {
+            throw std::runtime_error{"Cannot save value in a module image: " + inspect(val)};
+        }
+    }
+
+public:
+    void write_module(const std::string& name, const module& mod) {
+        _body.write_uint(_strings.intern(name));
+        auto fn_names = mod.function_names();
+        _body.write_uint(fn_names.size());
+        for (auto& fn_name : fn_names) {
+            auto fn = mod.find_function(fn_name);
+            auto cl = std::get_if<closure>(fn);
+            if (!cl) {
+                throw std::runtime_error{"Cannot save native function " + name + "." + fn_name
+                                         + " in a module image"};
+            }
+            _body.write_uint(_strings.intern(fn_name));
+            _write_closure(*cl);
+        }
+    }
+
+    void write_entry(const code::code& entry) {
+        _body.write_byte(1);
+        _body.write_uint(_code_index(entry));
+    }
+
+    void write_no_entry() { _body.write_byte(0); }
+
+    std::string finish(std::size_t n_modules) {
+        byte_writer out;
+        out.write_raw(image_magic);
+        out.write_uint(code::bytecode_version);
+        _strings.write(out);
+        out.write_uint(_code_indices.size());
+        out.write_raw(_codes.bytes());
+        out.write_uint(n_modules);
+        out.write_raw(_body.bytes());
+        return out.release();
+    }
+};
+
+class image_reader {
+    byte_reader                        _in;
+    std::optional<string_table_reader> _strings;
+    std::vector<code::code>            _codes;
+
+    const code::code& _read_code_ref() {
+        auto idx = _in.read_uint();
+        if (idx >= _codes.size()) {
+            throw std::runtime_error{"Invalid code reference in module image"};
+        }
+        return _codes[static_cast<std::size_t>(idx)];
+    }
+
+    std::string_view _read_string() { return _strings->read_ref(_in); }
+
+    closure _read_closure() {
+        auto& c          = _read_code_ref();
+        auto  offset     = _in.read_uint();
+        auto  n_captures = _in.read_uint();
+        // read_code() checked each closure body with the captures that its
+        // mk_closure gives it, so a closure must match one of those
+        auto creates = [&](const code::instr& in) {
+            auto mk = std::get_if<code::is_types::mk_closure>(&in.instr_var());
+            return mk && mk->code_begin.index == offset && mk->captures.size() == n_captures;
+        };
+        if (std::none_of(c.begin(), c.end(), creates)) {
+            throw std::runtime_error{"Invalid code offset in module image"};
+        }
+        std::vector<lix::value> captures;
+        for (auto i = 0u; i < n_captures; ++i) {
+            captures.push_back(_read_value());
+        }
+        return closure(c, c.begin() + offset, std::move(captures));
+    }
+
+    std::vector<lix::value> _read_seq() {
+        std::vector<lix::value> ret;
+        auto                    size = _in.read_uint();
+        for (auto i = 0u; i < size; ++i) {
+            ret.push_back(_read_value());
+        }
+        return ret;
+    }
+
+    lix::value _read_value() {
+        switch (static_cast<value_tag>(_in.read_byte())) {
+        case value_tag::integer:
+            return _in.read_int();
+        case value_tag::real:
+            return _in.read_real();
+        case value_tag::symbol:
+            return lix::symbol(_read_string());
+        case value_tag::string:
+            return lix::string(_read_string());
+        case value_tag::tuple:
+            return lix::tuple(_read_seq());
+        case value_tag::list: {
+            auto els = _read_seq();
+            return lix::list(std::make_move_iterator(els.begin()),
+                             std::make_move_iterator(els.end()));
+        }
+        case value_tag::closure:
+            return _read_closure();
+        }
+        throw std::runtime_error{"Invalid value in module image"};
+    }
+
+public:
+    explicit image_reader(std::string_view image)
+        : _in(image) {}
+
+    std::optional<code::code> load(context& ctx) {
+        if (_in.remaining() < image_magic.size() || _in.read_raw(image_magic.size()) != image_magic) {
+            throw std::runtime_error{"Data is not a lix module image"};
+        }
+        if (_in.read_uint() != code::bytecode_version) {
+            throw std::runtime_error{"Module image was written by an incompatible version of lix"};
+        }
+        _strings.emplace(_in);
+        auto n_codes = _in.read_uint();
+        for (auto i = 0u; i < n_codes; ++i) {
+            _codes.push_back(code::read_code(_in, *_strings));
+        }
+        auto n_modules = _in.read_uint();
+        for (auto i = 0u; i < n_modules; ++i) {
+            auto   name = std::string(_read_string());
+            module mod;
+            auto   n_fns = _in.read_uint();
+            for (auto j = 0u; j < n_fns; ++j) {
+                auto fn_name = std::string(_read_string());
+                mod.add_closure_function(fn_name, _read_closure());
+            }
+            ctx.register_module(name, std::move(mod));
+        }
+        std::optional<code::code> entry;
+        if (_in.read_byte()) {
+            entry = _read_code_ref();
+        }
+        if (!_in.at_end()) {
+            throw std::runtime_error{"Trailing data in module image"};
+        }
+        return entry;
+    }
+};
+
+}  // namespace
+
+namespace {
+
+void write_modules(image_writer& out, const context& ctx, const std::vector<std::string>& names) {
+    for (auto& name : names) {
+        auto mod = ctx.get_module(name);
+        if (!mod) {
+            throw std::runtime_error{"No such module to save: " + name};
+        }
+        out.write_module(name, *mod);
+    }
+}
+
+}  // namespace
+
+std::string lix::exec::save_module_image(const context&                  ctx,
+                                         const std::vector<std::string>& module_names) {
+    image_writer out;
+    write_modules(out, ctx, module_names);
+    out.write_no_entry();
+    return out.finish(module_names.size());
+}
+
+std::string lix::exec::save_program_image(const context&                  ctx,
+                                          const std::vector<std::string>& module_names,
+                                          const code::code&               entry) {
+    image_writer out;
+    write_modules(out, ctx, module_names);
+    out.write_entry(entry);
+    return out.finish(module_names.size());
+}
+
+void lix::exec::load_module_image(context& ctx, std::string_view image) {
+    image_reader{image}.load(ctx);
+}
+
+lix::code::code lix::exec::load_program_image(context& ctx, std::string_view image) {
+    auto entry = image_reader{image}.load(ctx);
+    if (!entry) {
+        throw std::runtime_error{"Module image has no entry point"};
+    }
+    return *entry;
+}
+
+bool lix::exec::is_module_image(std::string_view data) noexcept {
+    return data.substr(0, image_magic.size()) == image_magic;
+}
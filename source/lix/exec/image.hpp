@@ -0,0 +1,52 @@
+#ifndef LIX_EXEC_IMAGE_HPP_INCLUDED
+#define LIX_EXEC_IMAGE_HPP_INCLUDED
+
+#include <lix/code/code.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lix::exec {
+
+class context;
+
+/**
+ * Serialize modules of a context into a module image: the bytecode of every
+ * block of code their functions refer to, and each module's function table.
+ * Loading the image into another context registers the same modules without
+ * parsing, expanding, or compiling anything.
+ *
+ * Only modules whose functions are all written in lix can be saved, as native
+ * functions have no serialized form. Throws std::runtime_error otherwise.
+ */
+std::string save_module_image(const context& ctx, const std::vector<std::string>& module_names);
+
+/**
+ * Serialize modules of a context along with an entry block of code, such as
+ * the top level of a compiled script. See `save_module_image()`.
+ */
+std::string save_program_image(const context&                  ctx,
+                               const std::vector<std::string>& module_names,
+                               const code::code&               entry);
+
+/**
+ * Register the modules in a module image with the given context. Throws
+ * std::runtime_error if the image is malformed or was written by an
+ * incompatible version of lix.
+ */
+void load_module_image(context& ctx, std::string_view image);
+
+/**
+ * Register the modules in a program image with the given context, and return
+ * its entry code for the caller to execute. The image may be discarded once
+ * this returns.
+ */
+code::code load_program_image(context& ctx, std::string_view image);
+
+/// Check whether the given data looks like a module or program image
+bool is_module_image(std::string_view data) noexcept;
+
+}  // namespace lix::exec
+
+#endif  // LIX_EXEC_IMAGE_HPP_INCLUDED
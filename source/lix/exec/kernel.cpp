@@ -1,5 +1,6 @@
 #include "kernel.hpp"
 
+#include <lix/code/optimize.hpp>
 #include <lix/compiler/compile.hpp>
 #include <lix/exec/exec.hpp>
 #include <lix/exec/module.hpp>
@@ -110,7 +111,15 @@ struct function_final_pass {
     }
 };
 
-value finalize_module(context& ctx, const function_accumulator& fns) {
+/// Compile code for the kernel to run, optimizing it if there are stats to add to
+code::code compile_code(const ast::node& node, code::optimize_stats* optimized) {
+    auto code = lix::compile(node);
+    return optimized ? code::optimize(code, optimized) : code;
+}
+
+value finalize_module(context&                    ctx,
+                      const function_accumulator& fns,
+                      code::optimize_stats*       optimized) {
     std::vector<ast::node> block;
     block.emplace_back(
         ast::make_assignment("__module",
@@ -143,37 +152,17 @@ value finalize_module(context& ctx, const function_accumulator& fns) {
     }
 
     auto block_ast = ast::call(symbol("__block__"), {}, ast::list(std::move(block)));
-    auto code      = lix::compile(block_ast);
+    auto code      = compile_code(block_ast, optimized);
     return exec::executor(code).execute_all(ctx);
 }
 
-value compile_module(context& ctx, const value& args) {
+value compile_module_call(context& ctx, const value& args) {
     auto arg_list = args.as_tuple();
     assert(arg_list);
     assert(arg_list->size() == 2);
     auto mod_sym = (*arg_list)[0].as_symbol();
     assert(mod_sym);
-    auto   ast = ast::node::from_value((*arg_list)[1]);
-    module mod;
-    return ctx.push_environment([&] {
-        ctx.set_environment_value("compiling_module", lix::boxed(mod));
-        ctx.set_environment_value("compiling_module_name", mod_sym->string());
-        ctx.set_environment_value("module_function_accumulator",
-                                  lix::boxed(function_accumulator{mod_sym->string(), {}}));
-        auto inner_expanded = lix::expand_macros(ctx, ast);
-        auto inner_code     = lix::compile(inner_expanded);
-        // Execute the code that will accumulate our attributes and function definitions
-        exec::executor(inner_code).execute_all(ctx);
-        // Now we compile and run some ethereal code that produce the actual
-        // module code.
-        auto acc_val = ctx.get_environment_value("module_function_accumulator");
-        assert(acc_val);
-        auto acc_box = acc_val->as_boxed();
-        assert(acc_box);
-        auto& mod_fn_acc = lix::mut_box_cast<function_accumulator>(*acc_box);
-        ctx.register_module(mod_sym->string(), mod);
-        return finalize_module(ctx, mod_fn_acc);
-    });
+    return exec::compile_module(ctx, *mod_sym, ast::node::from_value((*arg_list)[1]));
 }
 
 ast::node defmodule_macro(context&, const ast::list& args_) {
@@ -279,7 +268,7 @@ module build_bootstrap_module() {
     module ret;
     ret.add_function("register_module", &register_module);
     ret.add_function("register_function", &register_function);
-    ret.add_function("compile_module", &compile_module);
+    ret.add_function("compile_module", &compile_module_call);
     ret.add_function("def_module_function", &define_module_function);
     ret.add_function("get_env", [](context& ctx, const lix::value& args_) -> lix::value {
         argument_parser args{args_};
@@ -301,10 +290,11 @@ module build_bootstrap_module() {
 
 lix::value k_reverse_list(exec::context&, const lix::value& v) {
     const auto& [list] = unpack_arg_tuple<lix::list>(v);
-    std::vector<lix::value> new_list{list.begin(), list.end()};
-    std::reverse(new_list.begin(), new_list.end());
-    return lix::list(std::make_move_iterator(new_list.begin()),
-                     std::make_move_iterator(new_list.end()));
+    lix::list reversed;
+    for (auto& el : list) {
+        reversed = reversed.push_front(el);
+    }
+    return reversed;
 }
 
 const module& bootstrap_module() {
@@ -319,21 +309,22 @@ const module& kernel_module() {
         mod.add_macro("def", &def_macro);
         mod.add_function("__reverse_list", &k_reverse_list);
         mod.add_function("__map_pop",
-                         lix::wrap_function([](const lix::map&   map,
-                                               const lix::value& key,
-                                               const lix::value& def) -> lix::value {
-                             auto pair_opt = map.pop(key);
+                         lix::wrap_function([](lix::owned<lix::map> map,
+                                               const lix::value&    key,
+                                               const lix::value&    def) -> lix::value {
+                             auto pair_opt = std::move(*map).pop(key);
                              if (!pair_opt) {
-                                 return lix::tuple::make(def, map);
+                                 return lix::tuple::make(def, std::move(*map));
                              } else {
-                                 return lix::tuple::make(pair_opt->first, pair_opt->second);
+                                 return lix::tuple::make(std::move(pair_opt->first),
+                                                         std::move(pair_opt->second));
                              }
                          }));
         mod.add_function("__map_put",
-                         lix::wrap_function([](const lix::map&   map,
-                                               const lix::value& key,
-                                               const lix::value& val) -> lix::value {
-                             return map.insert_or_update(key, val);
+                         lix::wrap_function([](lix::owned<lix::map> map,
+                                               const lix::value&    key,
+                                               const lix::value&    val) -> lix::value {
+                             return std::move(*map).insert_or_update(key, val);
                          }));
         mod.add_function("__map_fetch",
                          lix::wrap_function(
@@ -345,6 +336,49 @@ const module& kernel_module() {
                                      return "error"_sym;
                                  }
                              }));
+        mod.add_function("__map_new", lix::wrap_function([](const lix::list& pairs) -> lix::value {
+                             lix::map_builder builder;
+                             for (auto& el : pairs) {
+                                 auto tup = el.as_tuple();
+                                 if (!tup || tup->size() != 2) {
+                                     lix::raise(lix::tuple::make("badarg"_sym, "Map.new", el));
+                                 }
+                                 builder.insert_or_update((*tup)[0], (*tup)[1]);
+                             }
+                             return builder.freeze();
+                         }));
+        mod.add_function("__map_keys", lix::wrap_function([](const lix::map& map) {
+                             std::vector<lix::value> keys;
+                             keys.reserve(map.size());
+                             for (auto iter = map.begin(); iter != map.end(); ++iter) {
+                                 keys.push_back(iter.key());
+                             }
+                             return lix::list(keys.begin(), keys.end());
+                         }));
+        mod.add_function("__map_values", lix::wrap_function([](const lix::map& map) {
+                             std::vector<lix::value> values;
+                             values.reserve(map.size());
+                             for (auto iter = map.begin(); iter != map.end(); ++iter) {
+                                 values.push_back(iter.value());
+                             }
+                             return lix::list(values.begin(), values.end());
+                         }));
+        mod.add_function("__map_to_list", lix::wrap_function([](const lix::map& map) {
+                             std::vector<lix::value> pairs;
+                             pairs.reserve(map.size());
+                             for (auto [key, val] : map) {
+                                 pairs.emplace_back(lix::tuple::make(key, val));
+                             }
+                             return lix::list(pairs.begin(), pairs.end());
+                         }));
+        mod.add_function("__map_size", lix::wrap_function([](const lix::map& map) {
+                             return lix::integer(map.size());
+                         }));
+        mod.add_function("__map_merge",
+                         lix::wrap_function(
+                             [](const lix::map& map, const lix::map& other) -> lix::value {
+                                 return lix::map_builder(map).merge(other).freeze();
+                             }));
         return mod;
     }();
     return mod;
@@ -362,4 +396,30 @@ context exec::build_kernel_context() {
     auto ret = build_bootstrap_context();
     ret.register_module("Kernel", kernel_module());
     return ret;
-}
\ No newline at end of file
+}
+
+value exec::compile_module(context&              ctx,
+                           symbol                name,
+                           const ast::node&      body,
+                           code::optimize_stats* optimized) {
+    module mod;
+    return ctx.push_environment([&] {
+        ctx.set_environment_value("compiling_module", lix::boxed(mod));
+        ctx.set_environment_value("compiling_module_name", name.string());
+        ctx.set_environment_value("module_function_accumulator",
+                                  lix::boxed(function_accumulator{name.string(), {}}));
+        auto inner_expanded = lix::expand_macros(ctx, body);
+        auto inner_code     = compile_code(inner_expanded, optimized);
+        // Execute the code that will accumulate our attributes and function definitions
+        exec::executor(inner_code).execute_all(ctx);
+        // Now we compile and run some ethereal code that produce the actual
+        // module code.
+        auto acc_val = ctx.get_environment_value("module_function_accumulator");
+        assert(acc_val);
+        auto acc_box = acc_val->as_boxed();
+        assert(acc_box);
+        auto& mod_fn_acc = lix::mut_box_cast<function_accumulator>(*acc_box);
+        ctx.register_module(name.string(), mod);
+        return finalize_module(ctx, mod_fn_acc, optimized);
+    });
+}
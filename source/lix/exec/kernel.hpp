@@ -5,11 +5,34 @@
 
 namespace lix {
 
+namespace ast {
+
+class node;
+
+} // namespace ast
+
+namespace code {
+
+struct optimize_stats;
+
+} // namespace code
+
 namespace exec {
 
 context build_bootstrap_context();
 context build_kernel_context();
 
+/**
+ * Compile the body of a module definition and register the module in the
+ * context, as `defmodule` does. If `optimized` is given, the code of the
+ * module is run through `code::optimize()`, and what the optimizer did is
+ * added to `optimized`.
+ */
+lix::value compile_module(context&              ctx,
+                          symbol                name,
+                          const ast::node&      body,
+                          code::optimize_stats* optimized = nullptr);
+
 } // namespace exec
 
 } // namespace lix
@@ -41,6 +41,23 @@ module::get_function(const std::string_view& name) const {
     }
 }
 
+const std::variant<function, closure>* module::find_function(const std::string_view& name) const {
+    auto iter = _impl->functions.find(name);
+    if (iter == _impl->functions.end()) {
+        return nullptr;
+    } else {
+        return &iter->second;
+    }
+}
+
+std::vector<std::string> module::function_names() const {
+    std::vector<std::string> ret;
+    for (auto& [name, _] : _impl->functions) {
+        ret.push_back(name);
+    }
+    return ret;
+}
+
 lix::opt_ref<macro_function> module::get_macro(const std::string_view& name) const {
     auto iter = _impl->macros.find(name);
     if (iter == _impl->macros.end()) {
@@ -9,6 +9,8 @@
 
 #include <memory>
 #include <optional>
+#include <string>
+#include <vector>
 
 namespace lix::exec {
 
@@ -44,6 +46,12 @@ public:
     }
 
     std::optional<std::variant<function, closure>> get_function(const std::string_view& name) const;
+    /**
+     * Find a function without copying it. The returned pointer is valid for as
+     * long as the module is alive.
+     */
+    const std::variant<function, closure>* find_function(const std::string_view& name) const;
+    std::vector<std::string>               function_names() const;
     opt_ref<macro_function>                        get_macro(const std::string_view& name) const;
 
     std::optional<lix::value> get_attribute(const std::string& name);
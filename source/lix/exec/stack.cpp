@@ -2,5 +2,30 @@
 
 #include <lix/exec/context.hpp>
 
+#include <algorithm>
+#include <memory>
+
 using namespace lix;
-using namespace lix::exec;
\ No newline at end of file
+using namespace lix::exec;
+
+stack::~stack() {
+    std::destroy(_first, _top);
+    std::allocator<lix::value>{}.deallocate(_first, static_cast<std::size_t>(_last - _first));
+}
+
+void stack::_grow(std::size_t min_extra) {
+    const auto old_cap  = static_cast<std::size_t>(_last - _first);
+    const auto old_size = static_cast<std::size_t>(_top - _first);
+    const auto new_cap  = (std::max)({old_cap * 2, old_size + min_extra, std::size_t(64)});
+
+    std::allocator<lix::value> alloc;
+    auto                       new_first = alloc.allocate(new_cap);
+    std::uninitialized_move(_first, _top, new_first);
+    std::destroy(_first, _top);
+    alloc.deallocate(_first, old_cap);
+
+    _base  = new_first + (_base - _first);
+    _top   = new_first + old_size;
+    _first = new_first;
+    _last  = new_first + new_cap;
+}
@@ -9,7 +9,7 @@
 #include <lix/exec/fn.hpp>
 
 #include <cassert>
-#include <deque>
+#include <cstddef>
 #include <variant>
 #include <vector>
 
@@ -18,30 +18,110 @@ namespace lix::exec {
 using lix::code::inst_offset_t;
 using lix::code::slot_ref_t;
 
+/**
+ * The value stack of an executor. All call frames share a single contiguous
+ * slab of values. Each frame sees a window onto the top of the slab, starting
+ * at the frame's base, and slot references are relative to that base.
+ *
+ * NOTE: Pushing a value may reallocate the slab, which invalidates any
+ * references to values within it. Use `reserve()` when a reference must
+ * outlive a push.
+ */
 class stack {
-    std::deque<lix::value> _items;
+    lix::value* _first = nullptr;
+    lix::value* _base  = nullptr;
+    lix::value* _top   = nullptr;
+    lix::value* _last  = nullptr;
+
+    void _grow(std::size_t min_extra);
 
 public:
-    using iterator       = std::deque<lix::value>::const_iterator;
-    using const_iterator = iterator;
-    using size_type      = std::deque<lix::value>::size_type;
-
-    size_type         size() const { return _items.size(); }
-    const lix::value& nth(slot_ref_t off) const {
-        // assert(off < size());
-        // return _items[off];
-        return _items.at(off.index);
-    }
-    lix::value& nth_mut(slot_ref_t off) { return _items.at(off.index); }
-    void        push(lix::value&& el) { _items.push_back(std::move(el)); }
-    void        push(const lix::value& el) { _items.push_back(el); }
-    void        rewind(slot_ref_t new_top) {
+    using size_type = std::size_t;
+
+    stack() = default;
+    ~stack();
+    stack(const stack&) = delete;
+    stack& operator=(const stack&) = delete;
+
+    /// The number of values in the current frame window
+    size_type size() const noexcept { return static_cast<size_type>(_top - _base); }
+
+    const lix::value& nth(slot_ref_t off) const noexcept {
+        assert(off.index < size());
+        return _base[off.index];
+    }
+    lix::value& nth_mut(slot_ref_t off) noexcept {
+        assert(off.index < size());
+        return _base[off.index];
+    }
+
+    /**
+     * The first value of the current frame window. Stays valid across pushes
+     * as long as they were `reserve()`d.
+     */
+    const lix::value* window_data() const noexcept { return _base; }
+    lix::value*       window_data() noexcept { return _base; }
+
+    /// Ensure that `n` values can be pushed without invalidating references
+    void reserve(size_type n) {
+        if (static_cast<size_type>(_last - _top) < n) {
+            _grow(n);
+        }
+    }
+
+    void push(lix::value&& el) {
+        if (_top == _last) {
+            // `el` may refer into the slab
+            lix::value tmp = std::move(el);
+            _grow(1);
+            new (_top) lix::value(std::move(tmp));
+        } else {
+            new (_top) lix::value(std::move(el));
+        }
+        ++_top;
+    }
+    void push(const lix::value& el) { push(lix::value(el)); }
+
+    void rewind(slot_ref_t new_top) noexcept {
         assert(new_top.index <= size());
-        auto new_end = _items.begin() + new_top.index;
-        _items.erase(new_end, _items.end());
+        auto new_end = _base + new_top.index;
+        while (_top != new_end) {
+            (--_top)->~value();
+        }
+    }
+
+    /**
+     * Open a new frame window at the top of the stack. Returns the base of the
+     * prior window, which must be given to `pop_window()` to restore it.
+     */
+    size_type push_window() noexcept {
+        auto prev = static_cast<size_type>(_base - _first);
+        _base     = _top;
+        return prev;
+    }
+
+    /// Destroy the current window and restore the window that preceded it.
+    void pop_window(size_type prev_base) noexcept {
+        rewind(slot_ref_t{0});
+        _base = _first + prev_base;
+    }
+
+    /**
+     * Move the top `n` values to the bottom of the current window and destroy
+     * everything else in the window. Used to replace a frame on tail calls.
+     */
+    void slide_window(size_type n) noexcept {
+        assert(n <= size());
+        auto src = _top - n;
+        if (src != _base) {
+            for (auto dest = _base; dest != _base + n; ++dest, ++src) {
+                *dest = std::move(*src);
+            }
+        }
+        rewind(slot_ref_t{n});
     }
 };
 
 }  // namespace lix::exec
 
-#endif  // LIX_EXEC_STACK_HPP_INCLUDED
\ No newline at end of file
+#endif  // LIX_EXEC_STACK_HPP_INCLUDED
@@ -0,0 +1,179 @@
+#include <lix/exec/exec.hpp>
+#include <lix/raise.hpp>
+#include <lix/util/args.hpp>
+#include <lix/util/wrap_fn.hpp>
+
+#include <array>
+#include <iterator>
+#include <vector>
+
+using namespace lix::literals;
+
+namespace {
+
+/**
+ * Calls a lix callback many times from native code. Closures are run on a
+ * single executor that is reused for every call.
+ */
+class callback {
+    lix::exec::context& _ctx;
+    const lix::value&   _fn;
+    lix::exec::executor _exec;
+
+public:
+    callback(lix::exec::context& ctx, const lix::value& fn)
+        : _ctx(ctx)
+        , _fn(fn) {
+        if (!fn.as_closure() && !fn.as_function()) {
+            lix::raise(lix::tuple::make("badcall"_sym, fn));
+        }
+    }
+
+    template <typename... Args>
+    lix::value operator()(const Args&... args) {
+        std::array<const lix::value*, sizeof...(Args)> refs{{&args...}};
+        return _call(lix::exec::arg_refs{refs.data(), refs.size()});
+    }
+
+    /**
+     * Call with an element and an accumulator that the caller is done with.
+     * The callee may update the accumulator in place if nothing else shares it.
+     */
+    lix::value operator()(const lix::value& el, lix::value&& acc) {
+        std::array<const lix::value*, 2> refs{{&el, &acc}};
+        return _call(lix::exec::arg_refs{refs.data(), refs.size(), 0b10});
+    }
+
+private:
+    lix::value _call(lix::exec::arg_refs args) {
+        if (auto clos = _fn.as_closure()) {
+            return _exec.call(_ctx, *clos, args);
+        }
+        return _fn.as_function()->call_args(_ctx, args);
+    }
+};
+
+/// Append the elements of a list to `out`, or raise if it isn't one
+void append_sublist(std::vector<lix::value>& out, const lix::value& sub) {
+    auto sub_list = sub.as_list();
+    if (!sub_list) {
+        lix::raise(lix::tuple::make(
+            "badarg"_sym,
+            lix::tuple::make("Elements to Enum.flatten list must also be lists", sub)));
+    }
+    out.insert(out.end(), sub_list->begin(), sub_list->end());
+}
+
+/**
+ * Call `fn` with each element of a list, or with a `{key, value}` tuple for
+ * each entry of a map
+ */
+template <typename Fn>
+void for_each_element(const lix::value& seq, Fn&& fn) {
+    if (auto list = seq.as_list()) {
+        for (auto& el : *list) {
+            fn(el);
+        }
+    } else if (auto map = seq.as_map()) {
+        for (auto [key, val] : *map) {
+            fn(lix::value(lix::tuple::make(key, val)));
+        }
+    } else {
+        lix::raise(lix::tuple::make("badarg"_sym,
+                                    lix::tuple::make("Value is not enumerable", seq)));
+    }
+}
+
+std::size_t size_hint(const lix::value& seq) {
+    if (auto list = seq.as_list()) {
+        return list->size();
+    } else if (auto map = seq.as_map()) {
+        return map->size();
+    }
+    return 0;
+}
+
+lix::list make_list(std::vector<lix::value>& elems) {
+    return lix::list(std::make_move_iterator(elems.begin()), std::make_move_iterator(elems.end()));
+}
+
+lix::exec::module build_enum_basemod() {
+    lix::exec::module mod;
+    mod.add_function("reduce",
+                     lix::wrap_function([](lix::exec::context& ctx,
+                                           const lix::value&   seq,
+                                           const lix::value&   acc,
+                                           const lix::value&   fn) {
+                         callback   cb{ctx, fn};
+                         lix::value ret = acc;
+                         for_each_element(seq,
+                                          [&](const lix::value& el) { ret = cb(el, std::move(ret)); });
+                         return ret;
+                     }));
+    mod.add_function("map",
+                     lix::wrap_function([](lix::exec::context& ctx,
+                                           const lix::value&   seq,
+                                           const lix::value&   fn) {
+                         callback                cb{ctx, fn};
+                         std::vector<lix::value> ret;
+                         ret.reserve(size_hint(seq));
+                         for_each_element(seq,
+                                          [&](const lix::value& el) { ret.push_back(cb(el)); });
+                         return make_list(ret);
+                     }));
+    mod.add_function("filter",
+                     lix::wrap_function([](lix::exec::context& ctx,
+                                           const lix::value&   seq,
+                                           const lix::value&   fn) {
+                         callback                cb{ctx, fn};
+                         std::vector<lix::value> ret;
+                         for_each_element(seq, [&](const lix::value& el) {
+                             auto keep = cb(el);
+                             auto sym  = keep.as_symbol();
+                             if (sym && *sym == "true"_sym) {
+                                 ret.push_back(el);
+                             } else if (!sym || *sym != "false"_sym) {
+                                 lix::raise(lix::tuple::make("nomatch"_sym, keep));
+                             }
+                         });
+                         return make_list(ret);
+                     }));
+    mod.add_function("flat_map",
+                     lix::wrap_function([](lix::exec::context& ctx,
+                                           const lix::value&   seq,
+                                           const lix::value&   fn) {
+                         callback                cb{ctx, fn};
+                         std::vector<lix::value> ret;
+                         for_each_element(seq, [&](const lix::value& el) {
+                             append_sublist(ret, cb(el));
+                         });
+                         return make_list(ret);
+                     }));
+    mod.add_function("flatten", lix::wrap_function([](const lix::list& list) {
+                         std::vector<lix::value> ret;
+                         for (auto& el : list) {
+                             append_sublist(ret, el);
+                         }
+                         return make_list(ret);
+                     }));
+    mod.add_function("to_list", lix::wrap_function([](const lix::value& seq) -> lix::value {
+                         if (seq.as_list()) {
+                             return seq;
+                         }
+                         std::vector<lix::value> ret;
+                         ret.reserve(size_hint(seq));
+                         for_each_element(seq,
+                                          [&](const lix::value& el) { ret.push_back(el); });
+                         return make_list(ret);
+                     }));
+    return mod;
+}
+
+lix::exec::module& enum_basemod() {
+    static auto mod = build_enum_basemod();
+    return mod;
+}
+
+void do_extra(lix::exec::context& ctx) { ctx.register_module("__enum", enum_basemod()); }
+
+}  // namespace
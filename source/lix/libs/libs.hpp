@@ -20,11 +20,29 @@ void add_libraries(exec::context& ctx) {
     (Libs::eval(ctx), ...);
 }
 
+/**
+ * Get a context with the given libraries loaded, built once on first use and
+ * shared thereafter. Use `create_context()` or `fork()` to get a context from
+ * it that can be modified.
+ */
+template <typename... Libs>
+const exec::context& context_template() {
+    static const exec::context ctx = [] {
+        auto kernel_ctx = lix::exec::build_kernel_context();
+        add_libraries<Libs...>(kernel_ctx);
+        kernel_ctx.freeze();
+        return kernel_ctx;
+    }();
+    return ctx;
+}
+
+/**
+ * Create a context with the given libraries loaded. The libraries are only
+ * loaded once, and every context created afterwards shares their modules.
+ */
 template <typename... Libs>
 exec::context create_context() {
-    auto kernel_ctx = lix::exec::build_kernel_context();
-    add_libraries<Libs...>(kernel_ctx);
-    return std::move(kernel_ctx);
+    return context_template<Libs...>().fork();
 }
 
 }  // namespace lix::libs
@@ -0,0 +1,69 @@
+#include <lix/eval.hpp>
+#include <lix/exec/image.hpp>
+#include <lix/exec/kernel.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+/**
+ * Build-time tool that evaluates the source of a library module in a fresh
+ * kernel context, then writes the bytecode image of the modules it defined as
+ * a C++ array definition to be embedded by the generated library sources.
+ */
+
+namespace {
+
+int precompile(const std::string& in_path, const std::string& out_path) {
+    std::ifstream in{in_path};
+    if (!in) {
+        std::cerr << "Failed to open file: " << in_path << '\n';
+        return 1;
+    }
+    std::string code;
+    using iter = std::istreambuf_iterator<char>;
+    std::copy(iter(in), iter{}, std::back_inserter(code));
+
+    auto ctx    = lix::exec::build_kernel_context();
+    auto before = ctx.module_names();
+    lix::eval(code, ctx);
+
+    std::vector<std::string> new_modules;
+    for (auto& name : ctx.module_names()) {
+        if (std::find(before.begin(), before.end(), name) == before.end()) {
+            new_modules.push_back(name);
+        }
+    }
+    auto image = lix::exec::save_module_image(ctx, new_modules);
+
+    std::ofstream out{out_path, std::ios::binary};
+    if (!out) {
+        std::cerr << "Failed to open file for writing: " << out_path << '\n';
+        return 1;
+    }
+    out << "// Generated from " << in_path << ". Do not edit.\n";
+    out << "static const unsigned char module_image[] = {";
+    auto n = 0u;
+    for (auto c : image) {
+        out << (n++ % 16 == 0 ? "\n    " : " ") << static_cast<unsigned>(static_cast<unsigned char>(c))
+            << ',';
+    }
+    out << "\n};\n";
+    return out.good() ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <module.lix> <output.inc>\n";
+        return 2;
+    }
+    try {
+        return precompile(argv[1], argv[2]);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to precompile " << argv[1] << ": " << e.what() << '\n';
+        return 1;
+    }
+}
@@ -2,6 +2,8 @@
 
 #include <lix/value.hpp>
 
+#include <algorithm>
+
 std::ostream& lix::operator<<(std::ostream& o, const list& l) {
     o << "[";
     auto iter = l.begin();
@@ -17,20 +19,19 @@ std::ostream& lix::operator<<(std::ostream& o, const list& l) {
 }
 
 lix::list lix::list::concat(const list& a, const list& b) {
-    list       ret;
-    auto*      tail  = &ret._head_node;
-    auto       first = a.begin();
-    const auto last  = b.end();
-    // Copy each node into the list.
-    while (first != last) {
-        *tail = std::make_shared<detail::list_node>(detail::list_node_emplace(), *first);
-        // Grab a ref to the tail
-        tail = &(*tail)->next_node;
-        ++first;
-        ++ret._size;
+    if (a.size() == 0) {
+        return b;
+    }
+    if (b.size() == 0) {
+        return a;
+    }
+    // Copy the elements of the left-hand list, then share the right-hand one
+    return _build(a.begin(), a.size(), b);
+}
+
+bool lix::operator==(const list& lhs, const list& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
     }
-    // Now just set the tail of the return to the head of the right-hand list
-    *tail = b._head_node;
-    ret._size += b.size();
-    return ret;
-}
\ No newline at end of file
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
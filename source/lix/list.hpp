@@ -1,32 +1,143 @@
 #ifndef LIX_LIST_HPP_INCLUDED
 #define LIX_LIST_HPP_INCLUDED
 
-#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <new>
 #include <ostream>
-#include <vector>
 #include <utility>
+#include <vector>
 
 #include "list_fwd.hpp"
 #include "value.hpp"
 
 namespace lix::detail {
 
-struct list_node_emplace {};
+/**
+ * A chunk of list elements. The constructed elements of a chunk are those
+ * from `first` to the end of the chunk, and the list continues at
+ * `next_index` in the `next` chunk.
+ *
+ * Chunks are shared between lists. A list that begins at the first element
+ * of its chunk may push a new element into the free slot before it, but
+ * only one list may claim each slot. The others allocate a new chunk.
+ */
+class alignas(lix::value) list_node {
+    std::atomic<std::size_t>   _refcount{1};
+    list_node*                 _next       = nullptr;
+    std::uint32_t              _next_index = 0;
+    const std::uint32_t        _capacity;
+    std::atomic<std::uint32_t> _first;
+
+    explicit list_node(std::uint32_t capacity) noexcept
+        : _capacity(capacity)
+        , _first(capacity) {}
+
+    lix::value* _slots() noexcept { return reinterpret_cast<lix::value*>(this + 1); }
+
+    static list_node* _allocate(std::uint32_t capacity) {
+        void* mem = ::operator new(sizeof(list_node) + capacity * sizeof(lix::value));
+        return new (mem) list_node(capacity);
+    }
+    static void _free(list_node* node) noexcept {
+        node->~list_node();
+        ::operator delete(static_cast<void*>(node));
+    }
+
+public:
+    /// The size of the chunks of a list built all at once
+    static constexpr std::uint32_t max_chunk = 32;
+    /// The size of the first chunk of a list built by `push_front()`
+    static constexpr std::uint32_t min_chunk = 4;
+
+    /// Create a chunk of `count` elements, taken in order from `first`
+    template <typename Iterator>
+    static list_node* create_filled(Iterator& first, std::uint32_t count) {
+        auto          node  = _allocate(count);
+        auto          slots = node->_slots();
+        std::uint32_t i     = 0;
+        try {
+            for (; i < count; ++i, ++first) {
+                new (slots + i) lix::value(*first);
+            }
+        } catch (...) {
+            while (i != 0) {
+                slots[--i].~value();
+            }
+            _free(node);
+            throw;
+        }
+        node->_first.store(0, std::memory_order_relaxed);
+        return node;
+    }
+
+    /// Create a chunk with only its last element
+    static list_node* create_last(std::uint32_t capacity, lix::value&& val) {
+        auto node = _allocate(capacity);
+        new (node->_slots() + capacity - 1) lix::value(std::move(val));
+        node->_first.store(capacity - 1, std::memory_order_relaxed);
+        return node;
+    }
+
+    /**
+     * Put a value in the free slot before the element at `index`, if no other
+     * list has done so already.
+     */
+    bool try_emplace_before(std::uint32_t index, lix::value&& val) noexcept {
+        if (index == 0) {
+            return false;
+        }
+        auto expect = index;
+        if (!_first.compare_exchange_strong(expect, index - 1, std::memory_order_acq_rel)) {
+            return false;
+        }
+        new (_slots() + index - 1) lix::value(std::move(val));
+        return true;
+    }
 
-struct list_node {
-    std::shared_ptr<list_node> next_node;
-    lix::value                 my_value;
+    /// Continue this chunk with a list. Takes ownership of a reference to `next`
+    void set_next(list_node* next, std::uint32_t index) noexcept {
+        _next       = next;
+        _next_index = index;
+    }
+
+    void retain() noexcept { _refcount.fetch_add(1, std::memory_order_relaxed); }
 
-    template <typename... Args>
-    list_node(list_node_emplace, Args&&... args)
-        : my_value(std::forward<Args>(args)...) {}
+    /**
+     * Drop a reference to a chunk. Chunks that are released along with it are
+     * released in a loop rather than recursively, so that very long lists can
+     * be destroyed without exhausting the stack.
+     */
+    static void release(list_node* node) noexcept {
+        while (node && node->_refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            auto slots = node->_slots();
+            for (auto i = node->_first.load(std::memory_order_relaxed); i != node->_capacity;
+                 ++i) {
+                slots[i].~value();
+            }
+            auto next = node->_next;
+            _free(node);
+            node = next;
+        }
+    }
+
+    std::uint32_t     capacity() const noexcept { return _capacity; }
+    const list_node*  next() const noexcept { return _next; }
+    list_node*        next() noexcept { return _next; }
+    std::uint32_t     next_index() const noexcept { return _next_index; }
+    const lix::value* slots() const noexcept {
+        return reinterpret_cast<const lix::value*>(this + 1);
+    }
 };
 
 }  // namespace lix::detail
 
 inline lix::list::iterator& lix::list::iterator::operator++() {
     assert(_node != nullptr && "Increment list end iterator");
-    _node = _node->next_node;
+    if (++_index == _node->capacity()) {
+        _index = _node->next_index();
+        _node  = _node->next();
+    }
     return *this;
 }
 
@@ -37,54 +148,137 @@ inline lix::list::iterator lix::list::iterator::operator++(int) {
 }
 
 inline bool lix::list::iterator::operator==(const iterator& other) const {
-    return _node == other._node;
+    return _node == other._node && (_node == nullptr || _index == other._index);
 }
 inline bool lix::list::iterator::operator!=(const iterator& other) const {
-    return _node != other._node;
+    return !(*this == other);
 }
 
 inline const lix::value& lix::list::iterator::operator*() const noexcept {
     assert(_node != nullptr && "Dereference list end iterator");
-    return _node->my_value;
+    return _node->slots()[_index];
 }
 
 inline const lix::value* lix::list::iterator::operator->() const noexcept {
     return std::addressof(**this);
 }
 
+inline lix::list::list(const list& other) noexcept
+    : _head_node(other._head_node)
+    , _head_index(other._head_index)
+    , _size(other._size) {
+    if (_head_node) {
+        _head_node->retain();
+    }
+}
+
+inline lix::list::list(list&& other) noexcept
+    : _head_node(std::exchange(other._head_node, nullptr))
+    , _head_index(std::exchange(other._head_index, 0))
+    , _size(std::exchange(other._size, 0)) {}
+
+inline lix::list& lix::list::operator=(const list& other) noexcept {
+    if (other._head_node) {
+        other._head_node->retain();
+    }
+    detail::list_node::release(_head_node);
+    _head_node  = other._head_node;
+    _head_index = other._head_index;
+    _size       = other._size;
+    return *this;
+}
+
+inline lix::list& lix::list::operator=(list&& other) noexcept {
+    if (this != &other) {
+        detail::list_node::release(_head_node);
+        _head_node  = std::exchange(other._head_node, nullptr);
+        _head_index = std::exchange(other._head_index, 0);
+        _size       = std::exchange(other._size, 0);
+    }
+    return *this;
+}
+
+inline lix::list::~list() { detail::list_node::release(_head_node); }
+
+template <typename Iterator>
+inline lix::list lix::list::_build(Iterator first, std::size_t count, const list& tail) {
+    using detail::list_node;
+    if (count == 0) {
+        return tail;
+    }
+    // Owns the chunks as we go, so that they are released if an element throws
+    list       ret;
+    list_node* last = nullptr;
+    for (auto remaining = count; remaining != 0;) {
+        auto n    = static_cast<std::uint32_t>(
+            (std::min)(remaining, static_cast<std::size_t>(list_node::max_chunk)));
+        auto node = list_node::create_filled(first, n);
+        if (last) {
+            last->set_next(node, 0);
+        } else {
+            ret._head_node = node;
+        }
+        last = node;
+        remaining -= n;
+    }
+    if (tail._head_node) {
+        tail._head_node->retain();
+        last->set_next(tail._head_node, tail._head_index);
+    }
+    ret._size = count + tail._size;
+    return ret;
+}
+
 template <typename Iterator, typename EndIter, typename, typename>
 inline lix::list::list(Iterator first, EndIter last) {
-    std::shared_ptr<detail::list_node>* tail = &_head_node;
-    while (first != last) {
-        *tail = std::make_shared<detail::list_node>(detail::list_node_emplace(), *first);
-        tail  = &(*tail)->next_node;
-        ++first;
-        ++_size;
+    std::size_t count = 0;
+    for (auto it = first; it != last; ++it) {
+        ++count;
     }
+    *this = _build(first, count, list());
 }
 
-inline lix::list::iterator lix::list::begin() const noexcept { return iterator(_head_node); }
-inline lix::list::iterator lix::list::end() const noexcept { return iterator(nullptr); }
+inline lix::list::iterator lix::list::begin() const noexcept {
+    return iterator(_head_node, _head_index);
+}
+inline lix::list::iterator lix::list::end() const noexcept { return iterator(nullptr, 0); }
 
 inline lix::list lix::list::pop_front() const noexcept {
     assert(_head_node != nullptr && "Pop front of empty list");
-    return lix::list(_head_node->next_node, _size - 1);
+    auto node  = _head_node;
+    auto index = _head_index + 1;
+    if (index == node->capacity()) {
+        index = node->next_index();
+        node  = node->next();
+    }
+    if (node) {
+        node->retain();
+    }
+    return lix::list(node, index, _size - 1);
 }
 inline std::pair<lix::value, lix::list> lix::list::take_front() const noexcept {
     assert(_head_node != nullptr && "Take front of empty list");
     auto front = *begin();
     return std::make_pair(std::move(front), pop_front());
 }
-inline lix::list lix::list::push_front(lix::value&& val) const noexcept {
-    auto new_head
-        = std::make_shared<detail::list_node>(detail::list_node_emplace(), std::move(val));
-    new_head->next_node = _head_node;
-    return lix::list(std::move(new_head), _size + 1);
+inline lix::list lix::list::push_front(lix::value&& val) const {
+    using detail::list_node;
+    if (_head_node && _head_node->try_emplace_before(_head_index, std::move(val))) {
+        _head_node->retain();
+        return lix::list(_head_node, _head_index - 1, _size + 1);
+    }
+    // Grow the chunks geometrically as a list is built from the back
+    auto capacity = _head_node ? (std::min)(_head_node->capacity() * 2, list_node::max_chunk)
+                               : list_node::min_chunk;
+    auto node     = list_node::create_last(capacity, std::move(val));
+    if (_head_node) {
+        _head_node->retain();
+        node->set_next(_head_node, _head_index);
+    }
+    return lix::list(node, capacity - 1, _size + 1);
 }
 inline lix::list lix::list::push_front(const lix::value& val) const {
-    auto new_head       = std::make_shared<detail::list_node>(detail::list_node_emplace(), val);
-    new_head->next_node = _head_node;
-    return lix::list(std::move(new_head), _size + 1);
+    return push_front(lix::value(val));
 }
 
-#endif  // LIX_LIST_HPP_INCLUDED
\ No newline at end of file
+#endif  // LIX_LIST_HPP_INCLUDED
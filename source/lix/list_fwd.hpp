@@ -1,6 +1,7 @@
 #ifndef LIX_LIST_FWD_HPP_INCLUDED
 #define LIX_LIST_FWD_HPP_INCLUDED
 
+#include <cinttypes>
 #include <iterator>
 #include <memory>
 #include <ostream>
@@ -11,21 +12,26 @@ namespace lix {
 
 namespace detail {
 
-struct list_node;
+class list_node;
 
 }  // namespace detail
 
+/**
+ * An immutable singly-linked list. The elements are stored in chunks of up to
+ * `detail::list_node::max_chunk` values, and lists share their tails, so that
+ * building and walking a list does not need an allocation per element.
+ */
 class list {
 public:
     class iterator {
-        std::shared_ptr<detail::list_node> _node;
+        const detail::list_node* _node  = nullptr;
+        std::uint32_t            _index = 0;
 
     public:
-        iterator()                = default;
-        iterator(const iterator&) = default;
-        iterator(iterator&&)      = default;
-        explicit iterator(std::shared_ptr<detail::list_node> n)
-            : _node(std::move(n)) {}
+        iterator() = default;
+        iterator(const detail::list_node* n, std::uint32_t index) noexcept
+            : _node(n)
+            , _index(index) {}
 
         inline iterator& operator++();
 
@@ -45,19 +51,26 @@ public:
     };
 
 private:
-    std::shared_ptr<detail::list_node> _head_node;
-    std::size_t                        _size = 0;
-
-    list(std::shared_ptr<detail::list_node> head, std::size_t size)
-        : _head_node(std::move(head))
+    // The chunk holding the first element, and its index in that chunk
+    detail::list_node* _head_node = nullptr;
+    std::uint32_t      _head_index = 0;
+    std::size_t        _size       = 0;
+
+    list(detail::list_node* head, std::uint32_t index, std::size_t size) noexcept
+        : _head_node(head)
+        , _head_index(index)
         , _size(size) {}
 
+    template <typename Iterator>
+    inline static list _build(Iterator first, std::size_t count, const list& tail);
+
 public:
-    constexpr list() noexcept  = default;
-    list(const list&) noexcept = default;
-    list(list&&) noexcept      = default;
-    list& operator=(const list&) noexcept = default;
-    list& operator=(list&&) noexcept = default;
+    constexpr list() noexcept = default;
+    inline list(const list&) noexcept;
+    inline list(list&&) noexcept;
+    inline list& operator=(const list&) noexcept;
+    inline list& operator=(list&&) noexcept;
+    inline ~list();
 
     template <typename Iterator,
               typename EndIter,
@@ -69,7 +82,7 @@ public:
 
     [[nodiscard]] inline list                             pop_front() const noexcept;
     [[nodiscard]] inline std::pair<lix::value, lix::list> take_front() const noexcept;
-    [[nodiscard]] inline list                             push_front(lix::value&&) const noexcept;
+    [[nodiscard]] inline list                             push_front(lix::value&&) const;
     [[nodiscard]] inline list                             push_front(const lix::value&) const;
 
     inline iterator begin() const noexcept;
@@ -80,6 +93,8 @@ public:
 
 std::ostream& operator<<(std::ostream& o, const list& l);
 
+bool operator==(const list& lhs, const list& rhs);
+
 }  // namespace lix
 
-#endif  // LIX_LIST_FWD_HPP_INCLUDED
\ No newline at end of file
+#endif  // LIX_LIST_FWD_HPP_INCLUDED
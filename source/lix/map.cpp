@@ -2,6 +2,9 @@
 
 #include <lix/value.hpp>
 
+#include <algorithm>
+#include <utility>
+
 // #define HAMT_DEBUG_VERBOSE 1
 
 #include <hamt/hash_trie.hpp>
@@ -55,7 +58,7 @@ namespace std {
 
 namespace lix::detail {
 
-struct map_impl {
+struct map_impl : value_cell_base {
     using key_type    = lix::value;
     using value_type  = lix::value;
     using trie_data   = hamt::hash_trie_data<map_entry, map_entry_lookup>;
@@ -72,10 +75,17 @@ struct map_impl {
         , _size(o._size) {
         addref(_root);
     }
+    map_impl(map_impl&& o) noexcept
+        : _root(std::exchange(o._root, nullptr))
+        , _size(o._size) {}
     map_impl(const branch_node* br, std::size_t size)
         : _root(br)
         , _size(size) {}
-    ~map_impl() { release(_root); }
+    ~map_impl() {
+        if (_root) {
+            release(_root);
+        }
+    }
 
     map_impl _insert_at(const path_type& path, const key_type& key, const value_type& value) const {
         map_entry new_entry{key, value};
@@ -142,6 +152,136 @@ struct map_impl {
         return std::nullopt;
     }
 
+    /**
+     * Make `br` safe to modify in place, copying it if anything else refers to
+     * it. `br` is replaced by the copy, and the reference to the original is
+     * dropped.
+     */
+    static branch_node* _make_exclusive(const branch_node*& br) {
+        if (!br->is_exclusive()) {
+            auto copy = br->clone().release();
+            release(br);
+            br = copy;
+        }
+        return const_cast<branch_node*>(br);
+    }
+
+    /// The child branch at `idx`, copied first if anything else refers to it
+    static branch_node*
+    _exclusive_child(branch_node* parent, hamt::sparse_index idx, const hamt::node* child) {
+        auto child_br = static_cast<const branch_node*>(child);
+        if (!child_br->is_exclusive()) {
+            auto copy = child_br->clone().release();
+            parent->replace_child_in_place(idx, copy);
+            child_br = copy;
+        }
+        return const_cast<branch_node*>(child_br);
+    }
+
+    /**
+     * Insert an entry without path-copying. Nodes that are shared with other
+     * maps are copied on the way down, and everything else is modified in
+     * place.
+     */
+    void insert_in_place(const key_type& key, const value_type& value, bool allow_update) {
+        branch_node*               branch = _make_exclusive(_root);
+        branch_node*               parent = nullptr;
+        hamt::sparse_index         parent_idx{0};
+        std::size_t                depth = 0;
+        hamt::detail::chunked_hash chunked{map_entry_lookup::hash(key)};
+        while (true) {
+            hamt::sparse_index idx{chunked.chunk};
+            auto               child = branch->get_at(idx);
+            if (child == nullptr) {
+                // Grow the branch to make room for a new leaf
+                auto leaf  = leaf_node::create(map_entry{key, value}, chunked.hash);
+                auto grown = branch->moved_inserted(idx, leaf.release()).release();
+                if (parent) {
+                    parent->replace_child_in_place(parent_idx, grown);
+                } else {
+                    release(_root);
+                    _root = grown;
+                }
+                ++_size;
+                return;
+            }
+            if (child->m_type == hamt::node_type::branch) {
+                parent     = branch;
+                parent_idx = idx;
+                branch     = _exclusive_child(branch, idx, child);
+                ++chunked;
+                ++depth;
+                continue;
+            }
+            auto leaf         = static_cast<const leaf_node*>(child);
+            auto existing_idx = leaf->index_of(key);
+            if (existing_idx != leaf->npos) {
+                if (!allow_update) {
+                    throw std::runtime_error{"Insert of already-existing entry into map"};
+                }
+                if (leaf->m_refCount.load(std::memory_order_acquire) == 1) {
+                    const_cast<leaf_node*>(leaf)->replace_value_in_place(existing_idx,
+                                                                         map_entry{key, value});
+                } else {
+                    auto new_leaf
+                        = leaf->with_replaced_value(existing_idx, map_entry{key, value});
+                    branch->replace_child_in_place(idx, new_leaf.release());
+                }
+                return;
+            }
+            if (leaf->hash() == chunked.hash) {
+                // A full hash collision shares the leaf
+                auto new_leaf = leaf->with_appended_value(map_entry{key, value});
+                branch->replace_child_in_place(idx, new_leaf.release());
+            } else {
+                // Split the leaf into branches down to where the hashes differ
+                hamt::detail::chunked_hash existing_hash{leaf->hash()};
+                existing_hash += static_cast<int>(depth);
+                auto new_branch
+                    = hamt::extend(existing_hash + 1,
+                                   leaf,
+                                   chunked + 1,
+                                   leaf_node::create(map_entry{key, value}, chunked.hash));
+                branch->replace_child_in_place(idx, new_branch.release());
+            }
+            ++_size;
+            return;
+        }
+    }
+
+    /// Remove an entry in place, as `insert_in_place()` inserts one
+    std::optional<lix::value> erase_in_place(const key_type& key) {
+        // Look first, so that a missing key doesn't copy anything
+        if (!find(key)) {
+            return std::nullopt;
+        }
+        branch_node*               branch = _make_exclusive(_root);
+        hamt::detail::chunked_hash chunked{map_entry_lookup::hash(key)};
+        while (true) {
+            hamt::sparse_index idx{chunked.chunk};
+            auto               child = branch->get_at(idx);
+            assert(child && "Key went missing while erasing it");
+            if (child->m_type == hamt::node_type::branch) {
+                branch = _exclusive_child(branch, idx, child);
+                ++chunked;
+                continue;
+            }
+            auto       leaf         = static_cast<const leaf_node*>(child);
+            auto       existing_idx = leaf->index_of(key);
+            lix::value ret          = leaf->get_at(existing_idx).value();
+            if (leaf->size() == 1) {
+                branch->erase_child_in_place(idx);
+            } else if (leaf->m_refCount.load(std::memory_order_acquire) == 1) {
+                const_cast<leaf_node*>(leaf)->erase_value_in_place(existing_idx);
+            } else {
+                branch->replace_child_in_place(idx,
+                                               leaf->with_erased_value(existing_idx).release());
+            }
+            --_size;
+            return ret;
+        }
+    }
+
     opt_ref<const lix::value> find(const key_type& key) const {
         path_type path{key, _root};
         auto      leaf = path.leaf();
@@ -162,18 +302,64 @@ map::map()
     : map(lix::detail::map_impl()) {}
 
 map::map(detail::map_impl&& impl)
-    : _impl(std::make_shared<detail::map_impl>(move(impl))) {}
+    : _cell(new detail::map_impl(move(impl))) {}
+
+map& map::operator=(const map& other) noexcept {
+    other._cell->add_ref();
+    if (_cell && _cell->drop_ref()) {
+        delete _impl();
+    }
+    _cell = other._cell;
+    return *this;
+}
+
+map& map::operator=(map&& other) noexcept {
+    if (this != &other) {
+        if (_cell && _cell->drop_ref()) {
+            delete _impl();
+        }
+        _cell = std::exchange(other._cell, nullptr);
+    }
+    return *this;
+}
+
+map::~map() {
+    if (_cell && _cell->drop_ref()) {
+        delete _impl();
+    }
+}
+
+detail::map_impl* map::_impl() const noexcept { return static_cast<detail::map_impl*>(_cell); }
 
 map map::insert(const lix::value& key, const lix::value& val) const {
-    return _impl->insert(key, val);
+    return _impl()->insert(key, val);
+}
+
+map map::insert_or_update(const lix::value& key, const lix::value& val) const& {
+    return _impl()->insert_or_update(key, val);
 }
 
-map map::insert_or_update(const lix::value& key, const lix::value& val) const {
-    return _impl->insert_or_update(key, val);
+map map::insert_or_update(const lix::value& key, const lix::value& val) && {
+    if (_cell->refcount.load(std::memory_order_acquire) != 1) {
+        return std::as_const(*this).insert_or_update(key, val);
+    }
+    _impl()->insert_in_place(key, val, true);
+    return std::move(*this);
 }
 
-std::optional<std::pair<lix::value, lix::map>> map::pop(const lix::value& key) const {
-    auto pair = _impl->pop(key);
+std::optional<std::pair<lix::value, lix::map>> map::pop(const lix::value& key) && {
+    if (_cell->refcount.load(std::memory_order_acquire) != 1) {
+        return std::as_const(*this).pop(key);
+    }
+    auto val = _impl()->erase_in_place(key);
+    if (!val) {
+        return std::nullopt;
+    }
+    return std::pair(std::move(*val), std::move(*this));
+}
+
+std::optional<std::pair<lix::value, lix::map>> map::pop(const lix::value& key) const& {
+    auto pair = _impl()->pop(key);
     if (pair) {
         return std::pair(move(pair->first), map(move(pair->second)));
     } else {
@@ -181,9 +367,142 @@ std::optional<std::pair<lix::value, lix::map>> map::pop(const lix::value& key) c
     }
 }
 
-opt_ref<const value> map::find(const lix::value& key) const { return _impl->find(key); }
+opt_ref<const value> map::find(const lix::value& key) const { return _impl()->find(key); }
+
+std::size_t map::size() const noexcept { return _impl()->_size; }
+
+static_assert(map::iterator::max_depth >= hamt::detail::maxDepth + 2,
+              "map::iterator cannot hold the deepest path through a trie");
+
+map::iterator::iterator(const void* root) noexcept {
+    _levels[0] = {root, 0};
+    _depth     = 1;
+    _settle();
+}
+
+void map::iterator::_settle() noexcept {
+    // Descend until we are at an entry of a leaf, moving past any node that
+    // we have finished with along the way
+    while (_depth != 0) {
+        auto& top  = _levels[_depth - 1];
+        auto  node = static_cast<const hamt::node*>(top.node);
+        if (node->m_type == hamt::node_type::leaf) {
+            if (top.index < static_cast<const detail::map_impl::leaf_node*>(node)->size()) {
+                return;
+            }
+        } else {
+            auto br = static_cast<const detail::map_impl::branch_node*>(node);
+            if (top.index < br->size()) {
+                _levels[_depth++] = {br->get_at(hamt::compact_index(top.index)), 0};
+                continue;
+            }
+        }
+        // Done with this node. Continue with the next child of its parent
+        if (--_depth != 0) {
+            ++_levels[_depth - 1].index;
+        }
+    }
+}
+
+namespace {
+
+const map_entry& current_entry(const void* node, std::uint32_t index) noexcept {
+    return static_cast<const lix::detail::map_impl::leaf_node*>(node)->get_at(index);
+}
+
+}  // namespace
+
+const lix::value& map::iterator::key() const noexcept {
+    assert(_depth != 0 && "Dereference map end iterator");
+    auto& top = _levels[_depth - 1];
+    return current_entry(top.node, top.index).key();
+}
+
+const lix::value& map::iterator::value() const noexcept {
+    assert(_depth != 0 && "Dereference map end iterator");
+    auto& top = _levels[_depth - 1];
+    return current_entry(top.node, top.index).value();
+}
+
+map::iterator& map::iterator::operator++() noexcept {
+    assert(_depth != 0 && "Increment map end iterator");
+    ++_levels[_depth - 1].index;
+    _settle();
+    return *this;
+}
+
+bool map::iterator::operator==(const iterator& other) const noexcept {
+    if (_depth == 0 || other._depth == 0) {
+        return _depth == other._depth;
+    }
+    auto& top       = _levels[_depth - 1];
+    auto& other_top = other._levels[other._depth - 1];
+    return top.node == other_top.node && top.index == other_top.index;
+}
+
+map::iterator map::begin() const { return iterator(_impl()->_root); }
+map::iterator map::cbegin() const { return begin(); }
+map::iterator map::end() const { return iterator(); }
+map::iterator map::cend() const { return end(); }
+
+bool lix::operator==(const map& lhs, const map& rhs) {
+    if (lhs._impl()->_root == rhs._impl()->_root) {
+        return true;
+    }
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    return std::all_of(lhs.begin(), lhs.end(), [&](auto entry) {
+        auto found = rhs.find(entry.first);
+        return found && *found == entry.second;
+    });
+}
+
+map_builder::map_builder()
+    : _impl(std::make_unique<detail::map_impl>()) {}
 
-std::ostream& lix::operator<<(std::ostream& o, const lix::map&) {
-    o << "%{[map]}";
+map_builder::map_builder(const map& base)
+    : _impl(std::make_unique<detail::map_impl>(*base._impl())) {}
+
+map_builder::map_builder(map_builder&&) noexcept = default;
+map_builder& map_builder::operator=(map_builder&&) noexcept = default;
+map_builder::~map_builder()                                 = default;
+
+map_builder& map_builder::insert(const lix::value& key, const lix::value& val) {
+    _impl->insert_in_place(key, val, false);
+    return *this;
+}
+
+map_builder& map_builder::insert_or_update(const lix::value& key, const lix::value& val) {
+    _impl->insert_in_place(key, val, true);
+    return *this;
+}
+
+map_builder& map_builder::merge(const map& other) {
+    for (auto [key, val] : other) {
+        insert_or_update(key, val);
+    }
+    return *this;
+}
+
+std::size_t map_builder::size() const noexcept { return _impl->_size; }
+
+map map_builder::freeze() {
+    auto ret = map(std::move(*_impl));
+    _impl    = std::make_unique<detail::map_impl>();
+    return ret;
+}
+
+std::ostream& lix::operator<<(std::ostream& o, const lix::map& m) {
+    o << "%{";
+    auto iter = m.begin();
+    while (iter != m.end()) {
+        o << iter.key() << " => " << iter.value();
+        ++iter;
+        if (iter != m.end()) {
+            o << ", ";
+        }
+    }
+    o << "}";
     return o;
 }
\ No newline at end of file
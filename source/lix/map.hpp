@@ -1,6 +1,9 @@
 #ifndef LIX_MAP_HPP_INCLUDED
 #define LIX_MAP_HPP_INCLUDED
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <memory>
 #include <ostream>
 #include <utility>
@@ -16,30 +19,145 @@ struct map_impl;
 
 }  // namespace detail
 
+class map_builder;
+
 class map {
 public:
     class iterator;
     using const_iterator = iterator;
 
 private:
-    std::shared_ptr<detail::map_impl> _impl;
+    friend class map_builder;
+    /// The `detail::map_impl`, which is also the cell of a value holding the map
+    detail::value_cell_base* _cell;
 
     map(detail::map_impl&& ptr);
 
+    detail::map_impl* _impl() const noexcept;
+
 public:
     map();
-    ~map() = default;
+    map(const map& other) noexcept
+        : _cell(other._cell) {
+        _cell->add_ref();
+    }
+    map(map&& other) noexcept
+        : _cell(std::exchange(other._cell, nullptr)) {}
+    map& operator=(const map&) noexcept;
+    map& operator=(map&&) noexcept;
+    ~map();
+
     iterator begin() const;
     iterator cbegin() const;
     iterator end() const;
     iterator cend() const;
 
     [[nodiscard]] map insert(const lix::value&, const lix::value&) const;
-    [[nodiscard]] map insert_or_update(const lix::value&, const lix::value&) const;
-    [[nodiscard]] std::optional<std::pair<lix::value, map>> pop(const lix::value&) const;
+    [[nodiscard]] map insert_or_update(const lix::value&, const lix::value&) const&;
+    [[nodiscard]] std::optional<std::pair<lix::value, map>> pop(const lix::value&) const&;
     [[nodiscard]] opt_ref<const lix::value>                 find(const lix::value&) const;
+
+    /**
+     * Update a map that is about to be discarded. If nothing else shares its
+     * storage, it is updated in place and returned. If `pop()` doesn't find
+     * the key, the map is left as it was.
+     */
+    [[nodiscard]] map insert_or_update(const lix::value&, const lix::value&) &&;
+    [[nodiscard]] std::optional<std::pair<lix::value, map>> pop(const lix::value&) &&;
+
+    std::size_t size() const noexcept;
+
+    friend bool operator==(const map&, const map&);
+};
+
+/**
+ * Visits each entry of a map, in the order of the hashes of their keys. The
+ * iterator walks the trie with a stack of the nodes it is currently inside
+ * of, so it doesn't allocate. It does not keep the map alive.
+ */
+class map::iterator {
+public:
+    /// The trie is never deeper than this, including the leaf
+    static constexpr std::size_t max_depth = 14;
+
+private:
+    friend class map;
+
+    struct level {
+        const void*   node;
+        std::uint32_t index;
+    };
+    level       _levels[max_depth];
+    std::size_t _depth = 0;
+
+    explicit iterator(const void* root) noexcept;
+    void _settle() noexcept;
+
+public:
+    using value_type        = std::pair<const lix::value&, const lix::value&>;
+    using reference         = value_type;
+    using pointer           = void;
+    using difference_type   = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    iterator() noexcept = default;
+
+    const lix::value& key() const noexcept;
+    const lix::value& value() const noexcept;
+    value_type        operator*() const noexcept { return {key(), value()}; }
+
+    iterator& operator++() noexcept;
+    iterator  operator++(int) noexcept {
+        auto tmp = *this;
+        ++*this;
+        return tmp;
+    }
+
+    bool operator==(const iterator& other) const noexcept;
+    bool operator!=(const iterator& other) const noexcept { return !(*this == other); }
+};
+
+/**
+ * Builds a map by modifying it in place rather than copying it for every
+ * insertion. The builder has exclusive ownership of what it has built, and
+ * parts of a map it started from are copied the first time they are changed.
+ * `freeze()` hands the result over as an ordinary immutable map.
+ */
+class map_builder {
+    std::unique_ptr<detail::map_impl> _impl;
+
+public:
+    map_builder();
+    /// Start from the contents of an existing map, which is left unchanged
+    explicit map_builder(const map&);
+    map_builder(map_builder&&) noexcept;
+    map_builder& operator=(map_builder&&) noexcept;
+    ~map_builder();
+
+    /// Add an entry. Throws if the key is already present
+    map_builder& insert(const lix::value&, const lix::value&);
+    /// Add an entry, or replace the value of an existing one
+    map_builder& insert_or_update(const lix::value&, const lix::value&);
+    /// Add or replace every entry of another map
+    map_builder& merge(const map&);
+
+    std::size_t size() const noexcept;
+
+    /// Finish building. The builder is left empty
+    [[nodiscard]] map freeze();
 };
 
+namespace detail {
+
+template <>
+struct is_cell_handle<map> : std::true_type {};
+
+}  // namespace detail
+
+/// Maps are equal if they have the same keys, with equal values
+bool operator==(const map&, const map&);
+inline bool operator!=(const map& lhs, const map& rhs) { return !(lhs == rhs); }
+
 std::ostream& operator<<(std::ostream& o, const map& l);
 
 }  // namespace lix
@@ -1,6 +1,7 @@
 #include "parse.hpp"
 
 #include <iostream>
+#include <limits>
 #include <optional>
 #include <sstream>
 #include <stack>
@@ -1,32 +1,66 @@
 #include "symbol.hpp"
 
+#include <array>
+#include <atomic>
 #include <cinttypes>
-#include <mutex>
-#include <set>
 #include <string>
 
-namespace lix::detail {
+namespace {
 
-class symtab_entry_ptr {};
+/**
+ * The global symbol table. Symbols are never removed, so the table is an array
+ * of buckets, each a singly-linked list that only ever grows at its head.
+ * Lookups of existing symbols are a handful of atomic loads and never block.
+ * Inserting a new symbol is a compare-and-swap on the bucket head.
+ */
+class symbol_table {
+    struct entry {
+        std::size_t       hash;
+        const std::string spelling;
+        // Only written before the entry is published
+        const entry* next;
+    };
 
-}  // namespace lix::detail
+    static constexpr std::size_t n_buckets = 1 << 14;
 
-namespace {
+    std::array<std::atomic<const entry*>, n_buckets> _buckets{};
 
-class symbol_table {
-    mutable std::set<std::string, std::less<>> _symbols;
-    std::mutex                                 _lock;
+    /// Find a symbol in the chain from `first` up to (but not including) `last`
+    static const entry* _find(const entry*            first,
+                              const entry*            last,
+                              std::size_t             hash,
+                              const std::string_view& spelling) noexcept {
+        for (; first != last; first = first->next) {
+            if (first->hash == hash && first->spelling == spelling) {
+                return first;
+            }
+        }
+        return nullptr;
+    }
 
 public:
     const std::string* get(const std::string_view& spelling) {
-        std::lock_guard    lk{_lock};
-        auto               iter = _symbols.find(spelling);
-        if (iter != _symbols.end()) {
-            return &*iter;
-        } else {
-            iter = _symbols.emplace(spelling).first;
-            return &*iter;
+        const auto hash   = std::hash<std::string_view>()(spelling);
+        auto&      bucket = _buckets[hash % n_buckets];
+        auto       head   = bucket.load(std::memory_order_acquire);
+        if (auto found = _find(head, nullptr, hash, spelling)) {
+            return &found->spelling;
+        }
+        // Not found. Try to add it.
+        auto new_entry = new entry{hash, std::string(spelling), head};
+        while (!bucket.compare_exchange_weak(head,
+                                             new_entry,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+            // Someone else added to the bucket. Check whether they added our
+            // symbol before we try again.
+            if (auto found = _find(head, new_entry->next, hash, spelling)) {
+                delete new_entry;
+                return &found->spelling;
+            }
+            new_entry->next = head;
         }
+        return &new_entry->spelling;
     }
 };
 
@@ -35,4 +69,4 @@ public:
 const std::string* lix::detail::get_intern_symbol_string(const std::string_view& str) {
     static symbol_table tab;
     return tab.get(str);
-}
\ No newline at end of file
+}
@@ -55,7 +55,34 @@ DEF_REL_OP(>=, std::greater_equal);
 
 inline namespace literals {
 
-inline lix::symbol operator""_sym(const char* cptr, std::size_t) { return lix::symbol(cptr); }
+#if defined(__GNUC__) || defined(__clang__)
+
+/**
+ * With GCC and Clang, `_sym` literals intern their spelling only once: each
+ * distinct spelling is its own template instantiation holding the symbol in
+ * static storage, so evaluating the literal again never touches the symbol
+ * table.
+ */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#ifdef __clang__
+#pragma clang diagnostic ignored "-Wgnu-string-literal-operator-template"
+#endif
+template <typename Char, Char... Chars>
+lix::symbol operator""_sym() {
+    static constexpr Char spelling[] = {Chars..., Char(0)};
+    static const lix::symbol sym{std::string_view(spelling, sizeof...(Chars))};
+    return sym;
+}
+#pragma GCC diagnostic pop
+
+#else
+
+inline lix::symbol operator""_sym(const char* cptr, std::size_t len) {
+    return lix::symbol(std::string_view(cptr, len));
+}
+
+#endif
 
 } // namespace literals
 
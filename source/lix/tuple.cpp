@@ -23,13 +23,25 @@ bool lix::operator==(const lix::tuple& lhs, const lix::tuple& rhs) {
     return std::equal(lhs.val_begin(), lhs.val_end(), rhs.val_begin());
 }
 
-std::size_t std::hash<lix::tuple>::operator()(const lix::tuple& tup) const {
-    auto        iter     = tup.val_begin();
-    const auto  end      = tup.val_end();
+std::size_t lix::tuple::hash() const {
+    auto cached = _node()->cached_hash.load(std::memory_order_relaxed);
+    if (cached != 0) {
+        return cached;
+    }
+    auto        iter     = val_begin();
+    const auto  end      = val_end();
     std::size_t hash_acc = 0;
     while (iter != end) {
         auto elem_hash = std::hash<lix::value>()(*iter++);
         hash_acc ^= elem_hash + 0x9e3779b97f4a7c16 + (hash_acc << 6) + (hash_acc >> 2);
     }
+    // Zero marks the hash as not yet computed
+    if (hash_acc == 0) {
+        hash_acc = 1;
+    }
+    // Racing threads compute the same value, so any of them may store it
+    _node()->cached_hash.store(hash_acc, std::memory_order_relaxed);
     return hash_acc;
-}
\ No newline at end of file
+}
+
+std::size_t std::hash<lix::tuple>::operator()(const lix::tuple& tup) const { return tup.hash(); }
\ No newline at end of file
@@ -1,86 +1,156 @@
 #ifndef LIX_TUPLE_HPP_INCLUDED
 #define LIX_TUPLE_HPP_INCLUDED
 
-#include "value_fwd.hpp"
+#include "tuple_fwd.hpp"
+#include "value.hpp"
 
-#include <functional>
-#include <memory>
-#include <ostream>
-#include <stdexcept>
-#include <vector>
+#include <atomic>
+#include <new>
+#include <utility>
 
-namespace lix {
+namespace lix::detail {
 
-class bad_tuple_access : std::out_of_range {
-public:
-    using std::out_of_range::out_of_range;
-};
+/**
+ * The storage of a tuple. The elements follow the header in the same
+ * allocation.
+ */
+class alignas(lix::value) tuple_node : public value_cell_base {
+    const std::size_t _size;
+
+    explicit tuple_node(std::size_t size) noexcept
+        : _size(size) {}
+
+    lix::value* _elems() noexcept { return reinterpret_cast<lix::value*>(this + 1); }
 
-class tuple {
-private:
-    std::shared_ptr<const std::vector<lix::value>> _values;
+    static tuple_node* _allocate(std::size_t size) {
+        void* mem = ::operator new(sizeof(tuple_node) + size * sizeof(lix::value));
+        return new (mem) tuple_node(size);
+    }
+
+    static void _destroy(tuple_node* node, std::size_t n_constructed) noexcept {
+        auto elems = node->_elems();
+        while (n_constructed != 0) {
+            elems[--n_constructed].~value();
+        }
+        node->~tuple_node();
+        ::operator delete(static_cast<void*>(node));
+    }
 
 public:
-    inline explicit tuple(const std::vector<lix::value>& b);
-    inline explicit tuple(std::vector<lix::value>&& b);
-    inline tuple(const tuple&);
-    inline tuple(tuple&&);
-    inline tuple& operator=(const tuple&);
-    inline tuple& operator=(tuple&&);
-    inline ~tuple();
+    /// The hash of the elements, or zero if it has not been computed yet
+    mutable std::atomic<std::size_t> cached_hash{0};
+
+    /// Create a node, constructing the element at each index `i` from `gen(i)`
+    template <typename Generator>
+    static tuple_node* create(std::size_t size, Generator&& gen) {
+        auto        node = _allocate(size);
+        std::size_t i    = 0;
+        try {
+            for (; i < size; ++i) {
+                new (node->_elems() + i) lix::value(gen(i));
+            }
+        } catch (...) {
+            _destroy(node, i);
+            throw;
+        }
+        return node;
+    }
 
+    /// Create a node, constructing each element from an argument
     template <typename... Ts>
-    inline static tuple make(Ts&&... ts);
+    static tuple_node* create_from(Ts&&... ts) {
+        auto        node = _allocate(sizeof...(Ts));
+        std::size_t i    = 0;
+        try {
+            ((new (node->_elems() + i) lix::value(std::forward<Ts>(ts)), ++i), ...);
+        } catch (...) {
+            _destroy(node, i);
+            throw;
+        }
+        return node;
+    }
 
-    inline std::size_t       size() const noexcept;
-    inline const lix::value& operator[](std::size_t idx) const;
+    static void release(tuple_node* node) noexcept {
+        if (node->drop_ref()) {
+            _destroy(node, node->_size);
+        }
+    }
 
-    auto val_begin() const noexcept { return _values->begin(); }
-    auto val_end() const noexcept { return _values->end(); }
+    std::size_t       size() const noexcept { return _size; }
+    const lix::value* elems() const noexcept {
+        return reinterpret_cast<const lix::value*>(this + 1);
+    }
 };
 
-std::ostream& operator<<(std::ostream& o, const tuple& l);
-
-bool operator==(const lix::tuple& lhs, const lix::tuple& rhs);
+}  // namespace lix::detail
 
-}  // namespace lix
+lix::tuple::tuple(detail::tuple_node* n) noexcept
+    : _cell(n) {}
 
-#include <lix/value.hpp>
+lix::detail::tuple_node* lix::tuple::_node() const noexcept {
+    return static_cast<detail::tuple_node*>(_cell);
+}
 
 lix::tuple::tuple(const std::vector<lix::value>& values)
-    : _values(std::make_shared<std::vector<lix::value>>(values)) {}
+    : _cell(detail::tuple_node::create(values.size(),
+                                       [&](std::size_t i) -> const lix::value& {
+                                           return values[i];
+                                       })) {}
 lix::tuple::tuple(std::vector<lix::value>&& values)
-    : _values(std::make_shared<std::vector<lix::value>>(std::move(values))) {}
+    : _cell(detail::tuple_node::create(values.size(), [&](std::size_t i) -> lix::value&& {
+        return std::move(values[i]);
+    })) {}
 
-lix::tuple::~tuple() = default;
+lix::tuple::~tuple() {
+    if (_cell) {
+        detail::tuple_node::release(_node());
+    }
+}
 
-lix::tuple::tuple(const lix::tuple&) = default;
-lix::tuple::tuple(lix::tuple&&)      = default;
-lix::tuple& lix::tuple::operator=(const lix::tuple&) = default;
-lix::tuple& lix::tuple::operator=(lix::tuple&&) = default;
+lix::tuple::tuple(const lix::tuple& other) noexcept
+    : _cell(other._cell) {
+    _cell->add_ref();
+}
+lix::tuple::tuple(lix::tuple&& other) noexcept
+    : _cell(std::exchange(other._cell, nullptr)) {}
+lix::tuple& lix::tuple::operator=(const lix::tuple& other) noexcept {
+    other._cell->add_ref();
+    if (_cell) {
+        detail::tuple_node::release(_node());
+    }
+    _cell = other._cell;
+    return *this;
+}
+lix::tuple& lix::tuple::operator=(lix::tuple&& other) noexcept {
+    if (this != &other) {
+        if (_cell) {
+            detail::tuple_node::release(_node());
+        }
+        _cell = std::exchange(other._cell, nullptr);
+    }
+    return *this;
+}
 
 template <typename... Ts>
 lix::tuple lix::tuple::make(Ts&&... ts) {
-    std::vector<lix::value> values = {lix::value(std::forward<Ts>(ts))...};
-    return tuple(std::move(values));
+    return tuple(detail::tuple_node::create_from(std::forward<Ts>(ts)...));
+}
+
+template <typename Generator>
+lix::tuple lix::tuple::generate(std::size_t n, Generator&& gen) {
+    return tuple(detail::tuple_node::create(n, std::forward<Generator>(gen)));
 }
 
 const lix::value& lix::tuple::operator[](const std::size_t idx) const {
     if (idx >= size()) {
         throw lix::bad_tuple_access{"Invalid index on tuple element"};
     }
-    return (*_values)[idx];
+    return _node()->elems()[idx];
 }
 
-std::size_t lix::tuple::size() const noexcept { return _values->size(); }
-
-namespace std {
-
-template <>
-struct hash<lix::tuple> {
-    std::size_t operator()(const lix::tuple&) const;
-};
+std::size_t lix::tuple::size() const noexcept { return _node()->size(); }
 
-} // namespace std
+const lix::value* lix::tuple::val_begin() const noexcept { return _node()->elems(); }
+const lix::value* lix::tuple::val_end() const noexcept { return _node()->elems() + size(); }
 
-#endif  // LIX_TUPLE_HPP_INCLUDED
\ No newline at end of file
+#endif  // LIX_TUPLE_HPP_INCLUDED
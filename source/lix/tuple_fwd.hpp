@@ -0,0 +1,89 @@
+#ifndef LIX_TUPLE_FWD_HPP_INCLUDED
+#define LIX_TUPLE_FWD_HPP_INCLUDED
+
+#include "value_fwd.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+namespace lix {
+
+namespace detail {
+
+class tuple_node;
+
+}  // namespace detail
+
+class bad_tuple_access : std::out_of_range {
+public:
+    using std::out_of_range::out_of_range;
+};
+
+/**
+ * An immutable, fixed-size sequence of values. The refcount, size, cached
+ * hash and elements of a tuple share a single heap allocation, which is also
+ * the cell of a value that holds the tuple.
+ */
+class tuple {
+private:
+    /// The `detail::tuple_node`
+    detail::value_cell_base* _cell;
+
+    inline explicit tuple(detail::tuple_node* n) noexcept;
+
+    inline detail::tuple_node* _node() const noexcept;
+
+public:
+    inline explicit tuple(const std::vector<lix::value>& b);
+    inline explicit tuple(std::vector<lix::value>&& b);
+    inline tuple(const tuple&) noexcept;
+    inline tuple(tuple&&) noexcept;
+    inline tuple& operator=(const tuple&) noexcept;
+    inline tuple& operator=(tuple&&) noexcept;
+    inline ~tuple();
+
+    template <typename... Ts>
+    inline static tuple make(Ts&&... ts);
+
+    /**
+     * Create a tuple of `n` elements, constructing the element at each index
+     * `i` directly from `gen(i)`
+     */
+    template <typename Generator>
+    inline static tuple generate(std::size_t n, Generator&& gen);
+
+    inline std::size_t       size() const noexcept;
+    inline const lix::value& operator[](std::size_t idx) const;
+
+    inline const lix::value* val_begin() const noexcept;
+    inline const lix::value* val_end() const noexcept;
+
+    /// The hash of the elements. It is computed once, on first use.
+    std::size_t hash() const;
+};
+
+namespace detail {
+
+template <>
+struct is_cell_handle<tuple> : std::true_type {};
+
+}  // namespace detail
+
+std::ostream& operator<<(std::ostream& o, const tuple& l);
+
+bool operator==(const lix::tuple& lhs, const lix::tuple& rhs);
+
+}  // namespace lix
+
+namespace std {
+
+template <>
+struct hash<lix::tuple> {
+    std::size_t operator()(const lix::tuple&) const;
+};
+
+}  // namespace std
+
+#endif  // LIX_TUPLE_FWD_HPP_INCLUDED
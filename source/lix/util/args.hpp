@@ -2,19 +2,44 @@
 #define LIX_UTIL_ARGS_HPP_INCLUDED
 
 #include <lix/exec/closure.hpp>
+#include <lix/exec/fn_no_impl.hpp>
 #include <lix/parser/node.hpp>
 #include <lix/util.hpp>
 #include <lix/util/opt_ref.hpp>
 #include <lix/value.hpp>
 
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace lix {
 
+/**
+ * A parameter type for native functions that want their own copy of an
+ * argument. When the caller is done with the argument and nothing else
+ * shares it, the object is moved out rather than copied, so the function may
+ * update it in place.
+ */
+template <typename T>
+class owned {
+    T _object;
+
+public:
+    explicit owned(T&& t)
+        : _object(std::move(t)) {}
+    explicit owned(const T& t)
+        : _object(t) {}
+
+    T&       operator*() noexcept { return _object; }
+    T*       operator->() noexcept { return &_object; }
+    const T& operator*() const noexcept { return _object; }
+    const T* operator->() const noexcept { return &_object; }
+};
+
 namespace detail {
 
-template <std::size_t I>
-const lix::symbol& unpack_one(const lix::tuple& input, tag<lix::symbol>) {
+template <std::size_t I, typename Args>
+const lix::symbol& unpack_one(const Args& input, tag<lix::symbol>) {
     if (input.size() <= I) {
         throw std::runtime_error{"Not enough arguments to unpack"};
     }
@@ -25,8 +50,8 @@ const lix::symbol& unpack_one(const lix::tuple& input, tag<lix::symbol>) {
     return *sym_ptr;
 }
 
-template <std::size_t I>
-const lix::string& unpack_one(const lix::tuple& input, tag<lix::string>) {
+template <std::size_t I, typename Args>
+const lix::string& unpack_one(const Args& input, tag<lix::string>) {
     if (input.size() <= I) {
         throw std::runtime_error{"Not enough arguments to unpack"};
     }
@@ -37,8 +62,8 @@ const lix::string& unpack_one(const lix::tuple& input, tag<lix::string>) {
     return *sym_ptr;
 }
 
-template <std::size_t I>
-const lix::list& unpack_one(const lix::tuple& input, tag<lix::list>) {
+template <std::size_t I, typename Args>
+const lix::list& unpack_one(const Args& input, tag<lix::list>) {
     if (input.size() <= I) {
         throw std::runtime_error{"Not enough arguments to unpack"};
     }
@@ -49,8 +74,8 @@ const lix::list& unpack_one(const lix::tuple& input, tag<lix::list>) {
     return *list_ptr;
 }
 
-template <std::size_t I>
-const lix::map& unpack_one(const lix::tuple& input, tag<lix::map>) {
+template <std::size_t I, typename Args>
+const lix::map& unpack_one(const Args& input, tag<lix::map>) {
     if (input.size() <= I) {
         throw std::runtime_error{"Not enough arguments to unpack"};
     }
@@ -61,8 +86,8 @@ const lix::map& unpack_one(const lix::tuple& input, tag<lix::map>) {
     return *map_ptr;
 }
 
-template <std::size_t I>
-const lix::boxed& unpack_one(const lix::tuple& input, tag<lix::boxed>) {
+template <std::size_t I, typename Args>
+const lix::boxed& unpack_one(const Args& input, tag<lix::boxed>) {
     if (input.size() <= I) {
         throw std::runtime_error{"Not enough arguments to unpack"};
     }
@@ -73,28 +98,34 @@ const lix::boxed& unpack_one(const lix::tuple& input, tag<lix::boxed>) {
     return *box_ptr;
 }
 
-template <std::size_t I>
-const lix::value& unpack_one(const lix::tuple& input, tag<lix::value>) {
+template <std::size_t I, typename Args>
+const lix::value& unpack_one(const Args& input, tag<lix::value>) {
     if (input.size() <= I) {
         throw std::runtime_error{"Not enough arguments to unpack"};
     }
     return input[I];
 }
 
-template <std::size_t I, typename T, typename = std::enable_if_t<is_boxable<T>::value>>
-const T& unpack_one(const lix::tuple& input, tag<const T>) {
-    const auto& boxed = unpack_one<I>(input, tag<lix::boxed>());
+template <std::size_t I,
+          typename Args,
+          typename T,
+          typename = std::enable_if_t<is_boxable<T>::value>>
+const T& unpack_one(const Args& input, tag<const T>) {
+    const auto& boxed = unpack_one<I, Args>(input, tag<lix::boxed>());
     return box_cast<std::decay_t<T>>(boxed);
 }
 
-template <std::size_t I, typename T, typename = std::enable_if_t<is_boxable<T>::value>>
-T& unpack_one(const lix::tuple& input, tag<T>) {
-    const auto& boxed = unpack_one<I>(input, tag<lix::boxed>());
+template <std::size_t I,
+          typename Args,
+          typename T,
+          typename = std::enable_if_t<is_boxable<T>::value>>
+T& unpack_one(const Args& input, tag<T>) {
+    const auto& boxed = unpack_one<I, Args>(input, tag<lix::boxed>());
     return mut_box_cast<std::decay_t<T>>(boxed);
 }
 
-template <std::size_t I>
-const lix::exec::function& unpack_one(const lix::tuple& input, tag<lix::exec::function>) {
+template <std::size_t I, typename Args>
+const lix::exec::function& unpack_one(const Args& input, tag<lix::exec::function>) {
     auto clos_ptr = input[I].as_function();
     if (!clos_ptr) {
         throw std::runtime_error{"Argument is not a funtion"};
@@ -102,8 +133,8 @@ const lix::exec::function& unpack_one(const lix::tuple& input, tag<lix::exec::fu
     return *clos_ptr;
 }
 
-template <std::size_t I>
-const lix::exec::closure& unpack_one(const lix::tuple& input, tag<lix::exec::closure>) {
+template <std::size_t I, typename Args>
+const lix::exec::closure& unpack_one(const Args& input, tag<lix::exec::closure>) {
     auto clos_ptr = input[I].as_closure();
     if (!clos_ptr) {
         throw std::runtime_error{"Argument is not a closure"};
@@ -111,13 +142,35 @@ const lix::exec::closure& unpack_one(const lix::tuple& input, tag<lix::exec::clo
     return *clos_ptr;
 }
 
+template <std::size_t I, typename Args, typename T>
+owned<T> unpack_one(const Args& input, tag<owned<T>>) {
+    const T& object = unpack_one<I, Args>(input, tag<T>());
+    if constexpr (std::is_same_v<Args, lix::exec::arg_refs>) {
+        if (input.movable(I) && input[I].is_unique()) {
+            // Nothing else can see the object, so steal it
+            return owned<T>(input.take(I).take(tag<T>()));
+        }
+    }
+    return owned<T>(object);
+}
+
 template <typename... Types, std::size_t... Is>
 decltype(auto) do_unpack_arg_tuple(const lix::value& input, std::index_sequence<Is...>) {
     auto tup_ptr = input.as_tuple();
     if (!tup_ptr) {
         throw std::runtime_error{"Cannot unpack tuple of arguments from non-tuple"};
     }
-    return std::tie(unpack_one<Is>(*tup_ptr, tag<Types>{})...);
+    return std::tuple<decltype(unpack_one<Is, lix::tuple>(*tup_ptr, tag<Types>{}))...>(
+        unpack_one<Is, lix::tuple>(*tup_ptr, tag<Types>{})...);
+}
+
+template <typename... Types, std::size_t... Is>
+decltype(auto) do_unpack_arg_refs(const lix::exec::arg_refs& input, std::index_sequence<Is...>) {
+    if (input.size() != sizeof...(Types)) {
+        throw std::runtime_error{"Wrong number of arguments"};
+    }
+    return std::tuple<decltype(unpack_one<Is, lix::exec::arg_refs>(input, tag<Types>{}))...>(
+        unpack_one<Is, lix::exec::arg_refs>(input, tag<Types>{})...);
 }
 
 }  // namespace detail
@@ -127,6 +180,15 @@ decltype(auto) unpack_arg_tuple(const lix::value& input) {
     return lix::detail::do_unpack_arg_tuple<Types...>(input, std::index_sequence_for<Types...>{});
 }
 
+/**
+ * Unpack borrowed arguments, as for `unpack_arg_tuple()`. The number of
+ * arguments must match exactly.
+ */
+template <typename... Types>
+decltype(auto) unpack_arg_refs(const lix::exec::arg_refs& input) {
+    return lix::detail::do_unpack_arg_refs<Types...>(input, std::index_sequence_for<Types...>{});
+}
+
 struct macro_argument_parser {
 private:
     const ast::list& _args;
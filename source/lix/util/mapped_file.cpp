@@ -0,0 +1,60 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+lix::mapped_file::mapped_file(const std::string& path) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        throw std::runtime_error{"Failed to open file: " + path};
+    }
+    using iter = std::istreambuf_iterator<char>;
+    _buffer.assign(iter(in), iter{});
+    _data = _buffer.data();
+    _size = _buffer.size();
+}
+
+lix::mapped_file::~mapped_file() = default;
+
+#else
+
+lix::mapped_file::mapped_file(const std::string& path) {
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error{"Failed to open file: " + path};
+    }
+    struct ::stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error{"Failed to stat file: " + path};
+    }
+    _size = static_cast<std::size_t>(st.st_size);
+    if (_size != 0) {
+        auto ptr = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error{"Failed to map file: " + path};
+        }
+        _data = static_cast<const char*>(ptr);
+    }
+    ::close(fd);
+}
+
+lix::mapped_file::~mapped_file() {
+    if (_data) {
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+}
+
+#endif
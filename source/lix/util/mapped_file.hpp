@@ -0,0 +1,34 @@
+#ifndef LIX_UTIL_MAPPED_FILE_HPP_INCLUDED
+#define LIX_UTIL_MAPPED_FILE_HPP_INCLUDED
+
+#include <string>
+#include <string_view>
+
+namespace lix {
+
+/**
+ * A read-only view of the contents of a file. On POSIX systems the file is
+ * memory-mapped, so nothing is copied until the contents are touched. On other
+ * systems the file is read into memory.
+ */
+class mapped_file {
+    const char* _data = nullptr;
+    std::size_t _size = 0;
+#ifdef _WIN32
+    std::string _buffer;
+#endif
+
+public:
+    /// Map the given file. Throws std::runtime_error on failure.
+    explicit mapped_file(const std::string& path);
+    ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    std::string_view contents() const noexcept { return std::string_view(_data, _size); }
+};
+
+}  // namespace lix
+
+#endif  // LIX_UTIL_MAPPED_FILE_HPP_INCLUDED
@@ -7,6 +7,7 @@
 
 #include <type_traits>
 #include <tuple>
+#include <utility>
 
 namespace lix {
 
@@ -43,7 +44,31 @@ struct call_wrapped<Ret(Args...)> {
     template <typename Func>
     static lix::value call(Func&& fn, lix::exec::context&, const lix::value& args) {
         auto arg_tup = lix::unpack_arg_tuple<std::decay_t<Args>...>(args);
-        return std::apply(std::forward<Func>(fn), arg_tup);
+        return std::apply(std::forward<Func>(fn), std::move(arg_tup));
+    }
+
+    template <typename Func>
+    static lix::value call_args(Func&& fn, lix::exec::context&, lix::exec::arg_refs args) {
+        auto arg_refs = lix::unpack_arg_refs<std::decay_t<Args>...>(args);
+        return std::apply(std::forward<Func>(fn), std::move(arg_refs));
+    }
+};
+
+/// Functions whose first parameter is the context are given the calling context
+template <typename Ret, typename... Args>
+struct call_wrapped<Ret(lix::exec::context&, Args...)> {
+    template <typename Func>
+    static lix::value call(Func&& fn, lix::exec::context& ctx, const lix::value& args) {
+        auto arg_tup = std::tuple_cat(std::tie(ctx),
+                                      lix::unpack_arg_tuple<std::decay_t<Args>...>(args));
+        return std::apply(std::forward<Func>(fn), std::move(arg_tup));
+    }
+
+    template <typename Func>
+    static lix::value call_args(Func&& fn, lix::exec::context& ctx, lix::exec::arg_refs args) {
+        auto arg_refs = std::tuple_cat(std::tie(ctx),
+                                       lix::unpack_arg_refs<std::decay_t<Args>...>(args));
+        return std::apply(std::forward<Func>(fn), std::move(arg_refs));
     }
 };
 
@@ -60,6 +85,12 @@ public:
         using sig_type = typename signature_of<Func>::type;
         return call_wrapped<sig_type>::call(_fn, ctx, args);
     }
+
+    /// The typed entry point: Read the arguments in place, without a tuple
+    lix::value call_args(lix::exec::context& ctx, lix::exec::arg_refs args) const {
+        using sig_type = typename signature_of<Func>::type;
+        return call_wrapped<sig_type>::call_args(_fn, ctx, args);
+    }
 };
 
 }
@@ -1,7 +1,79 @@
 #include "value.hpp"
 
+#include <cstdint>
+#include <memory>
+#include <new>
 #include <sstream>
 
+namespace {
+
+/**
+ * Destroying a cell destroys the values it holds, which may hold the last
+ * references to more cells, and so on. Rather than recursing through deep
+ * structures, the cells that are released while another is being destroyed
+ * are pushed onto this per-thread stack, and the outermost `_destroy_cell()`
+ * deletes them in a loop.
+ *
+ * The stack is linked through the refcount of each cell, which is no longer
+ * used, and each link carries the kind of the cell that it points to in its
+ * low bits. This way, deferring a cell can neither allocate nor fail.
+ */
+thread_local std::uintptr_t deferred_cells   = 0;
+thread_local bool           destroying_cells = false;
+
+constexpr auto first_heap_kind = static_cast<std::uintptr_t>(lix::value::kind::string);
+constexpr auto n_kinds         = std::uintptr_t(0)
+#define X(type, basename) +1
+    LIX_VALUE_KINDS(X)
+#undef X
+    ;
+constexpr std::uintptr_t kind_tag_mask = 0b111;
+
+static_assert(n_kinds - first_heap_kind <= kind_tag_mask + 1,
+              "Too many kinds of heap value to tag a cell pointer with");
+static_assert(alignof(lix::detail::value_cell_base) > kind_tag_mask,
+              "Cells are not aligned enough to tag their pointers");
+static_assert(sizeof(std::size_t) >= sizeof(std::uintptr_t),
+              "Cannot store a link in a cell refcount");
+
+}  // namespace
+
+void lix::value::_delete_cell(kind k, detail::value_cell_base* cell) noexcept {
+    switch (k) {
+#define X(type, basename)                                                                          \
+    case kind::basename:                                                                           \
+        if constexpr (detail::is_cell_handle<type>::value) {                                       \
+            /* Give the last reference back to a handle, which frees the node as usual */          \
+            cell->refcount.store(1, std::memory_order_relaxed);                                    \
+            std::destroy_at(std::launder(reinterpret_cast<type*>(&cell)));                         \
+        } else if constexpr (!_is_immediate(kind::basename)) {                                     \
+            delete static_cast<detail::value_cell<type>*>(cell);                                   \
+        }                                                                                          \
+        break;
+        LIX_VALUE_KINDS(X)
+#undef X
+    }
+}
+
+void lix::value::_destroy_cell() noexcept {
+    auto cell = _payload.cell;
+    if (destroying_cells) {
+        cell->refcount.store(deferred_cells, std::memory_order_relaxed);
+        deferred_cells = reinterpret_cast<std::uintptr_t>(cell)
+            | (static_cast<std::uintptr_t>(_kind) - first_heap_kind);
+        return;
+    }
+    destroying_cells = true;
+    _delete_cell(_kind, cell);
+    while (deferred_cells != 0) {
+        auto link      = deferred_cells;
+        auto next_cell = reinterpret_cast<detail::value_cell_base*>(link & ~kind_tag_mask);
+        deferred_cells = next_cell->refcount.load(std::memory_order_relaxed);
+        _delete_cell(static_cast<kind>((link & kind_tag_mask) + first_heap_kind), next_cell);
+    }
+    destroying_cells = false;
+}
+
 std::string lix::to_string(const lix::value& val) {
     std::stringstream strm;
     strm << val;
@@ -9,15 +9,19 @@
 #include <lix/numbers.hpp>
 #include <lix/string.hpp>
 #include <lix/symbol.hpp>
-#include <lix/tuple.hpp>
+#include <lix/tuple_fwd.hpp>
 #include <lix/util.hpp>
 #include <lix/util/opt_ref.hpp>
 
 #include "value_fwd.hpp"
 
+#include <atomic>
+#include <cassert>
+#include <cinttypes>
+#include <exception>
 #include <functional>
+#include <new>
 #include <ostream>
-#include <variant>
 
 namespace lix {
 
@@ -29,9 +33,13 @@ struct binding_slot {
     code::slot_ref_t slot;
 };
 
+/**
+ * A cons pattern. The head and tail refer to slots in the frame that
+ * constructed the cons, which is the only frame that may match with it.
+ */
 struct cons {
-    std::reference_wrapper<const lix::value> head;
-    std::reference_wrapper<const lix::value> tail;
+    code::slot_ref_t head;
+    code::slot_ref_t tail;
 };
 
 inline std::ostream& operator<<(std::ostream& o, binding_slot) {
@@ -48,34 +56,195 @@ inline std::ostream& operator<<(std::ostream& o, cons) {
 
 }  // namespace exec
 
+namespace detail {
+
+/// The cell of a kind whose C++ type is not itself a handle to a cell
+template <typename T>
+struct value_cell : value_cell_base {
+    T object;
+
+    template <typename... Args>
+    explicit value_cell(Args&&... args)
+        : object(std::forward<Args>(args)...) {}
+};
+
+}  // namespace detail
+
+/**
+ * The kinds of values, with the C++ type that represents each kind. The first
+ * four fit in a machine word and are stored inline in the value. The rest are
+ * stored in a refcounted heap cell. For the handles that already point to a
+ * refcounted node (see `detail::is_cell_handle`), that node is the cell.
+ */
+#define LIX_VALUE_KINDS(X)                                                                         \
+    X(lix::integer, integer)                                                                       \
+    X(lix::real, real)                                                                             \
+    X(lix::symbol, symbol)                                                                         \
+    X(lix::exec::detail::binding_slot, binding_slot)                                               \
+    X(lix::string, string)                                                                         \
+    X(lix::tuple, tuple)                                                                           \
+    X(lix::list, list)                                                                             \
+    X(lix::map, map)                                                                               \
+    X(lix::exec::function, function)                                                               \
+    X(lix::exec::closure, closure)                                                                 \
+    X(lix::exec::detail::cons, cons)                                                               \
+    X(lix::boxed, boxed)
+
+/**
+ * A lix value. This is a tagged union of a kind and a single word of payload:
+ * either an immediate value, or a pointer to a heap cell. Copying a value is
+ * at most one atomic increment.
+ */
 class value {
-    std::variant<lix::integer,
-                 lix::real,
-                 lix::symbol,
-                 lix::string,
-                 lix::tuple,
-                 lix::list,
-                 lix::map,
-                 lix::exec::function,
-                 lix::exec::closure,
-                 lix::exec::detail::binding_slot,
-                 lix::exec::detail::cons,
-                 lix::boxed>
-        _value;
+public:
+    enum class kind : std::uint8_t {
+#define X(type, basename) basename,
+        LIX_VALUE_KINDS(X)
+#undef X
+    };
+
+private:
+    kind _kind;
+    union payload {
+        lix::integer                    integer;
+        lix::real                       real;
+        lix::symbol                     symbol;
+        lix::exec::detail::binding_slot binding_slot;
+        detail::value_cell_base*        cell;
+        payload() noexcept
+            : integer(0) {}
+    } _payload;
+
+    static constexpr bool _is_immediate(kind k) noexcept { return k <= kind::binding_slot; }
+
+    void _retain() const noexcept {
+        if (!_is_immediate(_kind)) {
+            _payload.cell->refcount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    void _release() noexcept {
+        if (!_is_immediate(_kind)
+            && _payload.cell->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            _destroy_cell();
+        }
+    }
+    void        _destroy_cell() noexcept;
+    static void _delete_cell(kind, detail::value_cell_base*) noexcept;
+
+    const lix::integer* _get(tag<lix::integer>) const noexcept { return &_payload.integer; }
+    const lix::real*    _get(tag<lix::real>) const noexcept { return &_payload.real; }
+    const lix::symbol*  _get(tag<lix::symbol>) const noexcept { return &_payload.symbol; }
+    const lix::exec::detail::binding_slot* _get(tag<lix::exec::detail::binding_slot>) const
+        noexcept {
+        return &_payload.binding_slot;
+    }
+    template <typename T>
+    const T* _get(tag<T>) const noexcept {
+        if constexpr (detail::is_cell_handle<T>::value) {
+            return std::launder(reinterpret_cast<const T*>(&_payload.cell));
+        } else {
+            return &static_cast<const detail::value_cell<T>*>(_payload.cell)->object;
+        }
+    }
+
+    void _set(lix::integer i) noexcept { _payload.integer = i; }
+    void _set(lix::real r) noexcept { _payload.real = r; }
+    void _set(lix::symbol s) noexcept { _payload.symbol = s; }
+    void _set(lix::exec::detail::binding_slot b) noexcept { _payload.binding_slot = b; }
+    template <typename T>
+    void _set(T&& t) {
+        static_assert(!_is_immediate(_kind_of(tag<std::decay_t<T>>())),
+                      "Immediate value would be heap-allocated");
+        using type = std::decay_t<T>;
+        if constexpr (detail::is_cell_handle<type>::value) {
+            static_assert(sizeof(type) == sizeof(detail::value_cell_base*)
+                              && std::is_standard_layout<type>::value,
+                          "A cell handle must hold nothing but the pointer to its cell");
+            new (&_payload.cell) type(std::forward<T>(t));
+        } else {
+            _payload.cell = new detail::value_cell<type>(std::forward<T>(t));
+        }
+    }
+
+    template <typename T>
+    opt_ref<const T> _get_if() const noexcept {
+        if (_kind == _kind_of(tag<T>())) {
+            return *_get(tag<T>());
+        } else {
+            return nullopt;
+        }
+    }
 
 public:
+    value(const value& other) noexcept
+        : _kind(other._kind)
+        , _payload(other._payload) {
+        _retain();
+    }
+    value(value&& other) noexcept
+        : _kind(other._kind)
+        , _payload(other._payload) {
+        other._kind            = kind::integer;
+        other._payload.integer = 0;
+    }
+    value& operator=(const value& other) noexcept {
+        other._retain();
+        _release();
+        _kind    = other._kind;
+        _payload = other._payload;
+        return *this;
+    }
+    value& operator=(value&& other) noexcept {
+        if (this != &other) {
+            _release();
+            _kind                  = other._kind;
+            _payload               = other._payload;
+            other._kind            = kind::integer;
+            other._payload.integer = 0;
+        }
+        return *this;
+    }
+    ~value() { _release(); }
+
+    kind get_kind() const noexcept { return _kind; }
+
+    /**
+     * Whether this is the only reference to its heap cell. Immediate values
+     * are never shared. The answer is only stable while the caller holds the
+     * only other way to reach this value.
+     */
+    bool is_unique() const noexcept {
+        return _is_immediate(_kind)
+            || _payload.cell->refcount.load(std::memory_order_acquire) == 1;
+    }
+
+    /**
+     * Move the object out of a value that holds a `T`, leaving the integer
+     * zero in its place. Only the owner of the sole reference may do this.
+     */
+    template <typename T>
+    T take(tag<T>) {
+        assert(_kind == _kind_of(tag<T>()) && is_unique());
+        T ret = std::move(const_cast<T&>(*_get(tag<T>())));
+        if constexpr (!detail::is_cell_handle<T>::value) {
+            _release();
+        }
+        _kind            = kind::integer;
+        _payload.integer = 0;
+        return ret;
+    }
+
 #define DECL_METHODS(type, basename)                                                               \
+    static constexpr kind _kind_of(tag<type>) noexcept { return kind::basename; }                  \
     value(const type& t)                                                                           \
-        : _value(t) {}                                                                             \
+        : _kind(kind::basename) {                                                                  \
+        _set(t);                                                                                   \
+    }                                                                                              \
     value(type&& t)                                                                                \
-        : _value(std::move(t)) {}                                                                  \
-    opt_ref<const type> as_##basename() const noexcept {                                           \
-        if (auto ptr = std::get_if<type>(&_value)) {                                               \
-            return *ptr;                                                                           \
-        } else {                                                                                   \
-            return nullopt;                                                                        \
-        }                                                                                          \
+        : _kind(kind::basename) {                                                                  \
+        _set(std::move(t));                                                                        \
     }                                                                                              \
+    opt_ref<const type> as_##basename() const noexcept { return _get_if<type>(); }                 \
     opt_ref<const type> as(tag<type>) const noexcept { return as_##basename(); }                   \
     static_assert(true)
 
@@ -105,14 +274,20 @@ public:
 
     template <typename Fun, typename... Args>
     decltype(auto) visit(Fun&& fn, Args&&... args) const {
-        return std::visit(
-            [&](auto&& item) -> decltype(auto) {
-                return std::forward<Fun>(fn)(item, std::forward<Args>(args)...);
-            },
-            _value);
+        switch (_kind) {
+#define X(type, basename)                                                                          \
+    case kind::basename:                                                                           \
+        return std::forward<Fun>(fn)(*_get(tag<type>()), std::forward<Args>(args)...);
+            LIX_VALUE_KINDS(X)
+#undef X
+        }
+        assert(false && "Corrupted lix::value");
+        std::terminate();
     }
 };
 
+static_assert(sizeof(value) == 16, "lix::value should be two words");
+
 inline bool operator==(const value& lhs, const value& rhs) {
     return lhs.visit([&](const auto& real_value) -> bool {
         auto rhs_same = rhs.as(tag<std::decay_t<decltype(real_value)>>());
@@ -142,5 +317,6 @@ template <> struct hash <lix::value> {
 
 #include <lix/list.hpp>
 #include <lix/refl_get_member.hpp>
+#include <lix/tuple.hpp>
 
 #endif  // LIX_VALUE_HPP_INCLUDED
\ No newline at end of file
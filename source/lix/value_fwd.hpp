@@ -1,10 +1,40 @@
 #ifndef LIX_VALUE_FWD_HPP_INCLUDED
 #define LIX_VALUE_FWD_HPP_INCLUDED
 
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
 namespace lix {
 
 class value;
 
+namespace detail {
+
+/**
+ * The header of a heap-allocated value. The alternatives of `value` that do
+ * not fit in a single word live in a refcounted cell on the heap.
+ */
+struct value_cell_base {
+    mutable std::atomic<std::size_t> refcount{1};
+
+    void add_ref() const noexcept { refcount.fetch_add(1, std::memory_order_relaxed); }
+    /// Drop a reference, returning whether it was the last one
+    bool drop_ref() const noexcept {
+        return refcount.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+};
+
+/**
+ * Whether `T` is a handle whose only member is a pointer to a cell. The nodes
+ * of such handles derive from `value_cell_base`, and a value holds the handle
+ * itself in place of a cell that wraps it.
+ */
+template <typename T>
+struct is_cell_handle : std::false_type {};
+
+}  // namespace detail
+
 } // namespace lix
 
-#endif // LIX_VALUE_FWD_HPP_INCLUDED
\ No newline at end of file
+#endif // LIX_VALUE_FWD_HPP_INCLUDED
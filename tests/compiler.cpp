@@ -1,13 +1,20 @@
 #include <catch/catch.hpp>
 
+#include <lix/code/instr.hpp>
+#include <lix/code/optimize.hpp>
+#include <lix/code/serialize.hpp>
 #include <lix/compiler/compile.hpp>
 #include <lix/compiler/macro.hpp>
+#include <lix/compiler/program.hpp>
 #include <lix/exec/context.hpp>
 #include <lix/exec/exec.hpp>
+#include <lix/exec/image.hpp>
 #include <lix/exec/kernel.hpp>
 #include <lix/parser/node.hpp>
 #include <lix/parser/parse.hpp>
 
+#include <algorithm>
+
 using namespace lix;
 
 TEST_CASE("Compile a simple expression") {
@@ -51,4 +58,179 @@ TEST_CASE("Expand some macros") {
     auto in_ast   = lix::ast::parse(code);
     auto ctx      = lix::exec::build_kernel_context();
     auto expanded = lix::expand_macros(ctx, in_ast);
-}
\ No newline at end of file
+}
+TEST_CASE("Optimized code computes the same values") {
+    const char* snippets[] = {
+        R"({2 * 3 + 1 - 10 / 4, 1.5 * 2, "foo" + "bar", 1 == 1, 1 == 1.0, :a != :b, not true})",
+        R"(
+            x = 7
+            case {x, :ok} do
+                {7, :ok} -> :seven
+                {n, :err} -> n
+                _ -> :other
+            end
+        )",
+        R"(
+            f = fn
+                {:ok, [h | t]}, x -> {h, t, x}
+                {a, a}, _ -> :same
+                [1, b, 3], _ -> b
+                other, y -> {:other, other, y}
+            end
+            {f.({:ok, [1, 2, 3]}, 9), f.({4, 4}, 0), f.([1, 7, 3], 0), f.([1, 7], 0)}
+        )",
+    };
+    auto run = [](const lix::code::code& block) {
+        auto ctx = lix::exec::build_kernel_context();
+        return lix::exec::executor{block}.execute_all(ctx);
+    };
+    auto ctx = lix::exec::build_kernel_context();
+    for (auto snippet : snippets) {
+        INFO(snippet);
+        auto                      ast       = lix::expand_macros(ctx, lix::ast::parse(snippet));
+        auto                      block     = lix::compile(ast);
+        lix::code::optimize_stats stats;
+        auto                      optimized = lix::code::optimize(block, &stats);
+        CHECK(stats.instrs_before == block.size());
+        CHECK(stats.instrs_after == optimized.size());
+        CHECK(optimized.size() < block.size());
+        CHECK(run(optimized) == run(block));
+    }
+}
+
+TEST_CASE("Optimized code keeps only the constants it loads") {
+    auto ctx   = lix::exec::build_kernel_context();
+    auto ast   = lix::ast::parse(R"({"foo" + "bar", "fo" + "obar", "foobar"})");
+    auto block = lix::compile(lix::expand_macros(ctx, ast));
+    CHECK(block.constants().size() == 5);
+    // Both sums fold to the string that is already in the pool
+    auto optimized = lix::code::optimize(block);
+    REQUIRE(optimized.constants().size() == 1);
+    CHECK(optimized.constants()[0] == lix::value(lix::string("foobar")));
+    auto result = lix::exec::executor{optimized}.execute_all(ctx);
+    CHECK(result == lix::exec::executor{block}.execute_all(ctx));
+}
+
+TEST_CASE("Constant literals are built once, into the constant pool") {
+    auto ctx   = lix::exec::build_kernel_context();
+    auto ast   = lix::ast::parse(R"({:badarg, "Mod.fn", [1, {2.5, "x"}]})");
+    auto block = lix::compile(lix::expand_macros(ctx, ast));
+    // Just a load_const and a ret
+    REQUIRE(block.size() == 2);
+    CHECK(std::holds_alternative<lix::code::is_types::load_const>(block.begin()->instr_var()));
+    REQUIRE(block.constants().size() == 1);
+    std::vector<lix::value> elems  = {1, lix::tuple::make(2.5, lix::string("x"))};
+    lix::list               list   = lix::list(elems.begin(), elems.end());
+    lix::value              expect = lix::tuple::make("badarg"_sym, lix::string("Mod.fn"), list);
+    CHECK(block.constants()[0] == expect);
+
+    auto run = [&](const lix::code::code& c) { return lix::exec::executor{c}.execute_all(ctx); };
+    CHECK(run(block) == expect);
+    CHECK(run(block) == expect);
+
+    // Quoted code is constant too, and the pool survives serialization
+    auto quoted = lix::compile(lix::expand_macros(ctx, lix::ast::parse(R"(quote do: f(1, "a"))")));
+    CHECK(quoted.constants().size() == 1);
+    lix::code::byte_writer         out;
+    lix::code::string_table_writer strings;
+    lix::code::write_code(out, strings, quoted);
+    lix::code::byte_writer table;
+    strings.write(table);
+    lix::code::byte_reader         table_in{table.bytes()};
+    lix::code::string_table_reader strings_in{table_in};
+    lix::code::byte_reader         code_in{out.bytes()};
+    auto                           loaded = lix::code::read_code(code_in, strings_in);
+    CHECK(loaded.constants() == quoted.constants());
+    CHECK(run(loaded) == run(quoted));
+}
+
+TEST_CASE("Optimized programs compute the same values") {
+    auto source = lix::ast::parse(R"(
+        defmodule Opt do
+          def count(0, acc), do: acc
+          def count(n, acc), do: count(n - 1, acc + n)
+
+          def pick(x) do
+            y = case x do
+              {:a, v} ->
+                k = 100
+                v + 1
+              {:b, v} ->
+                k = 100
+                v + k
+              _ -> :none
+            end
+            {y, x}
+          end
+
+          def walk([], acc), do: acc
+          def walk([h | t], acc) do
+            unused = 7
+            walk(t, [{h, pick({:b, h})} | acc])
+          end
+        end
+
+        {Opt.count(1000, 0), Opt.pick({:a, 1}), Opt.pick({:b, 2}), Opt.pick(:c),
+         Opt.walk([1, 2, 3], [])}
+    )");
+    lix::code::optimize_stats stats;
+    auto                      compile = [&](lix::code::optimize_stats* optimized) {
+        auto ctx = lix::exec::build_kernel_context();
+        return lix::compile_program(ctx, source, optimized);
+    };
+    auto plain     = compile(nullptr);
+    auto optimized = compile(&stats);
+    CHECK(stats.instrs_after < stats.instrs_before);
+    // A constant that only one branch of pick() reads, and one that nothing in
+    // the loop of walk() reads, renumber the slots above them
+    CHECK(stats.dead_slots >= 2);
+    // The result of the case in pick() is moved into `y`
+    CHECK(stats.moves >= 1);
+
+    // Each image goes through the serializer into a context of its own
+    auto run = [](const std::string& image, lix::exec::context& ctx) {
+        auto entry = lix::exec::load_program_image(ctx, image);
+        return lix::exec::executor(entry).execute_all(ctx);
+    };
+    auto plain_ctx     = lix::exec::build_kernel_context();
+    auto optimized_ctx = lix::exec::build_kernel_context();
+    auto expect        = run(plain, plain_ctx);
+    CHECK(run(optimized, optimized_ctx) == expect);
+    CHECK((*expect.as_tuple())[0] == 500500);
+
+    // The optimized code that was loaded still loops with tail_self, and
+    // moves the result of the case
+    auto instrs_of = [&](const char* fn) {
+        auto mod = optimized_ctx.get_module("Opt");
+        REQUIRE(mod);
+        auto clos = std::get_if<lix::exec::closure>(mod->find_function(fn));
+        REQUIRE(clos);
+        return clos->code();
+    };
+    namespace is   = lix::code::is_types;
+    auto has_instr = [](const lix::code::code& c, auto pred) {
+        return std::any_of(c.begin(), c.end(), [&](auto& in) { return pred(in.instr_var()); });
+    };
+    CHECK(has_instr(instrs_of("count"), [](auto& var) {
+        return std::holds_alternative<is::tail_self>(var);
+    }));
+    CHECK(has_instr(instrs_of("pick"), [](auto& var) {
+        auto m = std::get_if<is::hard_match_jump>(&var);
+        return m && m->move_rhs;
+    }));
+
+    // Call the module functions directly with more arguments
+    for (auto arg : {lix::value(lix::tuple::make("a"_sym, 41)),
+                     lix::value(lix::tuple::make("b"_sym, -100)),
+                     lix::value(lix::tuple::make("a"_sym, 1, 2)),
+                     lix::value("other"_sym)}) {
+        INFO(lix::inspect(arg));
+        auto call = [&](lix::exec::context& ctx) {
+            auto              mod  = ctx.get_module("Opt");
+            auto              clos = std::get<lix::exec::closure>(*mod->find_function("pick"));
+            const lix::value* args = &arg;
+            return lix::exec::executor().call(ctx, clos, lix::exec::arg_refs(&args, 1));
+        };
+        CHECK(call(optimized_ctx) == call(plain_ctx));
+    }
+}
@@ -3,6 +3,11 @@
 #include <lix/eval.hpp>
 #include <lix/libs/libs.hpp>
 
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
 TEST_CASE("Create a context with libraries") {
     auto ctx = lix::libs::create_context<lix::libs::Enum,
                                          lix::libs::Map,
@@ -72,3 +77,241 @@ TEST_CASE("Create a context with libraries") {
     )code",
                     ctx);
 }
+
+TEST_CASE("Libraries load the same from source and from bytecode") {
+    auto kernel     = lix::exec::build_kernel_context();
+    auto from_image = lix::exec::build_kernel_context();
+    lix::libs::add_libraries<lix::libs::Enum, lix::libs::Keyword>(from_image);
+    lix::libs::Enum::eval_source(kernel);
+    lix::libs::Keyword::eval_source(kernel);
+    auto code = R"code(
+        kw = [a: 1, b: 2, c: 3]
+        {Enum.map(kw, fn {_, v} -> v * 2 end), Keyword.get(kw, :b), Enum.reduce([1, 2, 3], 0, &(&1 + &2))}
+    )code";
+    CHECK(lix::inspect(lix::eval(code, from_image)) == lix::inspect(lix::eval(code, kernel)));
+}
+
+TEST_CASE("Map literals and Map.new") {
+    auto ctx = lix::libs::create_context<lix::libs::Map>();
+    auto val = lix::eval(R"(
+        map = %{a: 1, b: 2}
+        2 = map.b
+        map2 = Map.new([{:a, 1}, {:b, 2}, {:a, 3}])
+        3 = map2.a
+        map3 = Map.merge(map2, %{b: 4, c: 5})
+        {3, 4, 5} = {map3.a, map3.b, map3.c}
+        %{a: 3, b: 4, c: 5} = map3
+        %{} = Map.new([])
+        :ok
+    )",
+                         ctx);
+    CHECK(val == lix::symbol("ok"));
+    CHECK_THROWS(lix::eval("Map.new([1])", ctx));
+}
+
+TEST_CASE("Enumerate maps") {
+    auto ctx = lix::libs::create_context<lix::libs::Enum, lix::libs::Map>();
+    auto val = lix::eval(R"code(
+        map = %{a: 1, b: 2, c: 3}
+        3 = Map.size(map)
+        0 = Map.size(%{})
+        [] = Map.keys(%{})
+        6 = Enum.reduce(Map.values(map), &(&1 + &2))
+        6 = Enum.reduce(map, 0, fn {_key, val}, acc -> val + acc end)
+        keys = Enum.map(map, fn {key, _val} -> key end)
+        keys = Map.keys(map)
+        keys = Enum.map(Map.to_list(map), fn {key, _val} -> key end)
+        [{:b, 2}] = Enum.filter(map, fn {_key, val} -> val == 2 end)
+        3 = Enum.reduce(Enum.to_list(map), 0, fn _el, acc -> acc + 1 end)
+        :ok
+    )code",
+                         ctx);
+    CHECK(val == lix::symbol("ok"));
+    CHECK_THROWS(lix::eval("Enum.map(12, fn el -> el end)", ctx));
+}
+
+TEST_CASE("Accumulate into a map") {
+    auto ctx = lix::libs::create_context<lix::libs::Enum, lix::libs::Map>();
+    auto val = lix::eval(R"code(
+        base = %{a: 1}
+        counts = Enum.reduce([:a, :b, :a, :c, :a], base, fn el, acc ->
+          case Map.fetch(acc, el) do
+            {:ok, n} -> Map.put(acc, el, n + 1)
+            :error -> Map.put(acc, el, 1)
+          end
+        end)
+        %{a: 4, b: 1, c: 1} = counts
+        %{a: 1} = base
+        1 = Map.size(base)
+        {4, rest} = Map.pop(counts, :a)
+        2 = Map.size(rest)
+        3 = Map.size(counts)
+        :ok
+    )code",
+                         ctx);
+    CHECK(val == lix::symbol("ok"));
+}
+
+TEST_CASE("Native Enum functions match their lix fallbacks") {
+    auto ctx = lix::libs::create_context<lix::libs::Enum>();
+    auto val = lix::eval(R"code(
+        list = [1, 2, 3, 4, 5]
+        add = 10
+        [11, 12, 13, 14, 15] = Enum.map(list, fn el -> el + add end)
+        [11, 12, 13, 14, 15] = Enum.__map(list, fn el -> el + add end)
+        [2] = Enum.filter(list, fn el -> el == 2 end)
+        [2] = Enum.__filter(list, fn el -> el == 2 end)
+        [5, 4, 3, 2, 1] = Enum.reduce(list, [], fn el, acc -> [el|acc] end)
+        [5, 4, 3, 2, 1] = Enum.__reduce(list, [], fn el, acc -> [el|acc] end)
+        15 = Enum.reduce(list, &(&1 + &2))
+        [1, 1, 2, 2, 3, 3] = Enum.flat_map([1, 2, 3], fn el -> [el, el] end)
+        [1, 1, 2, 2, 3, 3] = Enum.__flat_map([1, 2, 3], fn el -> [el, el] end)
+        [1, 2, 3, 4] = Enum.flatten([[1], [], [2, 3], [4]])
+        [1, 2, 3, 4] = Enum.__flatten([[1], [], [2, 3], [4]])
+        [1, 2, 3, 4, 5] = [1] ++ [2, 3] ++ [] ++ [4, 5]
+        [[2, 3], [3, 4]] = Enum.map([1, 2], fn el -> Enum.map([el, el + 1], &(&1 + 1)) end)
+        [] = Enum.map([], fn el -> el end)
+        :ok
+    )code",
+                         ctx);
+    CHECK(val == lix::symbol("ok"));
+
+    CHECK_THROWS(lix::eval("Enum.filter([1, 2], fn el -> el end)", ctx));
+    CHECK_THROWS(lix::eval("Enum.flat_map([1, 2], fn el -> el end)", ctx));
+    CHECK_THROWS(lix::eval("Enum.flatten([[1], 2])", ctx));
+    CHECK_THROWS(lix::eval("Enum.__flatten([[1], 2])", ctx));
+    CHECK_THROWS(lix::eval("Enum.map([1, 2], :not_a_function)", ctx));
+    CHECK_THROWS(lix::eval("Enum.map([1, 2], fn el -> raise {:failed, el} end)", ctx));
+    // The context is still usable after a raise from inside a callback
+    CHECK(lix::eval("Enum.reduce([1, 2, 3], 0, &(&1 + &2))", ctx) == lix::value(6));
+}
+
+TEST_CASE("Native Enum functions on large lists", "[.bench]") {
+    using clock = std::chrono::steady_clock;
+    auto ctx    = lix::libs::create_context<lix::libs::Enum>();
+    std::vector<lix::value> elems;
+    for (auto i = 0; i < 1'000'000; ++i) {
+        elems.emplace_back(i);
+    }
+    lix::list numbers{elems.begin(), elems.end()};
+
+    auto time = [&](const std::string& fn, const char* cb, bool with_acc) {
+        auto args  = with_acc ? lix::tuple::make(numbers, 0, lix::eval(cb, ctx))
+                              : lix::tuple::make(numbers, lix::eval(cb, ctx));
+        auto start = clock::now();
+        lix::call_mfa_tup(ctx, lix::symbol("Enum"), lix::symbol(fn), args);
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    };
+    struct bench {
+        const char* name;
+        const char* cb;
+        bool        with_acc;
+    };
+    for (auto [name, cb, with_acc] : {bench{"map", "fn el -> el * 2 end", false},
+                                      bench{"filter", "fn el -> el == 7 end", false},
+                                      bench{"flat_map", "fn el -> [el] end", false},
+                                      bench{"reduce", "fn el, acc -> el + acc end", true}}) {
+        auto native_ms = time(name, cb, with_acc);
+        auto lix_ms    = time(std::string("__") + name, cb, with_acc);
+        std::cout << "Enum." << name << " on 10^6 elements: native " << native_ms << "ms, lix "
+                  << lix_ms << "ms\n";
+        CHECK(native_ms < lix_ms);
+    }
+}
+
+TEST_CASE("Accumulate into a large map", "[.bench]") {
+    using clock = std::chrono::steady_clock;
+    auto ctx    = lix::libs::create_context<lix::libs::Enum, lix::libs::Map>();
+    std::vector<lix::value> elems;
+    for (auto i = 0; i < 200'000; ++i) {
+        elems.emplace_back(i);
+    }
+    lix::list numbers{elems.begin(), elems.end()};
+
+    auto time = [&](const char* cb) {
+        auto args  = lix::tuple::make(numbers, lix::map(), lix::eval(cb, ctx));
+        auto start = clock::now();
+        auto ret   = lix::call_mfa_tup(ctx, lix::symbol("Enum"), lix::symbol("reduce"), args);
+        CHECK(ret.as_map()->size() == numbers.size());
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    };
+    // Map.put in tail position may update the accumulator in place
+    auto in_place_ms = time("fn el, acc -> Map.put(acc, el, el) end");
+    // Otherwise, the frame still holds the accumulator, so every put copies
+    auto copying_ms = time(R"(fn el, acc ->
+                                 ret = Map.put(acc, el, el)
+                                 ret
+                               end)");
+    std::cout << "Map.put into 2*10^5 entries: in place " << in_place_ms << "ms, copying "
+              << copying_ms << "ms\n";
+    CHECK(in_place_ms < copying_ms);
+}
+
+TEST_CASE("Context startup time", "[.bench]") {
+    using clock           = std::chrono::steady_clock;
+    constexpr auto n_iter = 200;
+
+    auto from_source = [] {
+        auto ctx = lix::exec::build_kernel_context();
+        lix::libs::Enum::eval_source(ctx);
+        lix::libs::Map::eval_source(ctx);
+        lix::libs::String::eval_source(ctx);
+        lix::libs::Keyword::eval_source(ctx);
+        lix::libs::File::eval_source(ctx);
+        return ctx;
+    };
+    auto from_image = [] {
+        auto ctx = lix::exec::build_kernel_context();
+        lix::libs::add_libraries<lix::libs::Enum,
+                                 lix::libs::Map,
+                                 lix::libs::String,
+                                 lix::libs::Keyword,
+                                 lix::libs::File>(ctx);
+        return ctx;
+    };
+    auto from_template = [] {
+        return lix::libs::create_context<lix::libs::Enum,
+                                         lix::libs::Map,
+                                         lix::libs::String,
+                                         lix::libs::Keyword,
+                                         lix::libs::File>();
+    };
+    auto time = [&](auto&& make) {
+        auto start = clock::now();
+        for (auto i = 0; i < n_iter; ++i) {
+            make();
+        }
+        return std::chrono::duration<double, std::micro>(clock::now() - start).count() / n_iter;
+    };
+    auto source_us   = time(from_source);
+    auto image_us    = time(from_image);
+    auto template_us = time(from_template);
+    std::cout << "create_context from source:   " << source_us << "us\n"
+              << "create_context from bytecode: " << image_us << "us\n"
+              << "create_context from template: " << template_us << "us\n";
+    CHECK(template_us < image_us);
+    CHECK(image_us < source_us);
+}
+
+TEST_CASE("Fork a context") {
+    auto& tmpl = lix::libs::context_template<lix::libs::Enum>();
+    auto  ctx  = tmpl.fork();
+    // A fork sees the same modules, so it can use what the template resolved
+    CHECK(ctx.module_epoch() == tmpl.module_epoch());
+    CHECK(lix::eval("Enum.reverse([1, 2, 3])", ctx).as_list()->size() == 3);
+
+    // New modules are only visible in the context that defined them
+    lix::eval("defmodule Forked do\n def value(), do: 42\n end", ctx);
+    CHECK(ctx.module_epoch() != tmpl.module_epoch());
+    CHECK(lix::eval("Forked.value()", ctx) == lix::value(42));
+    CHECK_FALSE(tmpl.get_module("Forked"));
+    auto sibling = tmpl.fork();
+    CHECK_FALSE(sibling.get_module("Forked"));
+    CHECK(sibling.get_module("Enum"));
+
+    // Forks of forks see everything their parent had
+    auto grandchild = ctx.fork();
+    CHECK(lix::eval("Forked.value()", grandchild) == lix::value(42));
+    CHECK_THROWS(grandchild.register_module("Enum", lix::exec::module()));
+    CHECK(ctx.get_module("Forked"));
+}
@@ -1,17 +1,26 @@
 #include <lix/boxed.hpp>
+#include <lix/code/call_cache.hpp>
+#include <lix/code/serialize.hpp>
 #include <lix/compiler/compile.hpp>
+#include <lix/compiler/program.hpp>
 #include <lix/eval.hpp>
 #include <lix/exec/context.hpp>
 #include <lix/exec/exec.hpp>
+#include <lix/exec/image.hpp>
 #include <lix/exec/kernel.hpp>
 #include <lix/list.hpp>
 #include <lix/parser/parse.hpp>
 #include <lix/refl_get_member.hpp>
 #include <lix/symbol.hpp>
 #include <lix/tuple.hpp>
+#include <lix/util/wrap_fn.hpp>
 
 #include <catch/catch.hpp>
 
+#include <algorithm>
+
+#include <thread>
+
 using namespace lix::literals;
 
 struct my_int {
@@ -129,6 +138,219 @@ TEST_CASE("Map basics") {
     CHECK_FALSE(ref);
 }
 
+TEST_CASE("Build a map in place") {
+    lix::map_builder builder;
+    for (auto i = 0; i < 5000; ++i) {
+        builder.insert(i, i * 2);
+    }
+    CHECK_THROWS_AS(builder.insert(12, 0), std::runtime_error);
+    builder.insert_or_update(12, "twelve"_sym);
+    CHECK(builder.size() == 5000);
+    auto base = builder.freeze();
+    CHECK(builder.size() == 0);
+    for (auto i = 0; i < 5000; ++i) {
+        auto ref = base.find(i);
+        REQUIRE(ref);
+        CHECK(*ref == (i == 12 ? lix::value("twelve"_sym) : lix::value(i * 2)));
+    }
+
+    // Building on an existing map leaves that map as it was
+    lix::map_builder more{base};
+    for (auto i = 0; i < 5000; i += 2) {
+        more.insert_or_update(i, "even"_sym);
+    }
+    more.insert("foo"_sym, 1);
+    auto other = more.freeze();
+    CHECK(*other.find(4) == "even"_sym);
+    CHECK(*other.find(5) == 10);
+    CHECK(*other.find("foo"_sym) == 1);
+    CHECK(*base.find(4) == 8);
+    CHECK_FALSE(base.find("foo"_sym));
+
+    auto merged = lix::map_builder{lix::map().insert("foo"_sym, 2)}.merge(other).freeze();
+    CHECK(*merged.find("foo"_sym) == 1);
+    CHECK(*merged.find(4999) == 9998);
+}
+
+TEST_CASE("Update a map that is about to be discarded") {
+    lix::map m;
+    for (auto i = 0; i < 500; ++i) {
+        m = std::move(m).insert_or_update(i, i);
+    }
+    auto shared = m;
+    m           = std::move(m).insert_or_update(3, "three"_sym);
+    CHECK(*m.find(3) == "three"_sym);
+    // The copy was taken before the update, so it must not see it
+    CHECK(*shared.find(3) == 3);
+
+    for (auto i = 0; i < 500; i += 2) {
+        auto pair_opt = std::move(m).pop(i);
+        REQUIRE(pair_opt);
+        m = std::move(pair_opt->second);
+    }
+    CHECK_FALSE(std::move(m).pop(0));
+    CHECK(m.size() == 250);
+    CHECK_FALSE(m.find(4));
+    CHECK(*m.find(3) == "three"_sym);
+    CHECK(shared.size() == 500);
+    CHECK(*shared.find(4) == 4);
+}
+
+TEST_CASE("A value holding a map or a box shares its refcount") {
+    // Copying the map or box out of a value references the same cell as the
+    // value, because the node of the map or box is that cell
+    lix::value map_val = lix::map().insert(1, 2);
+    CHECK(map_val.is_unique());
+    {
+        auto map_copy = *map_val.as_map();
+        CHECK_FALSE(map_val.is_unique());
+    }
+    CHECK(map_val.is_unique());
+
+    lix::value box_val = lix::boxed(my_int{3});
+    CHECK(box_val.is_unique());
+    {
+        const auto box_copy = *box_val.as_boxed();
+        CHECK_FALSE(box_val.is_unique());
+        CHECK(lix::box_cast<my_int>(box_copy).value == 3);
+    }
+    CHECK(box_val.is_unique());
+
+    // Taking the map leaves nothing behind that still refers to it
+    auto taken = map_val.take(lix::tag<lix::map>());
+    CHECK(map_val == 0);
+    CHECK(*taken.find(1) == 2);
+}
+
+TEST_CASE("Iterate a map") {
+    CHECK(lix::map().begin() == lix::map().end());
+    lix::map_builder builder;
+    for (auto i = 0; i < 5000; ++i) {
+        builder.insert(i, i * 3);
+    }
+    auto             m = builder.freeze();
+    std::vector<int> seen(5000, 0);
+    for (auto [key, val] : m) {
+        auto k = *key.as_integer();
+        CHECK(val == k * 3);
+        ++seen[static_cast<std::size_t>(k)];
+    }
+    CHECK(std::count(seen.begin(), seen.end(), 1) == 5000);
+    CHECK(std::distance(m.begin(), m.end()) == 5000);
+
+    auto small = lix::map().insert("a"_sym, 1);
+    CHECK(lix::to_string(small) == "%{:a => 1}");
+    CHECK(small == lix::map().insert("a"_sym, 1));
+    CHECK(small != lix::map().insert("a"_sym, 2));
+}
+
+TEST_CASE("Tuple basics") {
+    auto pair = lix::tuple::make("ok"_sym, lix::tuple::make(1, "two"));
+    REQUIRE(pair.size() == 2);
+    CHECK(pair[0] == "ok"_sym);
+    CHECK_THROWS(pair[2]);
+
+    auto copy = pair;
+    CHECK(copy == pair);
+    CHECK(std::hash<lix::tuple>()(copy) == std::hash<lix::tuple>()(pair));
+    auto moved = std::move(copy);
+    CHECK(moved == pair);
+
+    auto squares = lix::tuple::generate(4, [](std::size_t i) { return lix::value(i * i); });
+    CHECK(lix::inspect(squares) == "{0, 1, 4, 9}");
+    CHECK(squares == lix::tuple(std::vector<lix::value>{0, 1, 4, 9}));
+    CHECK(std::hash<lix::tuple>()(squares)
+          == std::hash<lix::tuple>()(lix::tuple::make(0, 1, 4, 9)));
+    CHECK_FALSE(squares == lix::tuple::make(0, 1, 4));
+    CHECK(lix::tuple::make().size() == 0);
+}
+
+TEST_CASE("A tuple value is a single allocation") {
+    auto       tup   = lix::tuple::make(1, "two"_sym);
+    auto       elems = tup.val_begin();
+    lix::value val   = std::move(tup);
+    // The value holds the node of the tuple, not a cell that wraps it
+    CHECK(val.as_tuple()->val_begin() == elems);
+    CHECK(val.is_unique());
+    {
+        // So the tuple handle and the value count their references together
+        auto copy = *val.as_tuple();
+        CHECK_FALSE(val.is_unique());
+        CHECK(copy.val_begin() == elems);
+    }
+    CHECK(val.is_unique());
+}
+
+TEST_CASE("List basics") {
+    std::vector<lix::value> items;
+    for (auto i = 0; i < 100; ++i) {
+        items.push_back(i);
+    }
+    lix::list built{items.begin(), items.end()};
+    REQUIRE(built.size() == 100);
+    CHECK(std::equal(built.begin(), built.end(), items.begin()));
+
+    // Popping walks across chunks
+    auto tail = built;
+    for (auto i = 0; i < 99; ++i) {
+        tail = tail.pop_front();
+    }
+    CHECK(tail.size() == 1);
+    CHECK(*tail.begin() == 99);
+
+    // Lists that share a tail each get their own head
+    auto left  = built.pop_front().push_front("left"_sym);
+    auto right = built.pop_front().push_front("right"_sym);
+    CHECK(*left.begin() == "left"_sym);
+    CHECK(*right.begin() == "right"_sym);
+    CHECK(left.pop_front() == right.pop_front());
+    CHECK(lix::value(built) == lix::value(built.pop_front().push_front(0)));
+    CHECK_FALSE(left == right);
+
+    lix::list pushed;
+    for (auto i = 99; i >= 0; --i) {
+        pushed = pushed.push_front(i);
+    }
+    CHECK(pushed == built);
+
+    auto both = lix::list::concat(built, pushed);
+    CHECK(both.size() == 200);
+    CHECK(lix::inspect(lix::list::concat(lix::list(), tail)) == "[99]");
+    CHECK(lix::inspect(lix::list::concat(tail, tail)) == "[99, 99]");
+}
+
+TEST_CASE("Drop long lists and deep structures") {
+    // None of these should be torn down recursively, or they would exhaust the stack
+    constexpr auto n = 3'000'000;
+    {
+        std::vector<lix::value> items(n, lix::value(lix::string("line")));
+        lix::list               lines{items.begin(), items.end()};
+        items.clear();
+        CHECK(lines.size() == n);
+    }
+    {
+        lix::list pushed;
+        for (auto i = 0; i < n; ++i) {
+            pushed = pushed.push_front(i);
+        }
+        CHECK(pushed.size() == n);
+    }
+    {
+        // {n, {n - 1, ... {1, {}}}}
+        lix::value nested = lix::tuple::make();
+        for (auto i = 0; i < n; ++i) {
+            nested = lix::tuple::make(i, std::move(nested));
+        }
+    }
+    {
+        // [[[...]]]
+        lix::value nested = lix::list();
+        for (auto i = 0; i < n; ++i) {
+            nested = lix::list().push_front(std::move(nested));
+        }
+    }
+}
+
 TEST_CASE("Simple eval") {
     auto val = lix::eval("2 + 5");
     REQUIRE(val.as_integer());
@@ -350,6 +572,88 @@ TEST_CASE("case clauses 4") {
     }
 }
 
+TEST_CASE("case clauses are dispatched on shape") {
+    auto code = R"(
+        classify = fn val ->
+            case val do
+                {:cons, 1, rest} -> {:one, rest}
+                {:cons, _head, rest} -> {:other, rest}
+                {a, b} -> {:pair, a, b}
+                {:ok, v} -> {:never, v}
+                [] -> :empty
+                [_h|_t] -> :list
+                3 -> :three
+                :three -> :three_sym
+                other -> {:default, other}
+            end
+        end
+        {:one, 2} = classify.({:cons, 1, 2})
+        {:other, 3} = classify.({:cons, 2, 3})
+        {:pair, :ok, 4} = classify.({:ok, 4})
+        {:pair, :cons, 1} = classify.({:cons, 1})
+        {:default, {:x, 1, 2}} = classify.({:x, 1, 2})
+        :empty = classify.([])
+        :list = classify.([1, 2])
+        :three = classify.(3)
+        :three_sym = classify.(:three)
+        {:default, 4} = classify.(4)
+        {:default, "str"} = classify.("str")
+
+        # Dispatched on the second argument
+        first = fn
+            n, [] -> {:none, n}
+            n, [h|_t] -> {n, h}
+            n -> {:single, n}
+        end
+        {:none, 1} = first.(1, [])
+        {1, 2} = first.(1, [2, 3])
+        {:single, 3} = first.(3)
+        :ok
+    )";
+    auto ast   = lix::ast::parse(code);
+    auto block = lix::compile(ast);
+    INFO(block);
+    CHECK(std::any_of(block.begin(), block.end(), [](const lix::code::instr& i) {
+        return std::holds_alternative<lix::code::is_types::switch_shape>(i.instr_var());
+    }));
+    CHECK(lix::eval(ast) == lix::symbol("ok"));
+}
+
+TEST_CASE("Patterns are matched without building them") {
+    auto code = R"(
+        f = fn
+            {:ok, [h|t]}, x -> {h, t, x}
+            {a, a}, _ -> :same
+            [1, b, 3], _ -> b
+            {n, {m, "s"}}, _ -> n + m
+            other, y -> {:other, other, y}
+        end
+        {1, [2, 3], 9} = f.({:ok, [1, 2, 3]}, 9)
+        :same = f.({4, 4}, 0)
+        {:other, {4, 5}, 0} = f.({4, 5}, 0)
+        7 = f.([1, 7, 3], 0)
+        {:other, [1, 7], 0} = f.([1, 7], 0)
+        3 = f.({1, {2, "s"}}, 0)
+        {:other, {1, {2, "t"}}, 0} = f.({1, {2, "t"}}, 0)
+        {p, [q|_rest]} = {1, [2]}
+        p + q
+    )";
+    auto ast   = lix::ast::parse(code);
+    auto block = lix::compile(ast);
+    INFO(block);
+    CHECK(std::none_of(block.begin(), block.end(), [](const lix::code::instr& i) {
+        return std::holds_alternative<lix::code::is_types::try_match>(i.instr_var());
+    }));
+    CHECK(lix::eval(ast) == 3);
+
+    try {
+        lix::eval("{r, r} = {1, 2}");
+        CHECK(false);
+    } catch (const lix::raised_exception& e) {
+        CHECK(e.value() == lix::tuple::make(lix::symbol("badmatch"), lix::tuple::make(1, 2)));
+    }
+}
+
 TEST_CASE("Register a module") {
     auto code = R"(
         modname = MyModule
@@ -514,6 +818,55 @@ TEST_CASE("defmodule") {
     CHECK(lix::eval("MyModule.is_cat_sound('woof')", ctx) == false_sym);
 }
 
+template <typename Instr>
+bool has_instr(const lix::code::code& c) {
+    return std::any_of(c.begin(), c.end(), [](const lix::code::instr& i) {
+        return std::holds_alternative<Instr>(i.instr_var());
+    });
+}
+
+TEST_CASE("Module functions loop on tail calls to themselves") {
+    auto code = R"(
+        defmodule Looper do
+            def count(n), do: count(n, 0)
+            def count(0, acc), do: acc
+            def count(n, acc), do: count(n - 1, acc + 1)
+
+            def swap(0, a, b), do: {a, b}
+            def swap(n, a, b), do: swap(n - 1, b, a)
+        end
+
+        defmodule Nester do
+            def nested(n) do
+                f = fn
+                    0 -> :done
+                    m -> nested(m - 1)
+                end
+                f.(n)
+            end
+        end
+    )";
+    auto ctx = lix::exec::build_kernel_context();
+    lix::eval(code, ctx);
+    CHECK(lix::eval("Looper.count(100000)", ctx) == 100000);
+    CHECK(lix::inspect(lix::eval("Looper.swap(3, :x, :y)", ctx)) == "{:y, :x}");
+    CHECK(lix::eval("Nester.nested(3)", ctx) == lix::symbol("done"));
+
+    // The functions of a module share its code
+    auto module_code = [&](const char* mod_name, const char* fn_name) {
+        auto fn = ctx.get_module(mod_name)->get_function(fn_name);
+        REQUIRE(fn);
+        auto closure = std::get_if<lix::exec::closure>(&*fn);
+        REQUIRE(closure);
+        return closure->code();
+    };
+    namespace is = lix::code::is_types;
+    CHECK(has_instr<is::tail_self>(module_code("Looper", "count")));
+    CHECK_FALSE(has_instr<is::tail_mfa>(module_code("Looper", "count")));
+    // A call from an anonymous fn within the function can't loop
+    CHECK(has_instr<is::tail_mfa>(module_code("Nester", "nested")));
+}
+
 TEST_CASE("Alias 1") {
     auto code = R"(
         defmodule MyModule.Foo do
@@ -613,6 +966,89 @@ TEST_CASE("Raise badarg") {
     }
 }
 
+TEST_CASE("Functions of several arities") {
+    auto code = R"(
+        defmodule Arity do
+            def pick(a) do
+                {:one, a}
+            end
+            def pick(a, a) do
+                {:same, a}
+            end
+            def pick(a, b) do
+                {:two, a, b}
+            end
+        end
+
+        other = 4
+        twice = fn
+            x -> x + other
+            x, y -> x + y + other
+        end
+
+        {Arity.pick(1), Arity.pick(2, 2), Arity.pick(2, 3),
+         apply(:Arity, :pick, [5, 6]), twice.(1), twice.(1, 2)}
+    )";
+    auto ctx  = lix::exec::build_kernel_context();
+    auto val  = lix::eval(code, ctx);
+    CHECK(lix::inspect(val) == "{{:one, 1}, {:same, 2}, {:two, 2, 3}, {:two, 5, 6}, 5, 7}");
+
+    // Calls with no matching arity report all of their arguments
+    try {
+        lix::eval("Arity.pick(1, 2, 3)", ctx);
+        CHECK(false);
+    } catch (const lix::raised_exception& e) {
+        CHECK(e.value()
+              == lix::tuple::make(lix::symbol("badarg"), "Arity.pick", lix::tuple::make(1, 2, 3)));
+    }
+    try {
+        lix::eval("f = fn a, b -> a end\nf.(1)", ctx);
+        CHECK(false);
+    } catch (const lix::raised_exception& e) {
+        CHECK(e.value() == lix::tuple::make(lix::symbol("nomatch"), lix::tuple::make(1)));
+    }
+
+    // Closures called from C++ take the arguments as a tuple
+    auto fn = ctx.get_module("Arity")->get_function("pick");
+    REQUIRE(fn);
+    auto pick = std::get_if<lix::exec::closure>(&*fn);
+    REQUIRE(pick);
+    auto ret = lix::eval(*pick, ctx, lix::tuple::make(8, 8));
+    CHECK(lix::inspect(ret) == "{:same, 8}");
+}
+
+TEST_CASE("Call wrapped native functions") {
+    auto ctx = lix::exec::build_kernel_context();
+
+    lix::exec::module mod;
+    mod.add_function("pair", lix::wrap_function([](const lix::symbol& s, const lix::value& v) {
+                         return lix::tuple::make(s, v);
+                     }));
+    mod.add_function("count", [](lix::exec::context&, const lix::value& args) -> lix::value {
+        return static_cast<std::int64_t>(args.as_tuple()->size());
+    });
+    ctx.register_module("Native", mod);
+
+    CHECK(lix::inspect(lix::eval("Native.pair(:a, 1)", ctx)) == "{:a, 1}");
+    CHECK(lix::inspect(lix::eval("apply(:Native, :pair, [:b, [2]])", ctx)) == "{:b, [2]}");
+    CHECK(lix::eval("Native.count(1, 2, 3)", ctx) == 3);
+
+    // The typed entry point checks the arguments the same as the tuple one
+    auto check_raises = [&](const char* code) {
+        try {
+            lix::eval(code, ctx);
+            CHECK(false);
+        } catch (const lix::raised_exception& e) {
+            auto tup = e.value().as_tuple();
+            REQUIRE(tup);
+            CHECK((*tup)[0] == "RuntimeError"_sym);
+        }
+    };
+    check_raises("Native.pair(1, 1)");
+    check_raises("Native.pair(:a)");
+    check_raises("Native.pair(:a, 1, 2)");
+}
+
 TEST_CASE("Pipe") {
     auto code = R"(
         defmodule Dummy do
@@ -695,3 +1131,298 @@ TEST_CASE("Tail call") {
     INFO(block);
     REQUIRE_NOTHROW(lix::eval(ast, ctx));
 }
+
+TEST_CASE("Deep recursion") {
+    // Each call holds its frame open, so the value stack must grow many times
+    // over while captures and arguments are live
+    auto code = R"(
+        count = fn
+            0, _ -> 0
+            val, count ->
+                1 + count.(val - 1, count)
+        end
+
+        count.(50000, count)
+    )";
+    auto ctx  = lix::exec::build_kernel_context();
+    auto val  = lix::eval(code, ctx);
+    CHECK(val == 50000);
+}
+
+TEST_CASE("A reused executor lets go of the code it has finished running") {
+    auto                ctx = lix::exec::build_kernel_context();
+    lix::exec::executor ex;
+    lix::value          marker = 0;
+    {
+        auto fn = lix::eval(R"(fn -> "marker" end)", ctx);
+        REQUIRE(fn.as_closure());
+        marker = ex.call(ctx, *fn.as_closure(), lix::exec::arg_refs{nullptr, 0});
+        CHECK(marker == lix::value(lix::string("marker")));
+        // The string is still in the constant pool of the closure's code
+        CHECK_FALSE(marker.is_unique());
+    }
+    // Once the closure is gone, nothing may keep its code alive
+    CHECK(marker.is_unique());
+}
+
+TEST_CASE("Call site caches are per-context") {
+    auto code = lix::compile(lix::ast::parse("Later.value(1)"));
+
+    auto make_ctx = [](int n) {
+        auto              ctx = lix::exec::build_kernel_context();
+        lix::exec::module mod;
+        mod.add_function("value", [n](lix::exec::context&, const lix::value&) {
+            return lix::value(n);
+        });
+        ctx.register_module("Later", mod);
+        return ctx;
+    };
+    auto ctx_1 = make_ctx(1);
+    auto ctx_2 = make_ctx(2);
+    CHECK(ctx_1.module_epoch() != ctx_2.module_epoch());
+
+    // The same call site must resolve differently in each context
+    for (auto i = 0; i < 3; ++i) {
+        CHECK(lix::exec::executor(code).execute_all(ctx_1) == 1);
+        CHECK(lix::exec::executor(code).execute_all(ctx_2) == 2);
+    }
+}
+
+TEST_CASE("Forks share the module epoch of their context") {
+    auto code = lix::compile(lix::ast::parse("Later.value(1)"));
+
+    auto              base = lix::exec::build_kernel_context();
+    lix::exec::module later;
+    later.add_function("value", [](lix::exec::context&, const lix::value&) {
+        return lix::value(1);
+    });
+    base.register_module("Later", later);
+    CHECK(lix::exec::executor(code).execute_all(base) == 1);
+
+    // Modules that aren't frozen are copied into a fork, so it resolves them
+    // on its own
+    auto copied = base.fork();
+    CHECK(copied.module_epoch() != base.module_epoch());
+    CHECK(copied.get_module("Later"));
+
+    base.freeze();
+    auto fork_1 = base.fork();
+    CHECK(fork_1.module_epoch() == base.module_epoch());
+
+    // Freezing again after a registration moves the modules of the base into a
+    // new table, so the earlier fork no longer sees the same ones
+    base.register_module("Other", lix::exec::module());
+    base.freeze();
+    auto fork_2 = base.fork();
+    CHECK(fork_2.module_epoch() == base.module_epoch());
+    CHECK(fork_1.module_epoch() != base.module_epoch());
+    CHECK_FALSE(fork_1.get_module("Other"));
+
+    auto fork_3 = base.fork();
+    fork_3.register_module("Mine", lix::exec::module());
+    CHECK(fork_3.module_epoch() != base.module_epoch());
+    CHECK(fork_2.module_epoch() == base.module_epoch());
+
+    for (auto i = 0; i < 3; ++i) {
+        for (auto ctx : {&base, &copied, &fork_1, &fork_2, &fork_3}) {
+            CHECK(lix::exec::executor(code).execute_all(*ctx) == 1);
+        }
+    }
+}
+
+TEST_CASE("Call site caches hold one entry per site") {
+    auto code = lix::compile(lix::ast::parse("Later.value(1)"));
+    REQUIRE(code.call_caches().size() == 1);
+
+    auto base = lix::exec::build_kernel_context();
+    base.freeze();
+    auto make_ctx = [&](int n) {
+        // Registering a module gives each fork an epoch of its own
+        auto              ctx = base.fork();
+        lix::exec::module mod;
+        mod.add_function("value", [n](lix::exec::context&, const lix::value&) {
+            return lix::value(n);
+        });
+        ctx.register_module("Later", mod);
+        return ctx;
+    };
+
+    // Every context misses and overwrites the entry of the site
+    auto wrong = 0;
+    for (auto i = 0; i < 20000; ++i) {
+        auto ctx = make_ctx(i);
+        wrong += lix::exec::executor(code).execute_all(ctx) != i;
+    }
+    CHECK(wrong == 0);
+    CHECK(code.call_caches().size() == 1);
+
+    // Contexts on several threads fight over the one entry, and must each
+    // still resolve the call to their own module
+    std::vector<int>         wrong_by_thread(4);
+    std::vector<std::thread> threads;
+    for (auto t = 0u; t < wrong_by_thread.size(); ++t) {
+        threads.emplace_back([&, t] {
+            auto ctx = make_ctx(static_cast<int>(t));
+            for (auto i = 0; i < 5000; ++i) {
+                wrong_by_thread[t] += lix::exec::executor(code).execute_all(ctx) != lix::value(t);
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    CHECK(wrong_by_thread == std::vector<int>(wrong_by_thread.size(), 0));
+}
+
+TEST_CASE("Intern symbols from many threads") {
+    CHECK("concurrent-sym-0"_sym == lix::symbol("concurrent-sym-0"));
+
+    std::vector<std::vector<const std::string*>> seen(4);
+    std::vector<std::thread>                      threads;
+    for (auto& out : seen) {
+        threads.emplace_back([&out] {
+            for (auto i = 0; i < 2000; ++i) {
+                auto sym = lix::symbol("concurrent-sym-" + std::to_string(i));
+                out.push_back(&sym.string());
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    for (auto& out : seen) {
+        CHECK(out == seen.front());
+    }
+}
+
+TEST_CASE("Compile a program to an image and load it") {
+    auto image = [] {
+        auto ctx = lix::exec::build_kernel_context();
+        return lix::compile_program(ctx, lix::ast::parse(R"(
+            defmodule Adder do
+              def add_all([]), do: 0
+              def add_all([head|tail]), do: head + add_all(tail)
+              def adder(n), do: fn x -> x + n end
+            end
+
+            add5 = Adder.adder(5)
+            {Adder.add_all([1, 2, 3]), add5.(10), :ok, "string"}
+        )"));
+    }();
+    REQUIRE(lix::exec::is_module_image(image));
+
+    // Load into a context that has never seen the source
+    auto ctx   = lix::exec::build_kernel_context();
+    auto entry = lix::exec::load_program_image(ctx, image);
+    CHECK(ctx.get_module("Adder"));
+    auto val = lix::exec::executor(entry).execute_all(ctx);
+    CHECK(val == lix::value(lix::tuple::make(6, 15, "ok"_sym, lix::string("string"))));
+
+    // Images from another bytecode version are rejected
+    auto stale = image;
+    stale[4]   = static_cast<char>(lix::code::bytecode_version + 1);
+    CHECK_THROWS_AS(lix::exec::load_program_image(ctx, stale), std::runtime_error);
+    CHECK_THROWS_AS(lix::exec::load_program_image(ctx, image.substr(0, image.size() / 2)),
+                    std::runtime_error);
+}
+
+TEST_CASE("Images with corrupt code are rejected when loaded") {
+    namespace is = lix::code::is_types;
+    auto image   = [] {
+        auto ctx = lix::exec::build_kernel_context();
+        return lix::compile_program(ctx, lix::ast::parse(R"(
+            defmodule Adder do
+              def add_all([]), do: 0
+              def add_all([head|tail]), do: head + add_all(tail)
+            end
+        )"));
+    }();
+    auto ctx = lix::exec::build_kernel_context();
+    lix::exec::load_program_image(ctx, image);
+    auto fn = ctx.get_module("Adder")->get_function("add_all");
+    REQUIRE(fn);
+    auto& add_all = std::get<lix::exec::closure>(*fn);
+    auto& code    = add_all.code();
+
+    // Save add_all in an image of its own, after `corrupt` has changed its code
+    auto image_of = [&](auto corrupt) {
+        std::vector<lix::code::instr> instrs(code.begin(), code.end());
+        corrupt(instrs);
+        auto              constants = code.constants();
+        auto              copy  = lix::code::code(instrs.begin(), instrs.end(), std::move(constants));
+        auto              entry = copy.begin() + (add_all.code_begin() - code.begin());
+        lix::exec::module mod;
+        mod.add_closure_function("add_all", lix::exec::closure(copy, entry, add_all.captures()));
+        auto save_ctx = lix::exec::build_kernel_context();
+        save_ctx.register_module("Corrupt", std::move(mod));
+        return lix::exec::save_module_image(save_ctx, {"Corrupt"});
+    };
+    auto load = [](const std::string& image) {
+        auto load_ctx = lix::exec::build_kernel_context();
+        lix::exec::load_module_image(load_ctx, image);
+    };
+    auto first = [](std::vector<lix::code::instr>& instrs, auto is_type) {
+        auto iter = std::find_if(instrs.begin(), instrs.end(), [](const lix::code::instr& in) {
+            return std::holds_alternative<decltype(is_type)>(in.instr_var());
+        });
+        REQUIRE(iter != instrs.end());
+        return iter;
+    };
+    CHECK_NOTHROW(load(image_of([](auto&) {})));
+
+    // A jump past the end of the code
+    CHECK_THROWS_AS(load(image_of([&](auto& instrs) {
+                        first(instrs, is::jump{})->set_jump_target({instrs.size() + 3});
+                    })),
+                    std::runtime_error);
+    // A return of a slot above the top of the stack
+    CHECK_THROWS_AS(load(image_of([&](auto& instrs) {
+                        *first(instrs, is::ret{}) = is::ret{lix::code::slot_ref_t{1000}};
+                    })),
+                    std::runtime_error);
+}
+
+TEST_CASE("Compile cache") {
+    auto ctx = lix::exec::build_kernel_context();
+    auto src = "{:cached, 1 + 2}";
+    lix::eval(src, ctx);
+    CHECK(ctx.get_compile_cache_stats().misses == 0);
+
+    ctx.enable_compile_cache();
+    auto first = lix::eval(src, ctx);
+    CHECK(ctx.get_compile_cache_stats().misses == 1);
+    CHECK(ctx.get_compile_cache_stats().hits == 0);
+    CHECK(lix::eval(src, ctx) == first);
+    CHECK(lix::eval(src, ctx) == first);
+    CHECK(ctx.get_compile_cache_stats().hits == 2);
+    CHECK(ctx.get_compile_cache_stats().size == 1);
+
+    // Registering a module may change how the source expands
+    ctx.register_module("Unrelated", lix::exec::module());
+    CHECK(lix::eval(src, ctx) == first);
+    CHECK(ctx.get_compile_cache_stats().misses == 2);
+    CHECK(lix::eval(src, ctx) == first);
+    CHECK(ctx.get_compile_cache_stats().hits == 3);
+
+    // A full cache makes room by evicting the least recently used entry
+    ctx.enable_compile_cache(2);
+    lix::eval("{:other, 1}", ctx);
+    lix::eval(src, ctx);
+    lix::eval("{:third, 1}", ctx);
+    CHECK(ctx.get_compile_cache_stats().evictions == 1);
+    CHECK(ctx.get_compile_cache_stats().size == 2);
+    CHECK(ctx.get_compile_cache_stats().hits == 4);
+    lix::eval(src, ctx);
+    CHECK(ctx.get_compile_cache_stats().hits == 5);
+    lix::eval("{:other, 1}", ctx);
+    CHECK(ctx.get_compile_cache_stats().misses == 5);
+    CHECK(ctx.get_compile_cache_stats().evictions == 2);
+    ctx.enable_compile_cache(1);
+    CHECK(ctx.get_compile_cache_stats().evictions == 3);
+    CHECK(ctx.get_compile_cache_stats().size == 1);
+
+    ctx.disable_compile_cache();
+    lix::eval(src, ctx);
+    CHECK(ctx.get_compile_cache_stats().hits == 5);
+    CHECK(ctx.get_compile_cache_stats().size == 0);
+}